@@ -0,0 +1,44 @@
+// Microbenchmark of the file checksum: CRC-32C (crc32c_update, the SSE4.2
+// instruction or slicing-by-8 tables) against the CRC-32 of the I frames, in
+// bytes per cycle. The application layer runs CRC-32C over every byte of the
+// file on both sides, so it must stay far above the speed of the link.
+//
+// Build and run from the repository root:
+//   gcc -O2 -Wall -Iinclude -o bin/checksum_bench bench/checksum_bench.c src/frame_check.c
+//   ./bin/checksum_bench
+// Add -DLL_SIMD=0 to measure the tables.
+
+#include "frame_check.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <x86intrin.h>
+
+#define ROUNDS 200
+#define BLOCK_SIZE (1024 * 1024)
+
+int main()
+{
+    static unsigned char data[BLOCK_SIZE];
+
+    srand(1);
+    for (int i = 0; i < BLOCK_SIZE; i++)
+        data[i] = rand() & 0xFF;
+    printf("CRC-32C implementation: %s\n", crc32c_implementation());
+
+    uint32_t crc = 0;
+    unsigned long long start = __rdtsc();
+    for (int r = 0; r < ROUNDS; r++)
+        crc = crc32c_update(crc, data, BLOCK_SIZE);
+    double crc32c_cycles = (double)(__rdtsc() - start) / ROUNDS;
+
+    uint32_t check = 0;
+    start = __rdtsc();
+    for (int r = 0; r < ROUNDS; r++)
+        check += crc32(data, BLOCK_SIZE);
+    double crc32_cycles = (double)(__rdtsc() - start) / ROUNDS;
+
+    printf("CRC-32C %6.3f B/cycle  CRC-32 %6.3f B/cycle  (%08x %08x)\n",
+           BLOCK_SIZE / crc32c_cycles, BLOCK_SIZE / crc32_cycles, crc, check);
+    return 0;
+}
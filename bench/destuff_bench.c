@@ -0,0 +1,141 @@
+// Microbenchmark of the receive path: byte by byte state machine against
+// state_machine_feed (SIMD scan and bulk copy of clean runs).
+//
+// Build and run from the repository root:
+//   gcc -O2 -Wall -Iinclude -o bin/destuff_bench bench/destuff_bench.c src/state_machine.c src/byte_scan.c src/frame_check.c src/link_config.c src/fec.c src/whitening.c src/cobs.c src/link_handle.c src/serial_port.c
+//   ./bin/destuff_bench
+
+#include "state_machine.h"
+#include "byte_scan.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <x86intrin.h>
+
+#define ROUNDS 20000
+
+// Helper Functions prototypes
+int stuff_frame(const unsigned char *data, int size, unsigned char *frame);
+void fill_payload(unsigned char *data, int size, int special_every);
+double run_bytewise(const unsigned char *frame, int frame_size);
+double run_feed(const unsigned char *frame, int frame_size);
+void run_case(const char *name, int special_every);
+
+// Build an I frame (I_FRAME_0) with byte stuffing, as the transmitter does
+int stuff_frame(const unsigned char *data, int size, unsigned char *frame)
+{
+    int n = 0;
+    frame[n++] = FLAG;
+    frame[n++] = TRANSMITTER_ADDRESS;
+    frame[n++] = I_FRAME_0;
+    frame[n++] = TRANSMITTER_ADDRESS ^ I_FRAME_0;
+
+    unsigned char BCC2 = 0;
+    for (int i = 0; i <= size; i++)
+    {
+        unsigned char byte = (i < size) ? data[i] : BCC2; // BCC2 is stuffed too
+        if (byte == FLAG || byte == ESC)
+        {
+            frame[n++] = ESC;
+            frame[n++] = (byte == FLAG) ? ESC_FLAG : ESC_ESC;
+        }
+        else
+        {
+            frame[n++] = byte;
+        }
+        if (i < size)
+            BCC2 ^= byte;
+    }
+
+    frame[n++] = FLAG;
+    return n;
+}
+
+// Random payload; special_every > 0 puts a FLAG every that many bytes and
+// otherwise avoids FLAG and ESC, 0 leaves the random bytes as they are
+void fill_payload(unsigned char *data, int size, int special_every)
+{
+    for (int i = 0; i < size; i++)
+    {
+        data[i] = rand() & 0xFF;
+        if (special_every > 0)
+        {
+            if (data[i] == FLAG || data[i] == ESC)
+                data[i] = 0;
+            if (i % special_every == special_every - 1)
+                data[i] = FLAG;
+        }
+    }
+}
+
+// Cycles per frame with one state_machine() call per byte (previous receive path)
+double run_bytewise(const unsigned char *frame, int frame_size)
+{
+    struct state_machine machine;
+    unsigned char buf[MAX_PAYLOAD_SIZE + MAX_CHECK_SIZE];
+    create_state_machine(&machine, READ, I_FRAME_0, TRANSMITTER_ADDRESS, START);
+    state_machine_use_buffer(&machine, buf, sizeof(buf));
+
+    unsigned long long start = __rdtsc();
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        machine.state = START;
+        for (int i = 0; i < frame_size; i++)
+            state_machine(&machine, frame[i]);
+        if (machine.state != STP || machine.REJ)
+        {
+            printf("Frame not decoded!\n");
+            exit(1);
+        }
+    }
+    return (double)(__rdtsc() - start) / ROUNDS;
+}
+
+// Cycles per frame with state_machine_feed over the whole span
+double run_feed(const unsigned char *frame, int frame_size)
+{
+    struct state_machine machine;
+    unsigned char buf[MAX_PAYLOAD_SIZE + MAX_CHECK_SIZE];
+    create_state_machine(&machine, READ, I_FRAME_0, TRANSMITTER_ADDRESS, START);
+    state_machine_use_buffer(&machine, buf, sizeof(buf));
+
+    unsigned long long start = __rdtsc();
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        machine.state = START;
+        state_machine_feed(&machine, frame, frame_size);
+        if (machine.state != STP || machine.REJ)
+        {
+            printf("Frame not decoded!\n");
+            exit(1);
+        }
+    }
+    return (double)(__rdtsc() - start) / ROUNDS;
+}
+
+void run_case(const char *name, int special_every)
+{
+    unsigned char data[MAX_PAYLOAD_SIZE];
+    unsigned char frame[FRAME_SIZE_BOUND(MAX_PAYLOAD_SIZE)];
+
+    fill_payload(data, MAX_PAYLOAD_SIZE, special_every);
+    int frame_size = stuff_frame(data, MAX_PAYLOAD_SIZE, frame);
+
+    double bytewise = run_bytewise(frame, frame_size);
+    double feed = run_feed(frame, frame_size);
+
+    printf("%-24s %5d B  byte by byte %6.3f B/cycle  feed %6.3f B/cycle  speedup %5.1fx\n",
+           name, frame_size, frame_size / bytewise, frame_size / feed, bytewise / feed);
+}
+
+int main()
+{
+    srand(1);
+    printf("Scan implementation: %s\n", byte_scan_implementation());
+
+    run_case("no FLAG/ESC", 1 << 30);
+    run_case("random bytes", 0);
+    run_case("FLAG every 64 bytes", 64);
+    run_case("FLAG every 8 bytes", 8);
+    return 0;
+}
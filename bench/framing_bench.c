@@ -0,0 +1,114 @@
+// Microbenchmark of the two framings: HDLC byte stuffing (stuff_bytes) against
+// COBS (cobs_encode/cobs_decode), in encoding speed and in bytes on the wire,
+// which is what bounds the throughput of a serial link.
+//
+// Build and run from the repository root:
+//   gcc -O2 -Wall -Iinclude -o bin/framing_bench bench/framing_bench.c src/byte_scan.c src/cobs.c
+//   ./bin/framing_bench
+
+#include "state_machine.h"
+#include "byte_scan.h"
+#include "cobs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <x86intrin.h>
+
+#define ROUNDS 20000
+#define PAYLOAD_SIZE 4096 // Larger than MAX_PAYLOAD_SIZE, as if it were raised
+#define TEXT_FILE "src/link_layer.c"
+
+// Helper Functions prototypes
+void fill_random(unsigned char *data, int size);
+void fill_text(unsigned char *data, int size);
+void run_case(const char *name, const unsigned char *data);
+
+void fill_random(unsigned char *data, int size)
+{
+    for (int i = 0; i < size; i++)
+        data[i] = rand() & 0xFF;
+}
+
+// Source code of the project, repeated to fill the payload
+void fill_text(unsigned char *data, int size)
+{
+    FILE *file = fopen(TEXT_FILE, "rb");
+    int filled = 0;
+    while (file != NULL && filled < size)
+    {
+        size_t n = fread(data + filled, 1, size - filled, file);
+        filled += n;
+        if (n == 0)
+            rewind(file);
+    }
+    if (file != NULL)
+        fclose(file);
+
+    if (filled < size)
+    {
+        printf("Cannot read %s, run from the repository root\n", TEXT_FILE);
+        exit(1);
+    }
+}
+
+void run_case(const char *name, const unsigned char *data)
+{
+    static unsigned char stuffed[MAX_STUFFED_SIZE(PAYLOAD_SIZE)];
+    static unsigned char encoded[COBS_MAX_SIZE(PAYLOAD_SIZE)];
+    static unsigned char decoded[COBS_MAX_SIZE(PAYLOAD_SIZE)];
+    int stuffed_size = 0;
+    size_t encoded_size = 0;
+    int decoded_size = 0;
+
+    unsigned long long start = __rdtsc();
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        unsigned char bcc = 0;
+        stuffed_size = stuff_bytes(data, PAYLOAD_SIZE, stuffed, &bcc);
+    }
+    double hdlc = (double)(__rdtsc() - start) / ROUNDS;
+
+    start = __rdtsc();
+    for (int r = 0; r < ROUNDS; r++)
+        encoded_size = cobs_encode(data, PAYLOAD_SIZE, encoded);
+    double cobs = (double)(__rdtsc() - start) / ROUNDS;
+
+    start = __rdtsc();
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        memcpy(decoded, encoded, encoded_size);
+        decoded_size = cobs_decode(decoded, encoded_size);
+    }
+    double cobs_decoding = (double)(__rdtsc() - start) / ROUNDS;
+
+    if (decoded_size != PAYLOAD_SIZE || memcmp(decoded, data, PAYLOAD_SIZE) != 0 ||
+        memchr(encoded, FLAG, encoded_size) != NULL)
+    {
+        printf("COBS round trip failed!\n");
+        exit(1);
+    }
+
+    printf("%-12s HDLC %6.3f B/cycle %6.2f%% overhead  COBS %6.3f B/cycle (decode %6.3f) %6.2f%% overhead\n",
+           name, PAYLOAD_SIZE / hdlc, 100.0 * (stuffed_size - PAYLOAD_SIZE) / PAYLOAD_SIZE,
+           PAYLOAD_SIZE / cobs, PAYLOAD_SIZE / cobs_decoding,
+           100.0 * ((double)encoded_size - PAYLOAD_SIZE) / PAYLOAD_SIZE);
+}
+
+int main()
+{
+    static unsigned char data[PAYLOAD_SIZE];
+
+    srand(1);
+    printf("Scan implementation: %s\n", byte_scan_implementation());
+
+    fill_random(data, PAYLOAD_SIZE);
+    run_case("random", data);
+
+    memset(data, FLAG, PAYLOAD_SIZE);
+    run_case("all FLAG", data);
+
+    fill_text(data, PAYLOAD_SIZE);
+    run_case("text", data);
+    return 0;
+}
@@ -0,0 +1,111 @@
+// Microbenchmark of the transmit path: byte by byte stuffing loop (previous
+// build_data_frame) against stuff_bytes (SIMD scan, bulk copy and BCC2 in one pass).
+//
+// Build and run from the repository root:
+//   gcc -O2 -Wall -Iinclude -o bin/stuff_bench bench/stuff_bench.c src/byte_scan.c
+//   ./bin/stuff_bench
+
+#include "state_machine.h"
+#include "byte_scan.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <x86intrin.h>
+
+#define ROUNDS 20000
+#define PAYLOAD_SIZE 4096 // Larger than MAX_PAYLOAD_SIZE, as if it were raised
+
+// Helper Functions prototypes
+int stuff_bytewise(const unsigned char *buf, int buf_size, unsigned char *frame, unsigned char *bcc);
+void fill_payload(unsigned char *data, int size, int special_every);
+void run_case(const char *name, int special_every);
+
+// Byte by byte stuffing and BCC2, as build_data_frame used to do
+int stuff_bytewise(const unsigned char *buf, int buf_size, unsigned char *frame, unsigned char *bcc)
+{
+    int frame_size = 0;
+    unsigned char BCC2 = 0;
+    for (int i = 0; i < buf_size; i++)
+    {
+        if (buf[i] == FLAG)
+        {
+            frame[frame_size++] = ESC;
+            frame[frame_size++] = ESC_FLAG;
+        }
+        else if (buf[i] == ESC)
+        {
+            frame[frame_size++] = ESC;
+            frame[frame_size++] = ESC_ESC;
+        }
+        else
+        {
+            frame[frame_size++] = buf[i];
+        }
+        BCC2 ^= buf[i];
+    }
+    *bcc = BCC2;
+    return frame_size;
+}
+
+// Random payload; special_every > 0 puts a FLAG every that many bytes and
+// otherwise avoids FLAG and ESC, 0 leaves the random bytes as they are
+void fill_payload(unsigned char *data, int size, int special_every)
+{
+    for (int i = 0; i < size; i++)
+    {
+        data[i] = rand() & 0xFF;
+        if (special_every > 0)
+        {
+            if (data[i] == FLAG || data[i] == ESC)
+                data[i] = 0;
+            if (i % special_every == special_every - 1)
+                data[i] = FLAG;
+        }
+    }
+}
+
+void run_case(const char *name, int special_every)
+{
+    static unsigned char data[PAYLOAD_SIZE];
+    static unsigned char expected[MAX_STUFFED_SIZE(PAYLOAD_SIZE)];
+    static unsigned char frame[MAX_STUFFED_SIZE(PAYLOAD_SIZE)];
+    unsigned char expected_bcc = 0, bcc = 0;
+    int expected_size = 0, frame_size = 0;
+
+    fill_payload(data, PAYLOAD_SIZE, special_every);
+
+    unsigned long long start = __rdtsc();
+    for (int r = 0; r < ROUNDS; r++)
+        expected_size = stuff_bytewise(data, PAYLOAD_SIZE, expected, &expected_bcc);
+    double bytewise = (double)(__rdtsc() - start) / ROUNDS;
+
+    start = __rdtsc();
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        bcc = 0;
+        frame_size = stuff_bytes(data, PAYLOAD_SIZE, frame, &bcc);
+    }
+    double bulk = (double)(__rdtsc() - start) / ROUNDS;
+
+    if (frame_size != expected_size || bcc != expected_bcc || memcmp(frame, expected, frame_size) != 0)
+    {
+        printf("Stuffed frames differ!\n");
+        exit(1);
+    }
+
+    printf("%-24s %5d B  byte by byte %6.3f B/cycle  stuff_bytes %6.3f B/cycle  speedup %5.1fx\n",
+           name, PAYLOAD_SIZE, PAYLOAD_SIZE / bytewise, PAYLOAD_SIZE / bulk, bytewise / bulk);
+}
+
+int main()
+{
+    srand(1);
+    printf("Scan implementation: %s\n", byte_scan_implementation());
+
+    run_case("no FLAG/ESC", 1 << 30);
+    run_case("random bytes", 0);
+    run_case("FLAG every 64 bytes", 64);
+    run_case("FLAG every 8 bytes", 8);
+    return 0;
+}
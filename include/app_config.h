@@ -0,0 +1,79 @@
+// Application layer configuration.
+// Defaults keep the original protocol, plus the file checksum. Every value can
+// be overridden at build time, e.g.: make CFLAGS="-Wall -DAL_COMPRESSION=1"
+
+#ifndef _APP_CONFIG_H_
+#define _APP_CONFIG_H_
+
+// Compress file blocks before sending them (the receiver always understands
+// compressed blocks). Blocks that do not shrink are sent raw.
+#ifndef AL_COMPRESSION
+#define AL_COMPRESSION 0
+#endif
+
+// Compression threads; 0 starts one per online CPU (at most COMPRESS_MAX_THREADS)
+#ifndef AL_COMPRESSION_THREADS
+#define AL_COMPRESSION_THREADS 0
+#endif
+
+// Frames the transmitter encodes ahead of the link
+#ifndef AL_PIPELINE_DEPTH
+#define AL_PIPELINE_DEPTH 4
+#endif
+
+// Largest number of serial ports bonded into one transfer
+#ifndef AL_MAX_LINKS
+#define AL_MAX_LINKS 8
+#endif
+
+// Flush the received file to the disk before closing it:
+//   AL_FSYNC_NONE: leave it to the kernel (original behaviour)
+//   AL_FSYNC_DATA: fdatasync, the data and the file size
+//   AL_FSYNC_FULL: fsync, the data and every attribute
+#define AL_FSYNC_NONE 0
+#define AL_FSYNC_DATA 1
+#define AL_FSYNC_FULL 2
+
+#ifndef AL_FSYNC
+#define AL_FSYNC AL_FSYNC_NONE
+#endif
+
+// Resume interrupted transfers: the receiver keeps a journal of the bytes
+// written next to the output file and offers them in the handshake, and the
+// transmitter sends only the rest of the file. Both sides need it; the
+// transmitter then always proposes link parameters (see ll_open_reply).
+// The output file is flushed (fdatasync) before each journal update, even
+// with AL_FSYNC_NONE, so the journal never commits bytes only in the page cache.
+#ifndef AL_RESUME
+#define AL_RESUME 0
+#endif
+
+// File bytes received between two updates of the journal
+#ifndef AL_JOURNAL_INTERVAL
+#define AL_JOURNAL_INTERVAL (64 * 1024)
+#endif
+
+// Delta sync: before each transfer the receiver sends the checksums of the
+// blocks of its current copy of the file, and the transmitter sends only the
+// data the receiver does not have (see delta.h). Both sides need it.
+#ifndef AL_DELTA
+#define AL_DELTA 0
+#endif
+
+// Block size of the signature; 0 picks about the square root of the file size
+#ifndef AL_DELTA_BLOCK_SIZE
+#define AL_DELTA_BLOCK_SIZE 0
+#endif
+
+// Send the CRC-32C of the whole file in the END packet, computed as the file
+// is read, and check it at the receiver as the file is written. A file that
+// does not match is reported as a failed transfer.
+#ifndef AL_CHECKSUM
+#define AL_CHECKSUM 1
+#endif
+
+#if AL_FSYNC < AL_FSYNC_NONE || AL_FSYNC > AL_FSYNC_FULL
+#error "AL_FSYNC must be AL_FSYNC_NONE, AL_FSYNC_DATA or AL_FSYNC_FULL"
+#endif
+
+#endif // _APP_CONFIG_H_
@@ -0,0 +1,24 @@
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include "link_layer.h"
+
+// Batch sessions: every file of a directory tree, or of a list of files, in
+// one link session. Each file goes as its own START, data packets and END.
+
+#define BATCH_LIST_PREFIX '@' // Marks a file listing the files of a batch, one per line
+
+// Returns TRUE if filename names a batch of files: a directory (where the
+// receiver puts them), or a BATCH_LIST_PREFIX list of files (transmitter)
+int is_batch(const char *filename, LinkLayerRole role);
+
+// Send every file of a batch in this session, named by their paths relative
+// to the directory (or as listed). Each START but the last carries NEXT_FILE.
+int handle_batch_transmitter(const char *filename);
+
+// Receive files into a directory, recreating the paths their FILE_NAME
+// fields give, until a START without NEXT_FILE. A single file (no NEXT_FILE)
+// is received into the directory the same way.
+int handle_batch_receiver(const char *directory);
+
+#endif // _BATCH_H_
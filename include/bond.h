@@ -0,0 +1,80 @@
+#ifndef _BOND_H_
+#define _BOND_H_
+
+#include "app_config.h"
+#include "link_layer.h"
+#include "state_machine.h"
+#include <pthread.h>
+#include <time.h>
+
+// Bonded transfer: the file is striped across several links, one thread per
+// link. Links take the next part of the file as soon as they are free, so
+// each one carries a share proportional to its goodput.
+
+#define PORT_SEPARATOR ',' // Separates the serial ports of a bonded transfer
+
+struct bond; // Transfer a link is part of
+
+// Range of file bytes
+struct bond_chunk
+{
+    long long offset; // Offset of the first byte
+    long long size;   // Number of bytes
+};
+
+// One link of a bonded transfer, driven by its own thread
+struct bond_link
+{
+    pthread_t thread;                // Thread driving the link
+    struct bond *bond;               // Transfer the link is part of
+    int index;                       // Position in the list of ports
+    LinkLayer connection_parameters; // Parameters given to ll_open
+    struct ll_link *link;            // Open link, NULL if it could not be opened
+    struct timespec started;         // Time the link was ready for chunks
+    int elapsed;                     // Milliseconds from started until the link finished
+    double goodput;                  // File bytes per second carried so far (transmitter)
+    long long bytes;                 // File bytes carried
+    int packets;                     // Data packets carried
+    int failed;                      // Link gave up
+    int finished;                    // Thread is done with the link
+    struct ll_statistics statistics; // Link layer statistics at the end of the transfer
+
+    // Chunks sent and not yet acknowledged, oldest first (transmitter). With a
+    // sliding window ll_write_encoded returns before the frame is acknowledged.
+    struct bond_chunk pending[LL_WINDOW_SIZE + 1]; // The window and the chunk just sent
+    int num_pending;
+};
+
+// Bonded transfer of a file, shared by the threads of its links
+struct bond
+{
+    struct bond_link links[AL_MAX_LINKS];
+    int num_links;
+    int fd;                   // File being sent or received
+    const unsigned char *map; // Contents of the file being sent, or NULL if it is read instead
+    const char *filename;     // Name sent in the control packets (transmitter) or output file (receiver)
+    long long file_size;      // Size of the file, -1 until a control packet tells it (receiver)
+    int result;               // -1 once something went wrong
+    pthread_mutex_t lock;
+    pthread_cond_t changed; // A chunk was sent, received or given back, or a link finished
+
+    // Transmitter
+    long long next_offset;                 // First byte not yet handed to a link
+    struct bond_chunk retry[AL_MAX_LINKS * (LL_WINDOW_SIZE + 1)]; // Chunks of links that failed, to be sent again
+    int num_retry;                                                // Number of chunks in retry
+    int in_flight;                                                // Chunks being sent or not yet acknowledged
+
+    // Receiver
+    struct bond_chunk *received; // Disjoint ranges written to the file, by offset
+    int num_received;            // Number of ranges
+    int received_capacity;       // Size of the received array
+    long long received_bytes;    // Bytes covered by the ranges
+    int finished_links;          // Links done (END received, or failed)
+};
+
+// Transfer a file over several serial ports ("port1,port2,..."), one link per
+// port. Both sides must list the ports in matching order.
+// Returns -1 on error, 1 otherwise.
+int bonded_transfer(const char *serialPorts, LinkLayer connection_parameters, const char *filename);
+
+#endif // _BOND_H_
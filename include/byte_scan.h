@@ -0,0 +1,24 @@
+#ifndef _BYTE_SCAN_H_
+#define _BYTE_SCAN_H_
+
+#include <stddef.h>
+
+// Bulk scans over frame data.
+// On x86 the AVX2 or SSE2 version is picked at run time from the CPU
+// features (LL_SIMD = 0 forces the portable version).
+
+// Copy the bytes of src that come before the first FLAG or ESC to dst and XOR
+// them into *bcc, in a single pass. dst must have room for len bytes (bytes
+// after the run may be overwritten).
+// Returns the length of the run (len if src holds no FLAG or ESC).
+size_t copy_clean_run(const unsigned char *src, size_t len, unsigned char *dst, unsigned char *bcc);
+
+// Byte stuff src into dst and XOR every byte of src into *bcc.
+// dst must have room for MAX_STUFFED_SIZE(len) bytes.
+// Returns the number of bytes written to dst.
+size_t stuff_bytes(const unsigned char *src, size_t len, unsigned char *dst, unsigned char *bcc);
+
+// Name of the implementation in use ("avx2", "sse2" or "scalar")
+const char *byte_scan_implementation();
+
+#endif // _BYTE_SCAN_H_
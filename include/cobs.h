@@ -0,0 +1,23 @@
+#ifndef _COBS_H_
+#define _COBS_H_
+
+#include <stddef.h>
+
+// Consistent Overhead Byte Stuffing, removing FLAG instead of zero bytes.
+// The data is cut at every FLAG into runs of at most 254 bytes; each run is
+// preceded by a code byte (run length + 1, XORed with FLAG so it is never
+// FLAG itself), and the FLAG that ended the run is implied. The overhead is
+// one byte per 254 bytes plus one, whatever the data.
+
+// Largest encoded size of n bytes
+#define COBS_MAX_SIZE(n) ((n) + (n) / 254 + 1)
+
+// Encode len bytes of src into dst (COBS_MAX_SIZE(len) bytes).
+// Returns the encoded size.
+size_t cobs_encode(const unsigned char *src, size_t len, unsigned char *dst);
+
+// Decode len bytes of buf in place.
+// Returns the decoded size, or -1 if the data is not valid COBS.
+int cobs_decode(unsigned char *buf, size_t len);
+
+#endif // _COBS_H_
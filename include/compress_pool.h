@@ -0,0 +1,73 @@
+#ifndef _COMPRESS_POOL_H_
+#define _COMPRESS_POOL_H_
+
+#include <pthread.h>
+
+// Worker threads that compress file blocks ahead of the link. The producer
+// fills blocks in file order and the consumer (which may be another thread)
+// collects them in the same order once compressed, so compression of the
+// next blocks overlaps the transmission of the current one.
+
+#define COMPRESS_MAX_THREADS 8
+#define COMPRESS_MAX_BLOCKS (2 * COMPRESS_MAX_THREADS)
+
+enum compress_block_state
+{
+    BLOCK_FREE,    // Can be filled by the producer
+    BLOCK_PENDING, // Waiting for a worker
+    BLOCK_BUSY,    // Being compressed
+    BLOCK_DONE     // Ready to be collected
+};
+
+struct compress_block
+{
+    unsigned char *raw;              // Buffer for file data read by the producer
+    const unsigned char *data;       // File data: raw, or memory of the producer (e.g. a mapped file)
+    int raw_size;                    // Size of the file data
+    unsigned char *packed;           // Compressed data
+    int packed_size;                 // Size of the compressed data
+    int compressed;                  // 1 if packed holds the block, 0 if stored raw (incompressible)
+    enum compress_block_state state; // Position in the pipeline
+};
+
+struct compress_pool
+{
+    pthread_t threads[COMPRESS_MAX_THREADS];
+    int num_threads;                                   // 0 stores every block raw, without threads
+    struct compress_block blocks[COMPRESS_MAX_BLOCKS]; // Ring of blocks in file order
+    int num_blocks;                                    // Size of the ring
+    int first;                                         // Oldest block not yet released
+    int count;                                         // Blocks submitted and not yet released
+    int stop;                                          // Workers must exit, waits end
+    pthread_mutex_t lock;
+    pthread_cond_t pending; // A block was submitted (or stop was set)
+    pthread_cond_t done;    // A block was compressed (or stop was set)
+    pthread_cond_t freed;   // A block was released (or stop was set)
+};
+
+// Start num_threads workers (0 disables compression) for blocks of up to
+// block_size bytes.
+// Returns 1 on success, -1 on failure.
+int compress_pool_init(struct compress_pool *pool, int num_threads, int block_size);
+
+// Wait for the next block to fill.
+// Returns NULL if the pool was cancelled.
+struct compress_block *compress_pool_next(struct compress_pool *pool);
+
+// Hand the block returned by compress_pool_next to the workers
+void compress_pool_submit(struct compress_pool *pool);
+
+// Wait for the oldest block to be submitted and compressed.
+// Returns NULL if the pool was cancelled.
+struct compress_block *compress_pool_collect(struct compress_pool *pool);
+
+// Give the block returned by compress_pool_collect back to the pool
+void compress_pool_release(struct compress_pool *pool);
+
+// Wake up the producer and the consumer: their waits return NULL from now on
+void compress_pool_cancel(struct compress_pool *pool);
+
+// Stop the workers and free the blocks
+void compress_pool_destroy(struct compress_pool *pool);
+
+#endif // _COMPRESS_POOL_H_
@@ -0,0 +1,38 @@
+#ifndef _DELTA_H_
+#define _DELTA_H_
+
+#include "link_layer.h"
+#include "file_checksum.h"
+
+// Delta sync (AL_DELTA), as in rsync. The receiver sends the checksums of the
+// blocks of its current copy of the file in a session of its own, opened the
+// other way round; the transmitter then sends DATA_COPY packets for the
+// blocks the receiver has and the rest as data packets.
+
+// Current copy of the file at the receiver of a delta transfer
+struct delta_basis
+{
+    int fd;               // The file, -1 if there is none
+    long long file_size;  // Its size
+    int block_size;       // Block size of its signature
+    unsigned char *block; // Buffer of block_size bytes
+};
+
+// Transmitter of a delta transfer: receive the signature of the receiver's
+// copy of the file over a link opened the other way round, then send the
+// file as literal data and copies of the blocks that match
+int handle_delta_transmitter(LinkLayer connection_parameters, const char *filename);
+
+// Receiver of a delta transfer: send the signature of the current copy of the
+// file, then rebuild the new version next to it from literal data and copies
+// of its blocks, and replace it. Like any receiver it may be started before
+// the transmitter: it keeps asking for the signature session until answered.
+int handle_delta_receiver(LinkLayer connection_parameters, const char *filename);
+
+// Write the blocks of the basis a DATA_COPY packet asks for at their offset
+// in the new file, adding them to its checksum.
+// Returns the number of file bytes written, or -1 on error.
+long long copy_basis_blocks(int fd, const struct delta_basis *basis, const unsigned char *packet, int size,
+                            long long file_size, struct file_checksum *checksum);
+
+#endif // _DELTA_H_
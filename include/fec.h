@@ -0,0 +1,27 @@
+#ifndef _FEC_H_
+#define _FEC_H_
+
+// Forward error correction of I frame data with Reed-Solomon codes over
+// GF(256). The data is split into blocks of up to 255 - parity bytes and
+// each block is followed by its parity bytes; a block with up to parity / 2
+// damaged bytes is repaired by the receiver.
+
+// Largest codeword (data and parity of a block)
+#define FEC_BLOCK_SIZE 255
+
+// Largest number of parity bytes per block
+#define FEC_MAX_PARITY 64
+
+// Size of len bytes of data once encoded
+int fec_encoded_size(int len, int parity);
+
+// Encode len bytes of data into out (fec_encoded_size(len, parity) bytes).
+// Returns the encoded size.
+int fec_encode(const unsigned char *data, int len, int parity, unsigned char *out);
+
+// Repair the encoded data in buf and remove the parity bytes, in place.
+// corrected receives the number of bytes repaired.
+// Returns the size of the data, or -1 if a block has too many errors.
+int fec_decode(unsigned char *buf, int len, int parity, int *corrected);
+
+#endif // _FEC_H_
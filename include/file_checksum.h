@@ -0,0 +1,26 @@
+#ifndef _FILE_CHECKSUM_H_
+#define _FILE_CHECKSUM_H_
+
+#include <stdint.h>
+
+// CRC-32C of a whole file (see crc32c_update in frame_check.h), sent in the
+// FILE_CHECKSUM field of the END packet. The transmitter computes it as it
+// reads the file, the receiver as it writes it.
+
+// CRC-32C of a file being received, kept while its data arrives in order
+struct file_checksum
+{
+    uint32_t value;   // CRC-32C of the first bytes of the file
+    long long offset; // Number of bytes covered, -1 once data came out of order
+};
+
+// CRC-32C of the first size bytes of a file (read from map when it is
+// mapped), for the part of a resumed transfer that is not sent again.
+// Returns -1 if the file cannot be read, 1 otherwise.
+int checksum_file_start(int fd, const unsigned char *map, long long size, uint32_t *checksum);
+
+// Add size bytes of data written at offset to the checksum of a file, which
+// only follows data arriving in order
+void file_checksum_update(struct file_checksum *checksum, const unsigned char *data, int size, long long offset);
+
+#endif // _FILE_CHECKSUM_H_
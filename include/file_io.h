@@ -0,0 +1,36 @@
+#ifndef _FILE_IO_H_
+#define _FILE_IO_H_
+
+
+// Files sent and received. The transmitter maps the file in memory and drops
+// the pages already sent; the receiver preallocates the output file and
+// writes each block in place.
+
+// Open the file to send and map it for sequential reading. *map is left NULL
+// if the file is empty or cannot be mapped; it is then read instead.
+// Returns the file descriptor, or -1 on error.
+int open_file_source(const char *filename, long long *file_size, const unsigned char **map);
+
+// Unmap and close the file to send
+void close_file_source(int fd, const unsigned char *map, long long file_size);
+
+// Drop the pages of a mapped file between offsets from and to, already sent,
+// so a large file never holds more than a few blocks in memory.
+// Returns the offset the next call starts from (the end of the last page dropped).
+long long release_mapped_pages(const unsigned char *map, long long from, long long to);
+
+// Create the file to receive, truncated unless a transfer is resumed into it.
+// Returns the file descriptor, or -1 on error.
+int open_file_sink(const char *filename, int truncate);
+
+// Reserve the blocks of the whole file (size told by the START packet), so
+// data packets written at their offsets do not fragment it and a full disk is
+// found before the transfer. File systems without fallocate are not an error.
+// Returns -1 if there is no room for the file, 1 otherwise.
+int preallocate_file_sink(int fd, long long file_size);
+
+// Flush the received file as AL_FSYNC asks and close it.
+// Returns -1 on error, 1 otherwise.
+int close_file_sink(int fd);
+
+#endif // _FILE_IO_H_
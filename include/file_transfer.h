@@ -0,0 +1,39 @@
+#ifndef _FILE_TRANSFER_H_
+#define _FILE_TRANSFER_H_
+
+#include "link_layer.h"
+#include "packet.h"
+#include <stdint.h>
+
+// Transfer of one file over the default link: a START packet, the data
+// packets and an END packet.
+
+struct delta_basis; // Current copy of the file at the receiver (see delta.h)
+
+// Open the default link. With AL_RESUME the receiver offers the bytes of the
+// output file it already holds (see journal_offer).
+int open_link(LinkLayer connection_parameters, const char *filename);
+
+// Handle the receiver role and manage the file reception
+int handle_receiver(const char *filename);
+
+// Receive the data of the file announced by a START packet into filename,
+// up to its END packet (copying blocks from basis, if not NULL)
+int receive_file(const char *filename, const struct file_info *info, const struct delta_basis *basis);
+
+// Handle the transmitter role and manage the file transmission
+int handle_transmitter(const char *filename);
+
+// Send the file at path under the given name: START, data packets and END.
+// A resumable file skips the bytes the receiver offered to keep; next_file
+// tells the receiver another file follows in the session.
+int send_file(const char *path, const char *name, int resumable, int next_file);
+
+// Send data packets from the file (read from map when it is mapped), and
+// give the CRC-32C of the whole file in *checksum
+int send_data_packets(int fd, const unsigned char *map, long long file_size, long long start_offset, uint32_t *checksum);
+
+// I frames that failed: rejected, or timed out at the configured timeout
+int failed_frames(struct ll_statistics statistics);
+
+#endif // _FILE_TRANSFER_H_
@@ -0,0 +1,52 @@
+#ifndef _FRAME_CHECK_H_
+#define _FRAME_CHECK_H_
+
+#include "link_config.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Largest frame check sequence (CRC-32)
+#define MAX_CHECK_SIZE 4
+
+// Check sequence computed over data given in several pieces
+struct frame_check
+{
+    int type;       // LL_CHECK_BCC2, LL_CHECK_CRC16 or LL_CHECK_CRC32
+    uint32_t value; // Check of the data so far, before the final XOR
+};
+
+// Number of check bytes appended to the data of an I frame
+int frame_check_size(int type);
+
+// Start a check sequence of the given type
+void frame_check_begin(struct frame_check *check, int type);
+
+// Add len bytes of data to the check sequence
+void frame_check_update(struct frame_check *check, const unsigned char *data, size_t len);
+
+// Finish the check sequence into bytes (least significant byte first).
+// Returns the number of check bytes.
+int frame_check_end(struct frame_check *check, unsigned char *bytes);
+
+// Compute the check sequence of data into check (least significant byte first).
+// Returns the number of check bytes.
+int frame_check_compute(int type, const unsigned char *data, size_t len, unsigned char *check);
+
+// Returns 1 if check holds the check sequence of data, 0 otherwise
+int frame_check_verify(int type, const unsigned char *data, size_t len, const unsigned char *check);
+
+// CRC-16-CCITT as used by HDLC (CRC-16/X-25: reflected, init and final XOR 0xFFFF)
+uint16_t crc16_ccitt(const unsigned char *data, size_t len);
+
+// CRC-32 as used by HDLC and Ethernet (reflected 0x04C11DB7, init and final XOR 0xFFFFFFFF)
+uint32_t crc32(const unsigned char *data, size_t len);
+
+// CRC-32C (Castagnoli) of data, continuing the CRC-32C crc of the data before
+// it (0 to start), so a file can be checked block by block. Uses the SSE4.2
+// crc32 instruction when the CPU has it (LL_SIMD = 0 forces the tables).
+uint32_t crc32c_update(uint32_t crc, const unsigned char *data, size_t len);
+
+// Name of the CRC-32C implementation in use ("sse4.2" or "scalar")
+const char *crc32c_implementation();
+
+#endif // _FRAME_CHECK_H_
@@ -0,0 +1,60 @@
+#ifndef _FRAME_ENCODER_H_
+#define _FRAME_ENCODER_H_
+
+#include "link_config.h"
+
+// I frame encoder. Everything after the header (whitening, check sequence,
+// Reed-Solomon parity, byte stuffing or COBS and the closing FLAG) depends
+// only on the data and the link parameters, never on the sequence number, so
+// the next frames can be encoded (on another thread, with its own encoder)
+// while the link is still waiting for the acknowledgement of the current one.
+// The header is written in the room left for it when the frame is sent.
+
+struct frame_encoder
+{
+    struct ll_parameters parameters; // Parameters the frames are encoded for
+    unsigned char *message;          // Data and check sequence (FEC or COBS only)
+    unsigned char *encoded;          // The same, with the Reed-Solomon parity bytes (FEC only)
+    unsigned char *whitened;         // Whitening mask and whitened data (whitening only)
+};
+
+// I frame encoded ahead of sending
+struct encoded_frame
+{
+    unsigned char *frame; // Room for the header, then the encoded data (frame_max_size bytes)
+    int size;             // Size of the frame, header included
+    int data_size;        // Size of the data before encoding
+    int escapes_avoided;  // Stuffing escapes saved by whitening
+    int whitened;         // The data starts with a whitening mask
+};
+
+// Size of the header of I frames: FLAG, address, control, sequence number
+// (sliding window only) and BCC1
+int frame_header_size(struct ll_parameters parameters);
+
+// Largest I frame
+int frame_max_size(struct ll_parameters parameters);
+
+// Allocate the buffers of an encoder for frames sent with the given parameters.
+// Returns 1 on success, -1 on failure.
+int frame_encoder_init(struct frame_encoder *encoder, struct ll_parameters parameters);
+
+// Release the buffers of an encoder
+void frame_encoder_free(struct frame_encoder *encoder);
+
+// Encode buf_size bytes of buf (at most the agreed payload) after the room
+// for the header of frame->frame.
+// Returns the size of the frame, or -1 if the data is too large.
+int frame_encode(struct frame_encoder *encoder, const unsigned char *buf, int buf_size, struct encoded_frame *frame);
+
+// Encode the data made of head followed by tail (e.g. a packet header and
+// file data read straight from a mapped file) without joining them first.
+// Returns the size of the frame, or -1 if the data is too large.
+int frame_encode_parts(struct frame_encoder *encoder, const unsigned char *head, int head_size,
+                       const unsigned char *tail, int tail_size, struct encoded_frame *frame);
+
+// Write the header of the I frame with the given sequence number (0 or 1 with
+// stop-and-wait) at the start of frame
+void frame_write_header(struct ll_parameters parameters, int sequence_number, unsigned char *frame);
+
+#endif // _FRAME_ENCODER_H_
@@ -0,0 +1,28 @@
+#ifndef _FRAME_SIZER_H_
+#define _FRAME_SIZER_H_
+
+// Adaptive payload size. The transmitter estimates the byte error rate of the
+// link from the ratio of failed I frames (REJ, SREJ and timeouts at the
+// configured timeout) to I frames sent, and picks the payload that maximises
+// the expected goodput: large frames amortise the per-frame overhead, small
+// ones fail less often.
+struct frame_sizer
+{
+    int size;               // Current payload size
+    int min_size;           // Smallest payload size
+    int max_size;           // Largest payload size (the agreed one)
+    int overhead;           // Bytes spent per frame besides the payload
+    int frames_sent;        // I frames sent at the last update
+    int errors;             // Failed I frames at the last update
+    double byte_error_rate; // Smoothed estimate of the byte error rate
+    int samples;            // Number of estimates taken
+};
+
+// Initialize the sizer; the payload starts at its largest size
+void frame_sizer_init(struct frame_sizer *sizer, int min_size, int max_size, int overhead);
+
+// Update the estimate from the link layer counters (totals since llopen).
+// Returns 1 if the payload size changed, 0 otherwise.
+int frame_sizer_update(struct frame_sizer *sizer, int frames_sent, int errors);
+
+#endif // _FRAME_SIZER_H_
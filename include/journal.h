@@ -0,0 +1,57 @@
+#ifndef _JOURNAL_H_
+#define _JOURNAL_H_
+
+#include "packet.h"
+#include <stdint.h>
+
+// Resume journal (AL_RESUME). The receiver keeps, next to the output file, the
+// number of bytes from the start of the file already written, and offers them
+// in the handshake; the transmitter then sends only the rest.
+
+#define RESUME_OFFER_SIZE 12 // Reply data of the receiver: tag (4 bytes) and committed bytes (8)
+
+// Journal of the file being received (AL_RESUME): every byte before
+// committed is in the output file
+struct journal
+{
+    int fd;              // Journal file, -1 if none is kept
+    uint32_t tag;        // FILE_TAG of the file
+    long long file_size; // Size of the file
+    long long committed; // Bytes at the start of the file already written
+    long long saved;     // Value of committed last written to the journal
+};
+
+// Tag of the file to send: CRC-32 of its name, size and modification time.
+// A file changed since an interrupted transfer gets another tag, so the
+// receiver does not resume it. Never 0, which means no tag.
+uint32_t file_tag(const char *filename, int fd, long long file_size);
+
+// Bytes of the file with the given tag the receiver offered to keep in the
+// handshake of the default link (see journal_offer).
+// Returns the offset to send the file from, 0 to send it all.
+long long resume_offset(uint32_t tag, long long file_size);
+
+// Offer of the receiver in the handshake: the tag and the committed bytes of
+// the journal of the output file, into offer (RESUME_OFFER_SIZE bytes).
+// Returns the size of the offer, 0 if there is nothing to resume.
+int journal_offer(const char *filename, unsigned char *offer);
+
+// Start the journal of a file announced by a START packet, before the output
+// file is opened. Resuming requires the journal offered in the handshake to
+// still commit the bytes the transmitter skips. Without AL_RESUME, or for a
+// file without a tag, no journal is kept (journal->fd = -1).
+// Returns -1 if the transfer cannot go on, 1 otherwise.
+int journal_start(struct journal *journal, const char *filename, const struct file_info *info);
+
+// Record that the first committed bytes of the file are written, saving the
+// journal every AL_JOURNAL_INTERVAL bytes, after flushing the output file
+// (data_fd) to the disk
+void journal_commit(struct journal *journal, int data_fd, long long committed);
+
+// Close the journal of a transfer: removed once the file is complete, saved
+// for the next llopen otherwise. The output file is already closed (and
+// flushed as AL_FSYNC asks); without AL_FSYNC the bytes written since the
+// last save may not be on the disk, so the journal only moves back.
+void journal_finish(struct journal *journal, const char *filename, int complete);
+
+#endif // _JOURNAL_H_
@@ -0,0 +1,209 @@
+// Link layer configuration.
+// Defaults keep the classic stop-and-wait protocol. Every value can be
+// overridden at build time, e.g.: make CFLAGS="-Wall -DLL_WINDOW_SIZE=8"
+// Payload size, window, ARQ mode and frame check are only what this side
+// proposes: llopen agrees on them with the other side (see ll_parameters).
+
+#ifndef _LINK_CONFIG_H_
+#define _LINK_CONFIG_H_
+
+#include "link_layer.h"
+
+// Sequence numbers used by the sliding window protocol are taken modulo this
+// value. Kept below 0x7D so a sequence number never needs byte stuffing.
+#define LL_SEQUENCE_MODULUS 64
+
+// Largest window that still lets the receiver tell a retransmitted frame from
+// a new one (half the sequence number space).
+#define LL_MAX_WINDOW_SIZE (LL_SEQUENCE_MODULUS / 2)
+
+// Largest I frame payload. The application layer sizes its packets from the
+// agreed value (ll_max_payload_size), so larger frames cut the header and
+// acknowledgement overhead on clean links.
+#ifndef LL_MAX_PAYLOAD_SIZE
+#define LL_MAX_PAYLOAD_SIZE MAX_PAYLOAD_SIZE
+#endif
+
+// Bounds of the payload size accepted in the handshake
+#define LL_MIN_PAYLOAD_SIZE 64
+#define LL_PAYLOAD_SIZE_LIMIT 65535
+
+// Number of I frames the transmitter may send before waiting for an RR.
+// 1 selects stop-and-wait with I_FRAME_0/I_FRAME_1 and RR0/RR1 (original
+// protocol); anything larger selects the sliding window protocol given by
+// LL_ARQ_MODE, with extended sequence numbers.
+#ifndef LL_WINDOW_SIZE
+#define LL_WINDOW_SIZE 1
+#endif
+
+// Retransmission strategy used when LL_WINDOW_SIZE > 1:
+//   LL_GO_BACK_N: REJ resends every frame from the rejected one onwards.
+//   LL_SELECTIVE_REPEAT: the receiver buffers frames received out of order and
+//   SREJ resends only the damaged or missing frame; each frame has its own timer.
+#define LL_GO_BACK_N 0
+#define LL_SELECTIVE_REPEAT 1
+
+#ifndef LL_ARQ_MODE
+#define LL_ARQ_MODE LL_GO_BACK_N
+#endif
+
+// Derive the retransmission timeout from the measured round trip time
+// (smoothed RTT + 4 * variation) of I frames, never below the time a frame
+// takes to go out at the baud rate plus the smoothed RTT. The timeout given to
+// llopen is used until the first I frame is acknowledged and becomes the upper
+// bound. 0 always waits for the full configured timeout.
+#ifndef LL_ADAPTIVE_TIMEOUT
+#define LL_ADAPTIVE_TIMEOUT 1
+#endif
+
+// Let the application layer shrink and grow its data packets with the frame
+// error rate seen by the transmitter (see frame_sizer.h). 0 always fills the
+// agreed payload.
+#ifndef LL_ADAPTIVE_PAYLOAD
+#define LL_ADAPTIVE_PAYLOAD 1
+#endif
+
+// Lower bound of the adaptive retransmission timeout, in milliseconds
+#ifndef LL_MIN_TIMEOUT_MS
+#define LL_MIN_TIMEOUT_MS 100
+#endif
+
+// Size of the receive buffer: every read() drains up to this many bytes from
+// the serial port at once
+#ifndef LL_RX_BUFFER_SIZE
+#define LL_RX_BUFFER_SIZE 4096
+#endif
+
+// Check sequence protecting the data of I frames:
+//   LL_CHECK_BCC2: one byte XOR (original protocol). Two flipped bits in the
+//   same position cancel out, so it misses many noise errors.
+//   LL_CHECK_CRC16: CRC-16-CCITT, the HDLC frame check sequence
+//   LL_CHECK_CRC32: CRC-32, for long frames
+#define LL_CHECK_BCC2 0
+#define LL_CHECK_CRC16 1
+#define LL_CHECK_CRC32 2
+
+#ifndef LL_FRAME_CHECK
+#define LL_FRAME_CHECK LL_CHECK_BCC2
+#endif
+
+// Reed-Solomon parity bytes added to each block of up to 255 bytes of I frame
+// data (see fec.h). The receiver repairs up to half as many damaged bytes per
+// block without asking for a retransmission. 0 disables forward error
+// correction; otherwise an even number up to 64.
+#ifndef LL_FEC_PARITY
+#define LL_FEC_PARITY 0
+#endif
+
+// XOR the data of every I frame with the one byte mask that leaves the fewest
+// FLAG and ESC bytes to stuff (see whitening.h). Costs one byte per frame and
+// saves up to half of the frame on data full of FLAG and ESC bytes.
+#ifndef LL_WHITENING
+#define LL_WHITENING 0
+#endif
+
+// Framing of the I frame data:
+//   LL_FRAMING_HDLC: ESC byte stuffing (original protocol). Up to 100%
+//   overhead, depending on how many FLAG and ESC bytes the data holds.
+//   LL_FRAMING_COBS: Consistent Overhead Byte Stuffing (see cobs.h). One byte
+//   per 254 plus one, so the frame length does not depend on the data.
+#define LL_FRAMING_HDLC 0
+#define LL_FRAMING_COBS 1
+
+#ifndef LL_FRAMING
+#define LL_FRAMING LL_FRAMING_HDLC
+#endif
+
+// Use SIMD instructions (SSE2/AVX2, picked at run time) to stuff and destuff
+// frame data. 0 keeps the portable byte by byte code.
+#ifndef LL_SIMD
+#define LL_SIMD 1
+#endif
+
+#if LL_WINDOW_SIZE < 1 || LL_WINDOW_SIZE > LL_MAX_WINDOW_SIZE
+#error "LL_WINDOW_SIZE must be between 1 and LL_MAX_WINDOW_SIZE"
+#endif
+
+#if LL_FRAME_CHECK < LL_CHECK_BCC2 || LL_FRAME_CHECK > LL_CHECK_CRC32
+#error "LL_FRAME_CHECK must be LL_CHECK_BCC2, LL_CHECK_CRC16 or LL_CHECK_CRC32"
+#endif
+
+#if LL_FRAMING != LL_FRAMING_HDLC && LL_FRAMING != LL_FRAMING_COBS
+#error "LL_FRAMING must be LL_FRAMING_HDLC or LL_FRAMING_COBS"
+#endif
+
+#if LL_FEC_PARITY < 0 || LL_FEC_PARITY > 64 || LL_FEC_PARITY % 2 != 0
+#error "LL_FEC_PARITY must be an even number between 0 and 64"
+#endif
+
+#if LL_MAX_PAYLOAD_SIZE < LL_MIN_PAYLOAD_SIZE || LL_MAX_PAYLOAD_SIZE > LL_PAYLOAD_SIZE_LIMIT
+#error "LL_MAX_PAYLOAD_SIZE must be between LL_MIN_PAYLOAD_SIZE and LL_PAYLOAD_SIZE_LIMIT"
+#endif
+
+// Link parameters. Each side proposes its build settings in the SET/UA
+// handshake and both use the agreed ones: the smaller payload and window,
+// Selective Repeat only if both ask for it, the stronger frame check and
+// forward error correction, and COBS framing and whitening if either side
+// asks for them.
+struct ll_parameters
+{
+    int max_payload_size; // Largest I frame payload
+    int window_size;      // I frames in flight (1 = stop-and-wait)
+    int arq_mode;         // LL_GO_BACK_N or LL_SELECTIVE_REPEAT
+    int frame_check;      // LL_CHECK_BCC2, LL_CHECK_CRC16 or LL_CHECK_CRC32
+    int fec_parity;       // Reed-Solomon parity bytes per block (0 = none)
+    int whitening;        // I frame data is whitened (see whitening.h)
+    int framing;          // LL_FRAMING_HDLC or LL_FRAMING_COBS
+};
+
+// Largest application data the receiver may answer the handshake with (see
+// ll_open_reply in link_handle.h)
+#define LL_REPLY_DATA_MAX_SIZE 32
+
+// Largest encoded parameter block (TLVs, reply data and CRC-16)
+#define LL_PARAMETERS_MAX_SIZE (32 + 2 + LL_REPLY_DATA_MAX_SIZE)
+
+// Application data carried by the handshake besides the parameters: the SET
+// asks for it, the UA answers with it
+struct ll_reply
+{
+    int requested;                              // SET: the transmitter asks for reply data
+    unsigned char data[LL_REPLY_DATA_MAX_SIZE]; // UA: data of the receiver
+    int size;                                   // Size of the data (0 = none)
+};
+
+// Parameters proposed by this side (build settings)
+struct ll_parameters ll_proposed_parameters();
+
+// Parameters of the original protocol, used with peers that send a plain SET/UA
+struct ll_parameters ll_legacy_parameters();
+
+// Returns 1 if the parameters are those of the original protocol
+int ll_parameters_are_legacy(struct ll_parameters parameters);
+
+// Agree on the parameters proposed by both sides
+struct ll_parameters ll_merge_parameters(struct ll_parameters a, struct ll_parameters b);
+
+// Encode the parameters and the reply request or data (reply may be NULL)
+// into block (at least LL_PARAMETERS_MAX_SIZE bytes).
+// Returns the size of the block.
+int ll_encode_parameters(struct ll_parameters parameters, const struct ll_reply *reply, unsigned char *block);
+
+// Decode a parameter block, and the reply request or data it carries into
+// reply (may be NULL).
+// Returns -1 if the block is damaged or holds invalid values, 1 otherwise.
+int ll_decode_parameters(const unsigned char *block, int size, struct ll_parameters *parameters, struct ll_reply *reply);
+
+// Parameters in effect on the link last used by this thread (agreed by
+// llopen, see link_handle.h)
+void ll_set_parameters(struct ll_parameters parameters);
+struct ll_parameters ll_agreed_parameters();
+int ll_max_payload_size();
+int ll_window_size();
+int ll_arq_mode();
+int ll_frame_check();
+int ll_fec_parity();
+int ll_whitening();
+int ll_framing();
+
+#endif // _LINK_CONFIG_H_
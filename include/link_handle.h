@@ -0,0 +1,157 @@
+#ifndef _LINK_HANDLE_H_
+#define _LINK_HANDLE_H_
+
+// Handle-based link layer. Each link keeps its own serial port, frame
+// numbers, sliding windows, frame buffers, agreed parameters and statistics,
+// so one process can drive many serial ports. llopen, llwrite, llread and
+// llclose work on a default link.
+//
+// A link must be used by one thread at a time; different links can be used
+// by different threads at once. The calls of the link layer find the link
+// they work on through current_link, set by every ll_* function, so
+// ll_max_payload_size() and the other accessors of link_config.h describe the
+// link last used by the calling thread.
+
+#include "link_layer.h"
+#include "link_config.h"
+#include "state_machine.h"
+#include "rx_buffer.h"
+#include "rtt.h"
+#include "timer.h"
+#include "frame_encoder.h"
+#include <termios.h>
+
+// Sliding window state, used when the agreed window is larger than 1.
+// The arrays hold this side's LL_WINDOW_SIZE slots; the ring uses the agreed window.
+struct tx_window_slot
+{
+    unsigned char *frame;    // Stuffed frame, kept for retransmission
+    int frame_size;          // Size of the stuffed frame
+    struct timer timer;      // Retransmission timer
+    int attempt;             // Timeouts of this frame
+    struct timespec sent_at; // Time of the last transmission
+    int retransmitted;       // Frame was sent more than once (no RTT sample)
+};
+
+struct tx_window
+{
+    struct tx_window_slot slots[LL_WINDOW_SIZE]; // Frames sent and not yet acknowledged
+    int base;                                    // Sequence number of the oldest unacknowledged frame
+    int first_slot;                              // Slot holding the oldest unacknowledged frame
+    int count;                                   // Number of unacknowledged frames
+    struct state_machine machine;                // Parses RR/REJ/SREJ frames across llwrite calls
+};
+
+struct rx_window_slot
+{
+    unsigned char *data; // Payload received out of order
+    int size;            // Size of the payload
+    int received;        // Slot holds a valid frame
+    int rejected;        // SREJ already sent for this frame
+};
+
+struct rx_window
+{
+    struct rx_window_slot slots[LL_WINDOW_SIZE]; // Reorder buffer (Selective Repeat)
+    int first_slot;                              // Slot of the next frame to deliver
+};
+
+// State of one link
+struct ll_link
+{
+    int fd;                           // File descriptor of the serial port
+    struct termios oldtio;            // Serial port settings to restore on closing
+    LinkLayer connection_parameters;  // Connection parameters given to ll_open
+    struct ll_parameters parameters;  // Parameters in effect, legacy until ll_open agrees on others
+    struct ll_statistics statistics;  // Frames and events counted on this link
+    struct rx_buffer rx_buffer;       // Bytes received and not yet processed
+    struct rtt_estimator rtt;         // Round trip time estimate driving the retransmission timeout
+    int frame_number;                 // Current frame number (0 or 1)
+    int frames_received;              // Count of frames received
+    int parameters_exchanged;         // The transmitter sent link parameters with SET, so UA carries the agreed ones
+    struct ll_reply reply;            // Reply data of the handshake: to send (receiver) or received (transmitter)
+
+    // Frame buffers, sized by ll_open for the agreed payload
+    unsigned char *tx_frame;      // Stuffed I frame being sent (stop-and-wait)
+    unsigned char *rx_frame;      // Data and check sequence of the I frame being received
+    int rx_frame_capacity;        // Size of rx_frame
+    struct frame_encoder encoder; // Encodes the I frames of ll_write
+
+    struct tx_window tx_window; // Transmitter window
+    struct rx_window rx_window; // Receiver window
+    int expected_sequence;      // Sequence number of the next frame to deliver (receiver)
+    int reject_sent;            // REJ already sent for the current gap (receiver, Go-Back-N)
+};
+
+// Link used by llopen, llwrite, llread and llclose
+extern struct ll_link ll_default_link;
+
+// Link the calls of this thread work on
+extern _Thread_local struct ll_link *current_link;
+
+// Reset a link to the state of a closed one (legacy parameters, no statistics)
+void ll_link_init(struct ll_link *link);
+
+// Open and configure the serial port of a link.
+// Returns -1 on error, 1 otherwise.
+int ll_link_open_port(struct ll_link *link, const char *serialPort, int baudRate);
+
+// Restore the original settings of the serial port of a link and close it.
+// Returns -1 on error.
+int ll_link_close_port(struct ll_link *link);
+
+// Open a link using the "port" parameters defined in struct linkLayer.
+// Returns the link, or NULL on error.
+struct ll_link *ll_open(LinkLayer connectionParameters);
+
+// Send data in buf with size bufSize.
+// Returns number of chars written, or -1 on error.
+int ll_write(struct ll_link *link, const unsigned char *buf, int bufSize);
+
+// Wait until every I frame sent on a link is acknowledged. With a sliding
+// window ll_write returns as soon as the frame is queued.
+// Returns -1 on error, 1 otherwise.
+int ll_flush(struct ll_link *link);
+
+// Receive data in packet.
+// Returns number of chars read, or -1 on error.
+int ll_read(struct ll_link *link, unsigned char *packet);
+
+// Close a link opened by ll_open and release it.
+// If showStatistics == TRUE, the statistics of the link are printed.
+// Returns 1 on success or -1 on error.
+int ll_close(struct ll_link *link, int showStatistics);
+
+// Send an I frame encoded ahead by frame_encode, with an encoder built for
+// the parameters of the link (ll_link_parameters). The header is written
+// into the room left for it at the start of frame->frame. With a sliding
+// window the link keeps the buffer until the frame is acknowledged, and
+// frame->frame receives another one of frame_max_size bytes instead.
+// Returns the size of the data written, or -1 on error.
+int ll_write_encoded(struct ll_link *link, struct encoded_frame *frame);
+
+// Open a link like ll_open, letting the receiver answer the handshake with
+// application data (size bytes, at most LL_REPLY_DATA_MAX_SIZE; ignored by
+// the transmitter). The transmitter asks for the data in its SET and finds it
+// with ll_link_reply_data. It always proposes link parameters to carry the
+// request, so the receiver must not speak the original protocol only.
+// Returns the link, or NULL on error.
+struct ll_link *ll_open_reply(LinkLayer connectionParameters, const unsigned char *data, int size);
+
+// The same on the default link.
+// Returns -1 on error, 1 otherwise.
+int llopen_reply(LinkLayer connectionParameters, const unsigned char *data, int size);
+
+// Copy the data the receiver answered the handshake of a link with (see
+// ll_open_reply) into data (LL_REPLY_DATA_MAX_SIZE bytes).
+// Returns its size, 0 if the receiver sent none.
+int ll_link_reply_data(struct ll_link *link, unsigned char *data);
+
+// Number of I frames sent on a link and not yet acknowledged, the newest ones
+int ll_link_unacknowledged(struct ll_link *link);
+
+// Statistics and parameters in effect of a link
+struct ll_statistics ll_link_statistics(struct ll_link *link);
+struct ll_parameters ll_link_parameters(struct ll_link *link);
+
+#endif // _LINK_HANDLE_H_
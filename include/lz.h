@@ -0,0 +1,18 @@
+#ifndef _LZ_H_
+#define _LZ_H_
+
+// Small LZ77 block codec (LZ4-like format). Each sequence is a token byte
+// (literal count in the high nibble, match length - 4 in the low nibble),
+// extra length bytes for counts of 15 or more, the literals, and a 2 byte
+// offset (least significant first) with extra match length bytes. The last
+// sequence has literals only.
+
+// Compress len bytes of src into dst (capacity bytes).
+// Returns the compressed size, or -1 if it does not fit in capacity.
+int lz_compress(const unsigned char *src, int len, unsigned char *dst, int capacity);
+
+// Decompress len bytes of src into dst (capacity bytes).
+// Returns the decompressed size, or -1 if the data is damaged or too large.
+int lz_decompress(const unsigned char *src, int len, unsigned char *dst, int capacity);
+
+#endif // _LZ_H_
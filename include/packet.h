@@ -0,0 +1,126 @@
+#ifndef _PACKET_H_
+#define _PACKET_H_
+
+#include "link_handle.h"
+#include "file_checksum.h"
+#include <stdint.h>
+
+// Packets of the application layer: START and END control packets, whose
+// fields are TLVs (type, length, value), and the data packets carrying the
+// blocks of the file.
+
+// Packet types (first byte of every packet)
+#define START 1
+#define DATA 2
+#define END 3
+#define DATA_LZ 4          // Data packet holding an LZ compressed block
+#define DATA_OFFSET 5      // Data packet placed by its file offset
+#define DATA_LZ_OFFSET 6   // The same, holding an LZ compressed block
+#define DATA_OFFSET64 7    // DATA_OFFSET with a 64-bit offset, for blocks past 4 GiB
+#define DATA_LZ_OFFSET64 8 // The same, holding an LZ compressed block
+#define DATA_COPY 9        // Delta sync: copy blocks of the receiver's copy of the file
+#define SIGNATURE 10       // Delta sync: checksums of the blocks of the receiver's copy
+
+// Fields of the control packets (T)
+#define FILE_SIZE 0
+#define FILE_NAME 1
+#define CODEC 2         // Codec of the data packets (START only)
+#define FILE_SIZE_64 3  // File size of 8 bytes, sent instead of FILE_SIZE for files past 2 GiB
+#define FILE_TAG 4      // Identity of the file, to resume its transfer (START only, 4 bytes)
+#define RESUME_OFFSET 5 // First byte of the data packets, when resuming (START only, 8 bytes)
+#define NEXT_FILE 6     // Another file follows this one in the session (START only, 1 byte)
+#define FILE_CHECKSUM 7 // CRC-32C of the whole file (END only, 4 bytes)
+#define BLOCK_SIZE 8    // Block size of a signature (START of a signature only, 4 bytes)
+
+#define CODEC_NONE 0
+#define CODEC_LZ 1
+
+#define DATA_HEADER_SIZE 4        // Header of DATA packets: type, sequence number and size (2 bytes)
+#define OFFSET_HEADER_SIZE 7      // Header of DATA_OFFSET packets: type, offset (4 bytes) and size (2 bytes)
+#define OFFSET64_HEADER_SIZE 11   // Header of DATA_OFFSET64 packets: type, offset (8 bytes) and size (2 bytes)
+#define MAX_OFFSET32 0xFFFFFFFFLL // Largest offset of a DATA_OFFSET packet
+#define PACKET_OVERHEAD 23        // Bytes sent per data packet besides the file data: packet header, frame header, check and RR
+
+// File information of a START packet
+struct file_info
+{
+    long long file_size;                  // Size of the file
+    unsigned char name[MAX_PAYLOAD_SIZE]; // Name of the file
+    int codec;                            // Codec of the data packets
+    uint32_t tag;                         // FILE_TAG, 0 if not sent
+    long long resume_offset;              // RESUME_OFFSET, 0 if not sent
+    int next_file;                        // NEXT_FILE: another file follows in the session
+    int has_checksum;                     // The END packet carries FILE_CHECKSUM
+    uint32_t checksum;                    // FILE_CHECKSUM, CRC-32C of the file
+    int block_size;                       // BLOCK_SIZE of a signature, 0 if not sent
+};
+
+// File information of a file to send under the given name, with the codec
+// of this side. Returns -1 if the name does not fit a FILE_NAME field, 1
+// otherwise.
+int file_info_init(struct file_info *info, const char *name, long long file_size);
+
+// Send a control packet with file information over a link. A START packet
+// also carries the codec, the tag of the file, the offset its data starts
+// from and whether another file follows, when they are set.
+int send_control_packet(struct ll_link *link, int control_byte, const struct file_info *info);
+
+// Read a control packet and extract file information
+int read_control_packet(struct file_info *info);
+
+// Extract file information from a start control packet of the given size.
+// Returns -1 if a field runs past the end of the packet, the file sizes sent
+// disagree or the resume offset is past the end of the file, 1 otherwise.
+int parse_control_packet(const unsigned char *control_packet, int size, struct file_info *info);
+
+// Value of a FILE_SIZE or FILE_SIZE_64 field, least significant byte first.
+// Returns -1 if it does not fit in 63 bits.
+long long decode_file_size(const unsigned char *value, int length);
+
+// Check the end packet for consistency with the start packet
+int check_end_packet(unsigned char *control_packet, int data_size, const unsigned char *filename, long long file_size);
+
+// Check the FILE_CHECKSUM of an END packet against the file received. Files
+// from transmitters that send none, or that could not be read back, are not
+// checked.
+// Returns -1 if the file is damaged, 1 otherwise.
+int check_file_checksum(const unsigned char *control_packet, int data_size, const struct file_checksum *checksum);
+
+// Size of the header of a data packet of the given type, 0 if the type is
+// not a data packet
+int data_header_size(int type);
+
+// Largest header of the data packets of a file: files past 4 GiB need 64-bit
+// offsets for their last blocks
+int offset_header_size(long long file_size);
+
+// Fill the header of the data packet of a block at the given offset: DATA_OFFSET
+// or DATA_LZ_OFFSET, or their 64-bit forms past 4 GiB. The header has room for
+// OFFSET64_HEADER_SIZE bytes.
+// Returns the size of the header.
+int build_offset_header(unsigned char *header, int compressed, long long offset, int data_size);
+
+// Write the data of a data packet to the file at its offset: the one carried
+// by DATA_OFFSET packets (of either width), or *offset for DATA and DATA_LZ
+// packets. Compressed data is decompressed into block (block_size bytes).
+// Data that would not fit in the file_size bytes announced is refused, as
+// a damaged offset would grow the file or overwrite another block.
+// The data written is added to checksum, if not NULL.
+// Returns the number of file bytes written, with their offset in *offset,
+// or -1 on error.
+int write_data_packet(int fd, const unsigned char *packet, int size, unsigned char *block, int block_size,
+                      long long file_size, long long *offset, struct file_checksum *checksum);
+
+// Write value into length bytes, least significant byte first
+void put_le(unsigned char *bytes, unsigned long long value, int length);
+
+// Read a value of length bytes, least significant byte first
+unsigned long long get_le(const unsigned char *bytes, int length);
+
+// Write value into length bytes, most significant byte first (packet headers)
+void put_be(unsigned char *bytes, unsigned long long value, int length);
+
+// Read a value of length bytes, most significant byte first
+unsigned long long get_be(const unsigned char *bytes, int length);
+
+#endif // _PACKET_H_
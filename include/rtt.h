@@ -0,0 +1,32 @@
+#ifndef _RTT_H_
+#define _RTT_H_
+
+// Round trip time estimator (Jacobson/Karels, as in RFC 6298).
+// All times are in milliseconds.
+struct rtt_estimator
+{
+    double srtt;   // Smoothed round trip time
+    double rttvar; // Round trip time variation
+    int rto;       // Current retransmission timeout
+    int min_rto;   // Lower bound for the timeout
+    int max_rto;   // Upper bound for the timeout (the configured link timeout)
+    int samples;   // Number of round trip times measured
+};
+
+// Initialize the estimator; the timeout starts at its upper bound
+void rtt_init(struct rtt_estimator *rtt, int min_rto, int max_rto);
+
+// Add a round trip time measured on a frame that was sent only once (Karn's rule)
+void rtt_sample(struct rtt_estimator *rtt, int sample);
+
+// Timeout for a frame that takes transmission_ms to go out at the baud rate:
+// never below that time plus the smoothed round trip, so a long frame is not
+// resent while still on the wire when the estimate came from shorter frames
+int rtt_timeout(const struct rtt_estimator *rtt, int transmission_ms);
+
+// Double the timeout after a retransmission timeout (exponential backoff).
+// Returns 1 if the timeout that expired had already reached its upper bound:
+// only those count as failed attempts, earlier ones may just be a low estimate.
+int rtt_backoff(struct rtt_estimator *rtt);
+
+#endif // _RTT_H_
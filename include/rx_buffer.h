@@ -0,0 +1,30 @@
+#ifndef _RX_BUFFER_H_
+#define _RX_BUFFER_H_
+
+#include "link_config.h"
+#include "state_machine.h"
+#include "timer.h"
+#include <stddef.h>
+
+// Ring buffer of bytes read from the serial port and not yet processed, one
+// per link (see link_handle.h).
+// Bytes left over after a complete frame stay here for the next one.
+struct rx_buffer
+{
+    unsigned char data[LL_RX_BUFFER_SIZE]; // Received bytes
+    size_t start;                          // Index of the first unprocessed byte
+    size_t size;                           // Number of unprocessed bytes
+};
+
+// Read every byte available on the serial port (as many as fit) with a single
+// read(), sleeping first until data arrives or the timer expires.
+// A NULL or stopped timer waits with no time limit.
+// Returns -1 on error, 0 on timeout, otherwise the number of bytes read.
+int rx_buffer_fill(const struct timer *timer);
+
+// Run the state machine over the received bytes until it completes a frame,
+// reading more from the serial port whenever the buffer runs dry.
+// Returns -1 on error, 0 if the timer expired first, 1 when the machine reaches STP.
+int rx_buffer_receive_frame(struct state_machine *machine, const struct timer *timer);
+
+#endif // _RX_BUFFER_H_
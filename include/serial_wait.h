@@ -0,0 +1,11 @@
+#ifndef _SERIAL_WAIT_H_
+#define _SERIAL_WAIT_H_
+
+#include "timer.h"
+
+// Block until the serial port of the current link has data to read or the timer expires.
+// A NULL or stopped timer waits with no time limit.
+// Returns -1 on error, 0 on timeout, 1 if data is available.
+int waitSerialPort(const struct timer *timer);
+
+#endif // _SERIAL_WAIT_H_
@@ -0,0 +1,43 @@
+#ifndef _SPSC_RING_H_
+#define _SPSC_RING_H_
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Single producer, single consumer ring of pointers, linking two stages of a
+// pipeline that run on different threads. Pushing and popping only touch two
+// atomic counters; the mutex and condition variable are used only when one
+// side has to sleep because the ring is full or empty.
+
+struct spsc_ring
+{
+    void **items;           // Ring of capacity items
+    unsigned capacity;      // Power of two
+    atomic_uint head;       // Items popped (consumer)
+    atomic_uint tail;       // Items pushed (producer)
+    atomic_int closed;      // No more pushes; set by either side
+    atomic_int waiters;     // Threads sleeping (or about to) on changed
+    pthread_mutex_t lock;   // Only held to sleep and to wake up
+    pthread_cond_t changed; // An item was pushed or popped, or the ring closed
+};
+
+// Allocate a ring for at least capacity items.
+// Returns 1 on success, -1 on failure.
+int spsc_ring_init(struct spsc_ring *ring, unsigned capacity);
+
+// Release the ring
+void spsc_ring_destroy(struct spsc_ring *ring);
+
+// Add an item, waiting while the ring is full.
+// Returns 1 on success, -1 if the ring was closed.
+int spsc_ring_push(struct spsc_ring *ring, void *item);
+
+// Take the oldest item, waiting while the ring is empty.
+// Returns NULL once the ring is closed and empty.
+void *spsc_ring_pop(struct spsc_ring *ring);
+
+// Close the ring: the producer ends the stream (the consumer still gets the
+// items already pushed), or the consumer stops taking items (pushes fail)
+void spsc_ring_close(struct spsc_ring *ring);
+
+#endif // _SPSC_RING_H_
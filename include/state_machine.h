@@ -2,16 +2,20 @@
 #define _STATE_MACHINE_H_
 
 #include "link_layer.h"
+#include "link_config.h"
+#include "frame_check.h"
+#include <stddef.h>
 
 // Enumeration for the different states of the state machine
 enum state_machine_state
 {
-    START,    // Initial state, waiting for FLAG
-    FLAG_RCV, // FLAG received, waiting for Address byte
-    A_RCV,    // Address byte received, waiting for Control byte
-    C_RCV,    // Control byte received, waiting for BCC1
-    BCC1_OK,  // BCC1 validated, waiting for data or FLAG
-    STP       // STOP state, end of frame processing
+    START,     // Initial state, waiting for FLAG
+    FLAG_RCV,  // FLAG received, waiting for Address byte
+    A_RCV,     // Address byte received, waiting for Control byte
+    C_EXT_RCV, // Extended control byte received, waiting for sequence number
+    C_RCV,     // Control byte received, waiting for BCC1
+    BCC1_OK,   // BCC1 validated, waiting for data or FLAG
+    STP        // STOP state, end of frame processing
 };
 
 // Enumeration for the different types of state machines
@@ -30,14 +34,17 @@ struct state_machine
     unsigned char control_byte;                  // Control byte for the current frame
     unsigned char address_byte;                  // Address byte for the current frame
     enum state_machine_state state;              // Current state of the state machine
-    unsigned char buf[MAX_PAYLOAD_SIZE * 2 + 2]; // Buffer for storing incoming data
+    unsigned char *buf;                          // Buffer for storing incoming data (and the check sequence)
+    int buf_capacity;                            // Size of the buffer (0 for frames without data)
     int buf_size;                                // Current size of the buffer
     unsigned char BCC1;                          // BCC1 value for error checking
     unsigned char BCC2;                          // BCC2 value for error checking
     unsigned char escape_sequence;               // Flag to indicate if an escape sequence is in progress
     unsigned char REJ;                           // REJ flag to indicate a rejection
+    unsigned char SREJ;                          // SREJ flag to indicate a selective rejection
     unsigned char ACK;                           // ACK flag to indicate acknowledgment
     unsigned char duplicate;                     // Flag to indicate a duplicate frame
+    unsigned char sequence_number;               // Sequence number of an extended (sliding window) frame
 };
 
 // Structure to hold statistics related to link layer operations
@@ -51,6 +58,8 @@ struct ll_statistics
     int num_RR_received;           // Number of RR frames received
     int num_REJ_sent;              // Number of REJ frames sent
     int num_REJ_received;          // Number of REJ frames received
+    int num_SREJ_sent;             // Number of SREJ frames sent
+    int num_SREJ_received;         // Number of SREJ frames received
     int num_I_frames_sent;         // Number of I frames sent
     int num_I_frames_received;     // Number of I frames received
     int num_DISC_sent;             // Number of DISC frames sent
@@ -58,8 +67,13 @@ struct ll_statistics
     int num_duplicated_frames;     // Number of duplicated frames detected
     int num_retransmissions;       // Number of retransmissions
     int num_timeouts;              // Number of timeouts
+    int num_full_timeouts;         // Number of I frame timeouts at the configured timeout
     int num_invalid_BCC1_received; // Number of invalid BCC1 received
     int num_invalid_BCC2_received; // Number of invalid BCC2 received
+    int num_FEC_repaired_frames;   // Number of I frames repaired by forward error correction
+    int num_FEC_repaired_bytes;    // Number of bytes repaired by forward error correction
+    int num_escapes_avoided;       // Number of stuffing escapes avoided by whitening
+    int num_whitening_masks_sent;  // Number of whitening mask bytes sent
 };
 
 // Constants defining special bytes used in the protocol
@@ -80,17 +94,37 @@ struct ll_statistics
 #define RR1 0xAB                            // Control byte for RR frame 1
 #define REJ0 0x54                           // Control byte for REJ frame 0
 #define REJ1 0x55                           // Control byte for REJ frame 1
+#define I_FRAME_N 0xC0                      // Control byte for sliding window I frame (sequence number follows)
+#define RR_N 0xE0                           // Control byte for sliding window RR frame (sequence number follows)
+#define REJ_N 0xD0                          // Control byte for sliding window REJ frame (sequence number follows)
+#define SREJ_N 0xF0                         // Control byte for selective reject frame (sequence number follows)
 
-// Extern declaration of statistics structure
-extern struct ll_statistics statistics;
+// Extended control bytes are followed by a sequence number, which is also covered by BCC1.
+// Their values keep A ^ C ^ sequence_number clear of FLAG and ESC.
+#define IS_EXTENDED_CONTROL(c) ((c) == I_FRAME_N || (c) == RR_N || (c) == REJ_N || (c) == SREJ_N)
+
+// Worst case size of n bytes after byte stuffing (every byte escaped)
+#define MAX_STUFFED_SIZE(n) ((n) * 2)
+
+// Largest I frame on the wire for a given payload size:
+// stuffed (data + check sequence) + (F; A; C; N; BCC1) + F
+#define FRAME_SIZE_BOUND(payload_size) (MAX_STUFFED_SIZE((payload_size) + MAX_CHECK_SIZE) + 6)
+
+// Copy of the statistics of the current link (see link_handle.h), for the application layer
+struct ll_statistics ll_get_statistics();
 
 // Function declarations for state machine operations
 void create_state_machine(struct state_machine *machine, enum state_machine_type type, unsigned char control_byte, unsigned char address_byte, enum state_machine_state state);
+void state_machine_use_buffer(struct state_machine *machine, unsigned char *buf, int capacity);
 void process_read_BCC1_OK(struct state_machine *machine, unsigned char byte);
+void process_information_BCC1_OK(struct state_machine *machine, unsigned char byte);
+size_t process_read_BCC1_OK_span(struct state_machine *machine, const unsigned char *buf, size_t len);
 void state_machine(struct state_machine *machine, unsigned char byte);
+size_t state_machine_feed(struct state_machine *machine, const unsigned char *buf, size_t len);
 void state_machine_START(struct state_machine *machine, unsigned char byte);
 void state_machine_FLAG_RCV(struct state_machine *machine, unsigned char byte);
 void state_machine_A_RCV(struct state_machine *machine, unsigned char byte);
+void state_machine_C_EXT_RCV(struct state_machine *machine, unsigned char byte);
 void state_machine_C_RCV(struct state_machine *machine, unsigned char byte);
 void state_machine_BCC1_OK(struct state_machine *machine, unsigned char byte);
 
@@ -0,0 +1,34 @@
+#ifndef _TIMER_H_
+#define _TIMER_H_
+
+#include <time.h>
+
+// Timer based on a CLOCK_MONOTONIC deadline.
+// Needs no signal handler or global flag, so any number of timers can run at
+// once, with sub-millisecond resolution.
+struct timer
+{
+    struct timespec deadline; // Time at which the timer expires
+    int running;              // Set while the timer is started and not stopped
+};
+
+// Start (or restart) the timer to expire the given number of milliseconds from now
+void timer_start(struct timer *timer, int milliseconds);
+
+// Stop the timer; a stopped timer never expires
+void timer_stop(struct timer *timer);
+
+// Returns 1 if the timer is running and its deadline has passed, 0 otherwise
+int timer_expired(const struct timer *timer);
+
+// Milliseconds left until the timer expires, rounded up (0 if already expired).
+// Returns -1 if the timer is not running.
+int timer_remaining_ms(const struct timer *timer);
+
+// Read the monotonic clock
+void timer_now(struct timespec *now);
+
+// Milliseconds elapsed since "since" (read with timer_now)
+int elapsed_ms(const struct timespec *since);
+
+#endif // _TIMER_H_
@@ -0,0 +1,48 @@
+#ifndef _TX_PIPELINE_H_
+#define _TX_PIPELINE_H_
+
+#include "app_config.h"
+#include "compress_pool.h"
+#include "frame_encoder.h"
+#include "spsc_ring.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+// Transmit pipeline. A reader thread fills file blocks, compressed by the
+// compression pool; a framer thread builds the data packets and encodes their
+// frames (stuffing and check sequence); the calling thread writes the frames
+// to the link. The framer and the writer exchange frames through single
+// producer, single consumer rings, so the next frame is ready as soon as the
+// link takes it.
+struct tx_pipeline
+{
+    int fd;                                         // File being sent
+    const unsigned char *map;                       // Its contents, or NULL if it is read instead (see map_file)
+    long long file_size;                            // Size of the file
+    long long start_offset;                         // First byte to send (resumed transfers)
+    uint32_t checksum;                              // CRC-32C of the file, computed by the reader
+    struct compress_pool pool;                      // File blocks in order (reader to framer)
+    struct frame_encoder encoder;                   // Encoder of the framer
+    struct encoded_frame frames[AL_PIPELINE_DEPTH]; // Frame buffers
+    struct spsc_ring ready;                         // Encoded frames (framer to writer)
+    struct spsc_ring sent;                          // Frame buffers free again (writer to framer)
+    atomic_int block_size;                          // Size of the next blocks, from the frame sizer of the writer
+    int failed;                                     // The framer could not encode a packet
+    pthread_t reader;
+    pthread_t framer;
+};
+
+// Allocate the buffers of the pipeline and start the reader and the framer,
+// reading blocks of block_size bytes from the file (or from map, if mapped)
+// from start_offset on.
+// Returns 1 on success, -1 on failure.
+int tx_pipeline_start(struct tx_pipeline *pipeline, int fd, const unsigned char *map, long long file_size,
+                      long long start_offset, int block_size);
+
+// Stop the reader and the framer (early if the writer gave up) and release
+// the pipeline.
+// Returns -1 if the file could not be read or encoded, 1 otherwise.
+int tx_pipeline_stop(struct tx_pipeline *pipeline);
+
+#endif // _TX_PIPELINE_H_
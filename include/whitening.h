@@ -0,0 +1,17 @@
+#ifndef _WHITENING_H_
+#define _WHITENING_H_
+
+#include <stddef.h>
+
+// Payload whitening: the data of an I frame is XORed with a one byte mask
+// chosen so that as few bytes as possible become FLAG or ESC and need byte
+// stuffing. The mask is sent as the first data byte (0 leaves the data as is).
+
+// Pick the mask that leaves the fewest FLAG and ESC bytes in data.
+// escapes receives that number, escapes_before the number without a mask.
+unsigned char whitening_choose_mask(const unsigned char *data, size_t len, int *escapes, int *escapes_before);
+
+// XOR len bytes of src with mask into dst; dst may be src or start before it
+void whitening_apply(unsigned char *dst, const unsigned char *src, size_t len, unsigned char mask);
+
+#endif // _WHITENING_H_
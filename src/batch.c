@@ -0,0 +1,287 @@
+#include "batch.h"
+#include "file_transfer.h"
+#include "packet.h"
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// Files of a batch session: a directory tree, or the files of a list
+struct batch
+{
+    char **paths;   // Paths of the files to send
+    int count;      // Number of files
+    int capacity;   // Size of paths
+    int name_start; // Characters of each path before the name sent in its control packets
+};
+
+// Helper Functions prototypes
+int batch_load(struct batch *batch, const char *filename);
+int batch_add(struct batch *batch, const char *path);
+int batch_add_tree(struct batch *batch, const char *directory);
+int batch_add_list(struct batch *batch, const char *list);
+int compare_paths(const void *a, const void *b);
+void batch_free(struct batch *batch);
+int batch_name_is_safe(const char *name);
+int make_parent_directories(const char *path);
+
+// Returns TRUE if filename names a batch of files: a directory (where the
+// receiver puts them), or a BATCH_LIST_PREFIX list of files (transmitter)
+int is_batch(const char *filename, LinkLayerRole role)
+{
+    struct stat status;
+    if (role == LlTx && filename[0] == BATCH_LIST_PREFIX)
+        return TRUE;
+    return stat(filename, &status) == 0 && S_ISDIR(status.st_mode);
+}
+
+// Send every file of a batch in this session, named by their paths relative
+// to the directory (or as listed). Each START but the last carries NEXT_FILE.
+int handle_batch_transmitter(const char *filename)
+{
+    struct batch batch;
+    if (batch_load(&batch, filename) < 0)
+        return -1; // Error reading the directory or the list
+
+    int result = 1;
+    if (batch.count == 0)
+    {
+        printf("No files to send in %s\n", filename);
+        result = -1;
+    }
+
+    // The receiver refuses names that leave its directory: check them all first
+    for (int i = 0; i < batch.count && result > 0; i++)
+    {
+        if (!batch_name_is_safe(batch.paths[i] + batch.name_start))
+        {
+            printf("Cannot send %s: names must be relative paths without \"..\"\n", batch.paths[i]);
+            result = -1;
+        }
+    }
+
+    for (int i = 0; i < batch.count && result > 0; i++)
+    {
+        const char *name = batch.paths[i] + batch.name_start;
+        if (send_file(batch.paths[i], name, FALSE, i + 1 < batch.count) < 0)
+            result = -1;
+        else
+            printf("Sent %s (%d of %d).\n", name, i + 1, batch.count);
+    }
+
+    batch_free(&batch);
+    return result;
+}
+
+// Receive files into a directory, recreating the paths their FILE_NAME
+// fields give, until a START without NEXT_FILE. A single file (no NEXT_FILE)
+// is received into the directory the same way.
+int handle_batch_receiver(const char *directory)
+{
+    struct file_info info;
+    int files = 0;
+
+    do
+    {
+        if (read_control_packet(&info) < 0)
+            return -1; // Error reading control packet
+
+        char path[PATH_MAX];
+        const char *name = (const char *)info.name;
+        if (!batch_name_is_safe(name))
+        {
+            printf("Refusing to write outside %s: %s\n", directory, name);
+            return -1;
+        }
+        if (snprintf(path, PATH_MAX, "%s/%s", directory, name) >= PATH_MAX)
+        {
+            printf("Path too long: %s/%s\n", directory, name);
+            return -1;
+        }
+        if (make_parent_directories(path) < 0 || receive_file(path, &info, NULL) < 0)
+            return -1;
+        printf("Received %s (%lld bytes).\n", path, info.file_size);
+        files++;
+    } while (info.next_file);
+
+    printf("Received %d files.\n", files);
+    return 1;
+}
+
+// Collect the files of a batch: the regular files under a directory, or the
+// files named by a list, in name order.
+// Returns -1 on error, 1 otherwise.
+int batch_load(struct batch *batch, const char *filename)
+{
+    memset(batch, 0, sizeof(struct batch));
+
+    int result;
+    if (filename[0] == BATCH_LIST_PREFIX)
+        result = batch_add_list(batch, filename + 1);
+    else
+    {
+        batch->name_start = strlen(filename) + 1; // Names start after "directory/"
+        result = batch_add_tree(batch, filename);
+    }
+
+    if (result < 0)
+    {
+        batch_free(batch);
+        return -1;
+    }
+    qsort(batch->paths, batch->count, sizeof(char *), compare_paths);
+    return 1;
+}
+
+// Add a copy of path to the batch.
+// Returns -1 on error, 1 otherwise.
+int batch_add(struct batch *batch, const char *path)
+{
+    if (batch->count == batch->capacity)
+    {
+        int capacity = batch->capacity > 0 ? 2 * batch->capacity : 16;
+        char **paths = realloc(batch->paths, capacity * sizeof(char *));
+        if (paths == NULL)
+        {
+            printf("Failed to allocate the batch.\n");
+            return -1;
+        }
+        batch->paths = paths;
+        batch->capacity = capacity;
+    }
+
+    batch->paths[batch->count] = strdup(path);
+    if (batch->paths[batch->count] == NULL)
+    {
+        printf("Failed to allocate the batch.\n");
+        return -1;
+    }
+    batch->count++;
+    return 1;
+}
+
+// Add the regular files under a directory, walking into its subdirectories.
+// Symbolic links and special files are skipped.
+// Returns -1 on error, 1 otherwise.
+int batch_add_tree(struct batch *batch, const char *directory)
+{
+    DIR *dir = opendir(directory);
+    if (dir == NULL)
+    {
+        printf("Error opening directory: %s\n", directory);
+        return -1;
+    }
+
+    int result = 1;
+    struct dirent *entry;
+    while (result > 0 && (entry = readdir(dir)) != NULL)
+    {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+
+        char path[PATH_MAX];
+        struct stat status;
+        if (snprintf(path, PATH_MAX, "%s/%s", directory, entry->d_name) >= PATH_MAX)
+        {
+            printf("Path too long: %s/%s\n", directory, entry->d_name);
+            result = -1;
+        }
+        else if (lstat(path, &status) < 0)
+        {
+            printf("Error reading file: %s\n", path);
+            result = -1;
+        }
+        else if (S_ISDIR(status.st_mode))
+            result = batch_add_tree(batch, path);
+        else if (S_ISREG(status.st_mode))
+            result = batch_add(batch, path);
+    }
+
+    closedir(dir);
+    return result;
+}
+
+// Add the files named by a list, one path per line (empty lines skipped).
+// Returns -1 on error, 1 otherwise.
+int batch_add_list(struct batch *batch, const char *list)
+{
+    FILE *file = fopen(list, "r");
+    if (file == NULL)
+    {
+        printf("Error opening file list: %s\n", list);
+        return -1;
+    }
+
+    int result = 1;
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    while (result > 0 && (length = getline(&line, &capacity, file)) >= 0)
+    {
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+            line[--length] = '\0';
+        if (length > 0)
+            result = batch_add(batch, line);
+    }
+
+    free(line);
+    fclose(file);
+    return result;
+}
+
+// Order of the files of a batch
+int compare_paths(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Release the paths of a batch
+void batch_free(struct batch *batch)
+{
+    for (int i = 0; i < batch->count; i++)
+        free(batch->paths[i]);
+    free(batch->paths);
+    memset(batch, 0, sizeof(struct batch));
+}
+
+// Returns TRUE if a received name stays inside the output directory: a
+// relative path with no empty or ".." component
+int batch_name_is_safe(const char *name)
+{
+    if (name[0] == '\0' || name[0] == '/')
+        return FALSE;
+
+    const char *component = name;
+    while (component != NULL)
+    {
+        const char *end = strchr(component, '/');
+        int length = end != NULL ? end - component : (int)strlen(component);
+        if (length == 0 || (length == 2 && component[0] == '.' && component[1] == '.'))
+            return FALSE;
+        component = end != NULL ? end + 1 : NULL;
+    }
+    return TRUE;
+}
+
+// Create the missing directories leading to path.
+// Returns -1 on error, 1 otherwise.
+int make_parent_directories(const char *path)
+{
+    char directory[PATH_MAX];
+    strcpy(directory, path);
+
+    for (char *slash = strchr(directory + 1, '/'); slash != NULL; slash = strchr(slash + 1, '/'))
+    {
+        *slash = '\0';
+        if (mkdir(directory, 0755) < 0 && errno != EEXIST)
+        {
+            printf("Error creating directory: %s\n", directory);
+            return -1;
+        }
+        *slash = '/';
+    }
+    return 1;
+}
@@ -0,0 +1,667 @@
+#include "bond.h"
+#include "app_config.h"
+#include "file_io.h"
+#include "file_transfer.h"
+#include "frame_encoder.h"
+#include "frame_sizer.h"
+#include "lz.h"
+#include "packet.h"
+#include "timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Helper Functions prototypes
+int bond_transmit(struct bond *bond);
+int bond_receive(struct bond *bond, int wait_seconds);
+void *bond_transmitter(void *arg);
+void *bond_receiver(void *arg);
+int bond_next_chunk(struct bond *bond, struct bond_link *bl, int size, struct bond_chunk *chunk);
+int bond_should_wait(struct bond *bond, struct bond_link *bl, int size);
+void bond_chunk_done(struct bond *bond, struct bond_link *bl, struct bond_chunk chunk, int sent);
+void bond_chunk_sent(struct bond *bond, struct bond_link *bl, struct bond_chunk chunk);
+void bond_acknowledge(struct bond *bond, struct bond_link *bl, int unacknowledged);
+int bond_flush(struct bond *bond, struct bond_link *bl);
+void bond_give_back(struct bond *bond, struct bond_link *bl);
+int bond_send_chunk(struct bond_link *bl, struct bond_chunk chunk, struct frame_encoder *encoder,
+                    struct encoded_frame *frame, unsigned char *raw, unsigned char *packed);
+int bond_write_chunk(struct bond_link *bl, const unsigned char *packet, int size, unsigned char *block);
+int bond_add_range(struct bond *bond, long long offset, int size);
+void bond_print_links(struct bond *bond);
+
+// Transfer a file over several serial ports ("port1,port2,..."), one link per
+// port. Both sides must list the ports in matching order.
+// Returns -1 on error, 1 otherwise.
+int bonded_transfer(const char *serialPorts, LinkLayer connection_parameters, const char *filename)
+{
+    struct bond *bond = malloc(sizeof(struct bond));
+    char *ports = strdup(serialPorts);
+    if (bond == NULL || ports == NULL)
+    {
+        printf("Failed to allocate bonded transfer.\n");
+        free(bond);
+        free(ports);
+        return -1;
+    }
+    memset(bond, 0, sizeof(struct bond));
+
+    // One link per port, with the same parameters
+    for (char *port = strtok(ports, ","); port != NULL; port = strtok(NULL, ","))
+    {
+        if (bond->num_links == AL_MAX_LINKS || strlen(port) >= sizeof(connection_parameters.serialPort))
+        {
+            printf("Too many serial ports or port name too long: %s\n", port);
+            free(bond);
+            free(ports);
+            return -1;
+        }
+        struct bond_link *bl = &bond->links[bond->num_links];
+        bl->bond = bond;
+        bl->index = bond->num_links++;
+        bl->connection_parameters = connection_parameters;
+        strcpy(bl->connection_parameters.serialPort, port);
+    }
+    free(ports);
+
+    // Timed waits use the same clock as the link layer timers
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&bond->changed, &attributes);
+    pthread_condattr_destroy(&attributes);
+    pthread_mutex_init(&bond->lock, NULL);
+    bond->filename = filename;
+    bond->file_size = -1;
+    bond->result = 1;
+
+    int abandoned = 0; // Receiver threads still blocked on a link
+    if (connection_parameters.role == LlTx)
+        bond_transmit(bond);
+    else
+        abandoned = bond_receive(bond, connection_parameters.nRetransmissions * connection_parameters.timeout);
+
+    bond_print_links(bond);
+    int result = bond->result;
+
+    // Threads left behind still use the bond
+    if (abandoned == 0)
+    {
+        pthread_mutex_destroy(&bond->lock);
+        pthread_cond_destroy(&bond->changed);
+        free(bond->received);
+        free(bond);
+    }
+    return result;
+}
+
+// Send the file with one thread per link
+// Returns -1 on error, 1 otherwise (also stored in bond->result).
+int bond_transmit(struct bond *bond)
+{
+    bond->fd = open_file_source(bond->filename, &bond->file_size, &bond->map);
+    if (bond->fd < 0)
+    {
+        bond->result = -1;
+        return -1;
+    }
+
+    int started = 0;
+    for (; started < bond->num_links; started++)
+    {
+        if (pthread_create(&bond->links[started].thread, NULL, bond_transmitter, &bond->links[started]) != 0)
+        {
+            printf("Failed to start the thread of %s.\n", bond->links[started].connection_parameters.serialPort);
+            break;
+        }
+    }
+
+    // Links that did not start give up at once
+    pthread_mutex_lock(&bond->lock);
+    for (int i = started; i < bond->num_links; i++)
+        bond->links[i].failed = bond->links[i].finished = TRUE;
+    pthread_cond_broadcast(&bond->changed);
+    pthread_mutex_unlock(&bond->lock);
+
+    for (int i = 0; i < started; i++)
+        pthread_join(bond->links[i].thread, NULL);
+
+    // Chunks given back by failed links and never taken again
+    long long unsent = bond->file_size - bond->next_offset;
+    for (int i = 0; i < bond->num_retry; i++)
+        unsent += bond->retry[i].size;
+    if (unsent > 0)
+    {
+        printf("%lld bytes of %s could not be sent.\n", unsent, bond->filename);
+        bond->result = -1;
+    }
+
+    close_file_source(bond->fd, bond->map, bond->file_size);
+    return bond->result;
+}
+
+// Receive the file with one thread per link. Once every byte is written, the
+// links still waiting for their END packet get wait_seconds to finish.
+// Returns the number of threads left behind, blocked on a link.
+int bond_receive(struct bond *bond, int wait_seconds)
+{
+    bond->fd = open_file_sink(bond->filename, TRUE);
+    if (bond->fd < 0)
+    {
+        bond->result = -1;
+        return 0;
+    }
+
+    int started = 0;
+    for (; started < bond->num_links; started++)
+    {
+        if (pthread_create(&bond->links[started].thread, NULL, bond_receiver, &bond->links[started]) != 0)
+        {
+            printf("Failed to start the thread of %s.\n", bond->links[started].connection_parameters.serialPort);
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&bond->lock);
+    bond->finished_links += bond->num_links - started;
+    while (bond->finished_links < bond->num_links &&
+           (bond->file_size < 0 || bond->received_bytes < bond->file_size))
+        pthread_cond_wait(&bond->changed, &bond->lock);
+
+    // Every byte is in: a link whose transmitter died never sees END
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += wait_seconds;
+    while (bond->finished_links < bond->num_links)
+    {
+        if (pthread_cond_timedwait(&bond->changed, &bond->lock, &deadline) != 0)
+            break; // Timed out
+    }
+
+    long long file_size = bond->file_size;
+    long long received_bytes = bond->received_bytes;
+    int abandoned = 0;
+    for (int i = 0; i < started; i++)
+    {
+        if (bond->links[i].finished)
+            continue;
+        printf("No END packet on %s, giving up on the link.\n", bond->links[i].connection_parameters.serialPort);
+        pthread_detach(bond->links[i].thread);
+        abandoned++;
+    }
+    pthread_mutex_unlock(&bond->lock);
+
+    for (int i = 0; i < started; i++)
+    {
+        if (bond->links[i].finished)
+            pthread_join(bond->links[i].thread, NULL);
+    }
+
+    if (file_size < 0 || received_bytes != file_size)
+    {
+        printf("Received %lld of %lld bytes.\n", received_bytes, file_size);
+        bond->result = -1;
+    }
+
+    // Threads left behind may still write to the file
+    if (abandoned == 0 && close_file_sink(bond->fd) < 0)
+        bond->result = -1;
+    return abandoned;
+}
+
+// Thread sending chunks of the file over one link, until no chunk is left
+void *bond_transmitter(void *arg)
+{
+    struct bond_link *bl = arg;
+    struct bond *bond = bl->bond;
+    int result = -1;
+
+    bl->link = ll_open(bl->connection_parameters);
+    if (bl->link == NULL)
+    {
+        printf("Failed to open connection on %s.\n", bl->connection_parameters.serialPort);
+    }
+    else
+    {
+        // Packets fill the agreed payload of this link; their frames are
+        // encoded straight from the mapped file
+        struct ll_parameters parameters = ll_link_parameters(bl->link);
+        int payload_size = parameters.max_payload_size;
+        struct frame_encoder encoder;
+        struct encoded_frame frame;
+        frame.frame = malloc(frame_max_size(parameters));
+        unsigned char *raw = bond->map == NULL ? malloc(payload_size) : NULL; // File data, when not mapped
+        unsigned char *packed = AL_COMPRESSION ? malloc(payload_size) : NULL;
+        struct file_info info;
+        if (frame_encoder_init(&encoder, parameters) < 0 || frame.frame == NULL ||
+            (bond->map == NULL && raw == NULL) || (AL_COMPRESSION && packed == NULL))
+            printf("Failed to allocate packet buffers.\n");
+        else if (file_info_init(&info, bond->filename, bond->file_size) > 0)
+            result = send_control_packet(bl->link, START, &info);
+
+        // Size of the file data in each packet, adapted to the frame error rate of this link
+        struct frame_sizer sizer;
+        int header_size = offset_header_size(bond->file_size);
+        frame_sizer_init(&sizer, LL_MIN_PAYLOAD_SIZE - header_size, payload_size - header_size, PACKET_OVERHEAD);
+        struct ll_statistics start = ll_link_statistics(bl->link); // Only frames of this transfer count
+        timer_now(&bl->started);
+
+        struct bond_chunk chunk;
+        while (result > 0)
+        {
+            if (!bond_next_chunk(bond, bl, sizer.size, &chunk))
+            {
+                if (bl->num_pending == 0)
+                    break;                      // Every chunk was sent
+                result = bond_flush(bond, bl); // Chunks of this link may still be given back
+                continue;
+            }
+
+            result = bond_send_chunk(bl, chunk, &encoder, &frame, raw, packed);
+            if (result > 0)
+                bond_chunk_sent(bond, bl, chunk);
+            else
+                bond_chunk_done(bond, bl, chunk, FALSE);
+
+            if (LL_ADAPTIVE_PAYLOAD)
+            {
+                struct ll_statistics now = ll_link_statistics(bl->link);
+                frame_sizer_update(&sizer, now.num_I_frames_sent - start.num_I_frames_sent,
+                                   failed_frames(now) - failed_frames(start));
+            }
+        }
+
+        if (result > 0)
+            result = send_control_packet(bl->link, END, &info);
+        if (result > 0)
+            result = bond_flush(bond, bl);
+        else
+            bond_give_back(bond, bl); // Unacknowledged chunks go to the other links
+
+        frame_encoder_free(&encoder);
+        free(frame.frame);
+        free(raw);
+        free(packed);
+        bl->statistics = ll_link_statistics(bl->link);
+        if (ll_close(bl->link, FALSE) < 0)
+        {
+            printf("Failed to close connection on %s.\n", bl->connection_parameters.serialPort);
+            result = -1;
+        }
+    }
+
+    pthread_mutex_lock(&bond->lock);
+    if (result < 0)
+        bl->failed = TRUE;
+    if (bl->link != NULL)
+        bl->elapsed = elapsed_ms(&bl->started);
+    bl->finished = TRUE;
+    pthread_cond_broadcast(&bond->changed);
+    pthread_mutex_unlock(&bond->lock);
+    return NULL;
+}
+
+// Thread writing the chunks received on one link to the file, until END
+void *bond_receiver(void *arg)
+{
+    struct bond_link *bl = arg;
+    struct bond *bond = bl->bond;
+    int result = -1;
+
+    bl->link = ll_open(bl->connection_parameters);
+    if (bl->link == NULL)
+    {
+        printf("Failed to open connection on %s.\n", bl->connection_parameters.serialPort);
+    }
+    else
+    {
+        timer_now(&bl->started);
+
+        // Buffers sized for the agreed payload of this link
+        int payload_size = ll_link_parameters(bl->link).max_payload_size;
+        unsigned char *packet = malloc(payload_size);
+        unsigned char *block = malloc(payload_size - OFFSET_HEADER_SIZE);
+        if (packet == NULL || block == NULL)
+            printf("Failed to allocate packet buffers.\n");
+        else
+            result = 1;
+
+        struct file_info info = {.file_size = -1, .codec = CODEC_NONE};
+
+        while (result > 0)
+        {
+            int bytes_read = ll_read(bl->link, packet);
+            if (bytes_read < 0)
+            {
+                printf("Failed to read data packet on %s.\n", bl->connection_parameters.serialPort);
+                result = -1;
+            }
+            else if (packet[0] == START)
+            {
+                result = parse_control_packet(packet, bytes_read, &info);
+
+                pthread_mutex_lock(&bond->lock);
+                if (bond->file_size < 0)
+                {
+                    bond->file_size = info.file_size;
+                    if (result > 0 && preallocate_file_sink(bond->fd, info.file_size) < 0)
+                        result = -1; // No room for the file
+                }
+                else if (bond->file_size != info.file_size)
+                {
+                    printf("File size mismatch on %s: %lld instead of %lld bytes.\n",
+                           bl->connection_parameters.serialPort, info.file_size, bond->file_size);
+                    result = -1;
+                }
+                pthread_cond_broadcast(&bond->changed);
+                pthread_mutex_unlock(&bond->lock);
+            }
+            else if (packet[0] == END)
+            {
+                if (check_end_packet(packet, bytes_read, info.name, info.file_size) < 0)
+                {
+                    printf("Start and End control packet mismatch!\n");
+                }
+                break; // End packet received
+            }
+            else if (data_header_size(packet[0]) > DATA_HEADER_SIZE &&
+                     ((packet[0] != DATA_LZ_OFFSET && packet[0] != DATA_LZ_OFFSET64) || info.codec == CODEC_LZ))
+            {
+                result = bond_write_chunk(bl, packet, bytes_read, block);
+            }
+        }
+
+        free(packet);
+        free(block);
+        bl->statistics = ll_link_statistics(bl->link);
+        if (ll_close(bl->link, FALSE) < 0)
+            printf("Failed to close connection on %s.\n", bl->connection_parameters.serialPort);
+    }
+
+    pthread_mutex_lock(&bond->lock);
+    if (result < 0)
+        bl->failed = TRUE;
+    if (bl->link != NULL)
+        bl->elapsed = elapsed_ms(&bl->started);
+    bl->finished = TRUE;
+    bond->finished_links++;
+    pthread_cond_broadcast(&bond->changed);
+    pthread_mutex_unlock(&bond->lock);
+    return NULL;
+}
+
+// Take the next chunk of at most size bytes for a link: first the chunks
+// given back by failed links, then the rest of the file.
+// Returns 1 with the chunk, or 0 once every chunk was sent or when the link
+// must first wait for its own chunks to be acknowledged (see bond_flush).
+int bond_next_chunk(struct bond *bond, struct bond_link *bl, int size, struct bond_chunk *chunk)
+{
+    pthread_mutex_lock(&bond->lock);
+
+    while (1)
+    {
+        if (bond->num_retry > 0)
+        {
+            struct bond_chunk *retry = &bond->retry[bond->num_retry - 1];
+            chunk->offset = retry->offset;
+            chunk->size = retry->size < size ? retry->size : size;
+            retry->offset += chunk->size;
+            retry->size -= chunk->size;
+            if (retry->size == 0)
+                bond->num_retry--;
+            break;
+        }
+
+        long long remaining = bond->file_size - bond->next_offset;
+        if (remaining > 0 && !bond_should_wait(bond, bl, remaining < size ? remaining : size))
+        {
+            chunk->offset = bond->next_offset;
+            chunk->size = remaining < size ? remaining : size;
+            bond->next_offset += chunk->size;
+            break;
+        }
+
+        // Chunks in flight may still be given back. A link never waits on
+        // chunks of its own, which only flushing its window settles.
+        if ((remaining == 0 && bond->in_flight == 0) || bl->num_pending > 0)
+        {
+            pthread_mutex_unlock(&bond->lock);
+            return 0;
+        }
+        pthread_cond_wait(&bond->changed, &bond->lock);
+    }
+
+    bond->in_flight++;
+    pthread_mutex_unlock(&bond->lock);
+    return 1;
+}
+
+// Near the end of the file, a slow link holds back when the other links would
+// send the rest sooner than it would send one more chunk.
+// Links without a goodput measurement yet never hold back. Called with the lock held.
+int bond_should_wait(struct bond *bond, struct bond_link *bl, int size)
+{
+    if (bl->goodput <= 0)
+        return FALSE;
+
+    double others = 0; // Goodput of the other working links
+    double best = 0;   // Goodput of the fastest of them
+    for (int i = 0; i < bond->num_links; i++)
+    {
+        struct bond_link *other = &bond->links[i];
+        if (other == bl || other->failed || other->finished || other->goodput <= 0)
+            continue;
+        others += other->goodput;
+        if (other->goodput > best)
+            best = other->goodput;
+    }
+    if (others == 0)
+        return FALSE;
+
+    double own_time = size / bl->goodput;
+    double others_time = (bond->file_size - bond->next_offset) / others;
+    if (size / best > others_time)
+        others_time = size / best; // Chunks are not split between links
+    return own_time > others_time;
+}
+
+// Account for a chunk a link finished with: acknowledged, or given back for
+// the other links, in which case the link stops taking chunks.
+void bond_chunk_done(struct bond *bond, struct bond_link *bl, struct bond_chunk chunk, int sent)
+{
+    pthread_mutex_lock(&bond->lock);
+    bond->in_flight--;
+    if (sent)
+    {
+        bl->bytes += chunk.size;
+        bl->packets++;
+        int elapsed = elapsed_ms(&bl->started);
+        if (elapsed > 0)
+            bl->goodput = bl->bytes * 1000.0 / elapsed;
+    }
+    else
+    {
+        bond->retry[bond->num_retry++] = chunk; // At most a window and one more per link, each link fails once
+        bl->failed = TRUE;
+    }
+    pthread_cond_broadcast(&bond->changed);
+    pthread_mutex_unlock(&bond->lock);
+}
+
+// Keep a chunk a link sent as pending until its frame is acknowledged
+void bond_chunk_sent(struct bond *bond, struct bond_link *bl, struct bond_chunk chunk)
+{
+    bl->pending[bl->num_pending++] = chunk;
+    bond_acknowledge(bond, bl, ll_link_unacknowledged(bl->link));
+}
+
+// Account for the pending chunks of a link older than its last unacknowledged
+// frames: one frame per chunk, acknowledged in order
+void bond_acknowledge(struct bond *bond, struct bond_link *bl, int unacknowledged)
+{
+    int acknowledged = bl->num_pending - unacknowledged;
+    if (acknowledged <= 0)
+        return;
+
+    for (int i = 0; i < acknowledged; i++)
+        bond_chunk_done(bond, bl, bl->pending[i], TRUE);
+    bl->num_pending -= acknowledged;
+    memmove(&bl->pending[0], &bl->pending[acknowledged], bl->num_pending * sizeof(struct bond_chunk));
+}
+
+// Wait until every chunk a link sent is acknowledged. If the link fails
+// instead, its pending chunks are given back.
+// Returns -1 on error, 1 otherwise.
+int bond_flush(struct bond *bond, struct bond_link *bl)
+{
+    if (ll_flush(bl->link) < 0)
+    {
+        printf("Frames left unacknowledged on %s.\n", bl->connection_parameters.serialPort);
+        bond_give_back(bond, bl);
+        return -1;
+    }
+    bond_acknowledge(bond, bl, 0);
+    return 1;
+}
+
+// Give back every chunk of a link not acknowledged yet
+void bond_give_back(struct bond *bond, struct bond_link *bl)
+{
+    for (int i = 0; i < bl->num_pending; i++)
+        bond_chunk_done(bond, bl, bl->pending[i], FALSE);
+    bl->num_pending = 0;
+}
+
+// Send a chunk of the file as a DATA_OFFSET packet, compressed when it helps
+// (DATA_LZ_OFFSET). The frame is encoded straight from the mapped file, or
+// from raw if the file is not mapped; packed receives the compressed data.
+// Returns -1 on error, 1 otherwise.
+int bond_send_chunk(struct bond_link *bl, struct bond_chunk chunk, struct frame_encoder *encoder,
+                    struct encoded_frame *frame, unsigned char *raw, unsigned char *packed)
+{
+    const unsigned char *data = raw;
+    if (bl->bond->map != NULL)
+    {
+        data = bl->bond->map + chunk.offset;
+    }
+    else if (pread(bl->bond->fd, raw, chunk.size, chunk.offset) != chunk.size)
+    {
+        printf("Failed to read %lld bytes at offset %lld.\n", chunk.size, chunk.offset);
+        return -1;
+    }
+
+    int data_size = -1;
+    if (AL_COMPRESSION)
+        data_size = lz_compress(data, chunk.size, packed, chunk.size - 1); // Only if it saves at least one byte
+
+    int compressed = data_size >= 0;
+    if (compressed)
+        data = packed;
+    else
+        data_size = chunk.size; // Incompressible, sent raw
+
+    unsigned char header[OFFSET64_HEADER_SIZE];
+    int header_size = build_offset_header(header, compressed, chunk.offset, data_size);
+
+    if (frame_encode_parts(encoder, header, header_size, data, data_size, frame) < 0 ||
+        ll_write_encoded(bl->link, frame) < 0)
+    {
+        printf("Failed to send data packet on %s.\n", bl->connection_parameters.serialPort);
+        return -1;
+    }
+    return 1;
+}
+
+// Write the data of a DATA_OFFSET packet (of either width) to the file at its
+// offset and count it. block holds the decompressed data.
+// Returns -1 on error, 1 otherwise.
+int bond_write_chunk(struct bond_link *bl, const unsigned char *packet, int size, unsigned char *block)
+{
+    struct bond *bond = bl->bond;
+    long long offset = 0;
+    int block_size = ll_link_parameters(bl->link).max_payload_size - OFFSET_HEADER_SIZE; // Chunks are never larger than the data of a packet
+    int data_size = write_data_packet(bond->fd, packet, size, block, block_size, bond->file_size, &offset, NULL);
+    if (data_size < 0)
+    {
+        printf("Failed to write the data packet of %s.\n", bl->connection_parameters.serialPort);
+        return -1;
+    }
+
+    pthread_mutex_lock(&bond->lock);
+    int result = bond_add_range(bond, offset, data_size);
+    bl->bytes += data_size;
+    bl->packets++;
+    pthread_cond_broadcast(&bond->changed);
+    pthread_mutex_unlock(&bond->lock);
+    return result;
+}
+
+// Add a range to the bytes written to the file, merging it with the ranges
+// it overlaps or touches, so a chunk sent twice is only counted once.
+// Called with the lock held. Returns -1 on error, 1 otherwise.
+int bond_add_range(struct bond *bond, long long offset, int size)
+{
+    long long end = offset + size;
+
+    // Ranges [first, last) overlap or touch the new one
+    int first = 0;
+    while (first < bond->num_received && bond->received[first].offset + bond->received[first].size < offset)
+        first++;
+    int last = first;
+    while (last < bond->num_received && bond->received[last].offset <= end)
+    {
+        struct bond_chunk *range = &bond->received[last++];
+        if (range->offset < offset)
+            offset = range->offset;
+        if (range->offset + range->size > end)
+            end = range->offset + range->size;
+        bond->received_bytes -= range->size;
+    }
+
+    if (first == last)
+    {
+        // New range between two others
+        if (bond->num_received == bond->received_capacity)
+        {
+            int capacity = bond->received_capacity > 0 ? 2 * bond->received_capacity : 16;
+            struct bond_chunk *received = realloc(bond->received, capacity * sizeof(struct bond_chunk));
+            if (received == NULL)
+            {
+                printf("Failed to allocate received ranges.\n");
+                return -1;
+            }
+            bond->received = received;
+            bond->received_capacity = capacity;
+        }
+        memmove(&bond->received[first + 1], &bond->received[first],
+                (bond->num_received - first) * sizeof(struct bond_chunk));
+        bond->num_received++;
+    }
+    else
+    {
+        // Ranges merged into the first one
+        memmove(&bond->received[first + 1], &bond->received[last],
+                (bond->num_received - last) * sizeof(struct bond_chunk));
+        bond->num_received -= last - first - 1;
+    }
+
+    bond->received[first].offset = offset;
+    bond->received[first].size = end - offset;
+    bond->received_bytes += end - offset;
+    return 1;
+}
+
+// Print the share of the transfer carried by each link
+void bond_print_links(struct bond *bond)
+{
+    pthread_mutex_lock(&bond->lock); // Links left behind may still be counting
+    for (int i = 0; i < bond->num_links; i++)
+    {
+        struct bond_link *bl = &bond->links[i];
+        printf("Link %d (%s): %d packets, %lld bytes, %.0f B/s, %d retransmissions%s\n", bl->index,
+               bl->connection_parameters.serialPort, bl->packets, bl->bytes,
+               bl->elapsed > 0 ? bl->bytes * 1000.0 / bl->elapsed : 0,
+               bl->statistics.num_retransmissions, bl->failed || !bl->finished ? " (failed)" : "");
+    }
+    pthread_mutex_unlock(&bond->lock);
+}
@@ -0,0 +1,305 @@
+#include "byte_scan.h"
+#include "link_config.h"
+#include "state_machine.h"
+#include <pthread.h>
+
+#if LL_SIMD && (defined(__x86_64__) || defined(__i386__))
+#define BYTE_SCAN_X86 1
+#include <immintrin.h>
+#else
+#define BYTE_SCAN_X86 0
+#endif
+
+// Helper Functions prototypes
+size_t copy_clean_run_scalar(const unsigned char *src, size_t len, unsigned char *dst, unsigned char *bcc);
+size_t stuff_bytes_scalar(const unsigned char *src, size_t len, unsigned char *dst, unsigned char *bcc);
+#if BYTE_SCAN_X86
+size_t copy_clean_run_sse2(const unsigned char *src, size_t len, unsigned char *dst, unsigned char *bcc);
+size_t stuff_bytes_sse2(const unsigned char *src, size_t len, unsigned char *dst, unsigned char *bcc);
+size_t copy_clean_run_avx2(const unsigned char *src, size_t len, unsigned char *dst, unsigned char *bcc);
+size_t stuff_bytes_avx2(const unsigned char *src, size_t len, unsigned char *dst, unsigned char *bcc);
+#endif
+void byte_scan_select();
+
+// Implementation chosen on first use (once, whatever the number of links)
+size_t (*copy_clean_run_impl)(const unsigned char *src, size_t len, unsigned char *dst, unsigned char *bcc) = NULL;
+size_t (*stuff_bytes_impl)(const unsigned char *src, size_t len, unsigned char *dst, unsigned char *bcc) = NULL;
+const char *byte_scan_name = "scalar";
+pthread_once_t byte_scan_once = PTHREAD_ONCE_INIT;
+
+// Copy the bytes of src that come before the first FLAG or ESC to dst and XOR
+// them into *bcc, in a single pass. dst must have room for len bytes (bytes
+// after the run may be overwritten).
+// Returns the length of the run (len if src holds no FLAG or ESC).
+size_t copy_clean_run(const unsigned char *src, size_t len, unsigned char *dst, unsigned char *bcc)
+{
+    pthread_once(&byte_scan_once, byte_scan_select);
+    return copy_clean_run_impl(src, len, dst, bcc);
+}
+
+// Byte stuff src into dst and XOR every byte of src into *bcc.
+// dst must have room for MAX_STUFFED_SIZE(len) bytes.
+// Returns the number of bytes written to dst.
+size_t stuff_bytes(const unsigned char *src, size_t len, unsigned char *dst, unsigned char *bcc)
+{
+    pthread_once(&byte_scan_once, byte_scan_select);
+    return stuff_bytes_impl(src, len, dst, bcc);
+}
+
+// Name of the implementation in use ("avx2", "sse2" or "scalar")
+const char *byte_scan_implementation()
+{
+    pthread_once(&byte_scan_once, byte_scan_select);
+    return byte_scan_name;
+}
+
+// Pick the widest implementation the CPU supports
+void byte_scan_select()
+{
+    copy_clean_run_impl = copy_clean_run_scalar;
+    stuff_bytes_impl = stuff_bytes_scalar;
+    byte_scan_name = "scalar";
+
+#if BYTE_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        copy_clean_run_impl = copy_clean_run_avx2;
+        stuff_bytes_impl = stuff_bytes_avx2;
+        byte_scan_name = "avx2";
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        copy_clean_run_impl = copy_clean_run_sse2;
+        stuff_bytes_impl = stuff_bytes_sse2;
+        byte_scan_name = "sse2";
+    }
+#endif
+}
+
+////////////////////////////////////////////////
+// SCALAR
+////////////////////////////////////////////////
+size_t copy_clean_run_scalar(const unsigned char *src, size_t len, unsigned char *dst, unsigned char *bcc)
+{
+    unsigned char result = *bcc;
+    size_t i = 0;
+
+    for (; i < len && src[i] != FLAG && src[i] != ESC; i++)
+    {
+        dst[i] = src[i];
+        result ^= src[i];
+    }
+
+    *bcc = result;
+    return i;
+}
+
+size_t stuff_bytes_scalar(const unsigned char *src, size_t len, unsigned char *dst, unsigned char *bcc)
+{
+    unsigned char result = *bcc;
+    size_t out = 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (src[i] == FLAG || src[i] == ESC)
+        {
+            dst[out++] = ESC;
+            dst[out++] = src[i] ^ 0x20; // FLAG -> ESC_FLAG, ESC -> ESC_ESC
+        }
+        else
+        {
+            dst[out++] = src[i];
+        }
+        result ^= src[i];
+    }
+
+    *bcc = result;
+    return out;
+}
+
+#if BYTE_SCAN_X86
+////////////////////////////////////////////////
+// SSE2 (16 bytes per step)
+// Each block is loaded once: compared against FLAG and ESC, stored to dst and
+// XORed into an accumulator that is folded into one byte at the end.
+////////////////////////////////////////////////
+__attribute__((target("sse2"))) size_t copy_clean_run_sse2(const unsigned char *src, size_t len, unsigned char *dst, unsigned char *bcc)
+{
+    const __m128i flag = _mm_set1_epi8((char)FLAG);
+    const __m128i esc = _mm_set1_epi8((char)ESC);
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(bytes, flag), _mm_cmpeq_epi8(bytes, esc));
+        _mm_storeu_si128((__m128i *)(dst + i), bytes); // Bytes after the run are overwritten later
+        if (_mm_movemask_epi8(special))
+            break; // FLAG or ESC in this block: finish it byte by byte
+        acc = _mm_xor_si128(acc, bytes);
+    }
+
+    unsigned char result = *bcc;
+    if (i > 0) // Fold the 16 lanes into one byte (skipped for short runs)
+    {
+        acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 8));
+        acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 4));
+        acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 2));
+        acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 1));
+        result ^= (unsigned char)_mm_cvtsi128_si32(acc);
+    }
+
+    for (; i < len && src[i] != FLAG && src[i] != ESC; i++)
+    {
+        dst[i] = src[i];
+        result ^= src[i];
+    }
+
+    *bcc = result;
+    return i;
+}
+
+__attribute__((target("sse2"))) size_t stuff_bytes_sse2(const unsigned char *src, size_t len, unsigned char *dst, unsigned char *bcc)
+{
+    const __m128i flag = _mm_set1_epi8((char)FLAG);
+    const __m128i esc = _mm_set1_epi8((char)ESC);
+    __m128i acc = _mm_setzero_si128();
+    unsigned char result = *bcc;
+    size_t i = 0;
+    size_t out = 0;
+
+    while (i + 16 <= len)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(bytes, flag), _mm_cmpeq_epi8(bytes, esc));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(special); // One bit per FLAG or ESC byte
+        _mm_storeu_si128((__m128i *)(dst + out), bytes);                       // Copy the block as is
+        if (!mask)
+        {
+            acc = _mm_xor_si128(acc, bytes);
+            i += 16;
+            out += 16;
+            continue;
+        }
+
+        // Keep the bytes before the first FLAG or ESC, then escape it and
+        // carry on right after it
+        size_t run = __builtin_ctz(mask);
+        for (size_t k = 0; k < run; k++)
+            result ^= src[i + k];
+        i += run;
+        out += run;
+
+        result ^= src[i];
+        dst[out++] = ESC;
+        dst[out++] = src[i] ^ 0x20; // FLAG -> ESC_FLAG, ESC -> ESC_ESC
+        i++;
+    }
+
+    // Fold the 16 lanes into one byte
+    acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 8));
+    acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 4));
+    acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 2));
+    acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 1));
+    result ^= (unsigned char)_mm_cvtsi128_si32(acc);
+
+    out += stuff_bytes_scalar(src + i, len - i, dst + out, &result);
+    *bcc = result;
+    return out;
+}
+
+////////////////////////////////////////////////
+// AVX2 (32 bytes per step)
+// Same as the SSE2 version. Kept free of calls into it: mixing VEX and
+// legacy SSE code while the upper halves of the registers are in use stalls
+// some CPUs.
+////////////////////////////////////////////////
+__attribute__((target("avx2"))) size_t copy_clean_run_avx2(const unsigned char *src, size_t len, unsigned char *dst, unsigned char *bcc)
+{
+    const __m256i flag = _mm256_set1_epi8((char)FLAG);
+    const __m256i esc = _mm256_set1_epi8((char)ESC);
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32)
+    {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, flag), _mm256_cmpeq_epi8(bytes, esc));
+        _mm256_storeu_si256((__m256i *)(dst + i), bytes); // Bytes after the run are overwritten later
+        if (_mm256_movemask_epi8(special))
+            break; // FLAG or ESC in this block: finish it byte by byte
+        acc = _mm256_xor_si256(acc, bytes);
+    }
+
+    unsigned char result = *bcc;
+    if (i > 0) // Fold the 32 lanes into one byte (skipped for short runs)
+    {
+        __m128i half = _mm_xor_si128(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        half = _mm_xor_si128(half, _mm_srli_si128(half, 8));
+        half = _mm_xor_si128(half, _mm_srli_si128(half, 4));
+        half = _mm_xor_si128(half, _mm_srli_si128(half, 2));
+        half = _mm_xor_si128(half, _mm_srli_si128(half, 1));
+        result ^= (unsigned char)_mm_cvtsi128_si32(half);
+    }
+
+    for (; i < len && src[i] != FLAG && src[i] != ESC; i++)
+    {
+        dst[i] = src[i];
+        result ^= src[i];
+    }
+
+    *bcc = result;
+    return i;
+}
+__attribute__((target("avx2"))) size_t stuff_bytes_avx2(const unsigned char *src, size_t len, unsigned char *dst, unsigned char *bcc)
+{
+    const __m256i flag = _mm256_set1_epi8((char)FLAG);
+    const __m256i esc = _mm256_set1_epi8((char)ESC);
+    __m256i acc = _mm256_setzero_si256();
+    unsigned char result = *bcc;
+    size_t i = 0;
+    size_t out = 0;
+
+    while (i + 32 <= len)
+    {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, flag), _mm256_cmpeq_epi8(bytes, esc));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(special); // One bit per FLAG or ESC byte
+        _mm256_storeu_si256((__m256i *)(dst + out), bytes);                       // Copy the block as is
+        if (!mask)
+        {
+            acc = _mm256_xor_si256(acc, bytes);
+            i += 32;
+            out += 32;
+            continue;
+        }
+
+        // Keep the bytes before the first FLAG or ESC, then escape it and
+        // carry on right after it
+        size_t run = __builtin_ctz(mask);
+        for (size_t k = 0; k < run; k++)
+            result ^= src[i + k];
+        i += run;
+        out += run;
+
+        result ^= src[i];
+        dst[out++] = ESC;
+        dst[out++] = src[i] ^ 0x20; // FLAG -> ESC_FLAG, ESC -> ESC_ESC
+        i++;
+    }
+
+    // Fold the 32 lanes into one byte
+    __m128i half = _mm_xor_si128(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    half = _mm_xor_si128(half, _mm_srli_si128(half, 8));
+    half = _mm_xor_si128(half, _mm_srli_si128(half, 4));
+    half = _mm_xor_si128(half, _mm_srli_si128(half, 2));
+    half = _mm_xor_si128(half, _mm_srli_si128(half, 1));
+    result ^= (unsigned char)_mm_cvtsi128_si32(half);
+
+    out += stuff_bytes_scalar(src + i, len - i, dst + out, &result);
+    *bcc = result;
+    return out;
+}
+#endif
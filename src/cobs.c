@@ -0,0 +1,57 @@
+#include "cobs.h"
+#include "state_machine.h"
+#include <string.h>
+
+#define COBS_MAX_RUN 254 // Bytes of a run not ended by FLAG
+
+// Encode len bytes of src into dst (COBS_MAX_SIZE(len) bytes).
+// Returns the encoded size.
+size_t cobs_encode(const unsigned char *src, size_t len, unsigned char *dst)
+{
+    size_t size = 0;
+    size_t i = 0;
+
+    while (1)
+    {
+        // Longest run before the next FLAG (memchr scans a word or vector at a time)
+        size_t limit = (len - i < COBS_MAX_RUN) ? len - i : COBS_MAX_RUN;
+        const unsigned char *flag = memchr(src + i, FLAG, limit);
+        size_t run = flag ? (size_t)(flag - (src + i)) : limit;
+
+        dst[size++] = (run + 1) ^ FLAG; // Code byte
+        memcpy(dst + size, src + i, run);
+        size += run;
+        i += run;
+
+        if (flag)
+            i++; // The FLAG is implied by the code
+        else if (i == len)
+            break; // Last run
+    }
+
+    return size;
+}
+
+// Decode len bytes of buf in place.
+// Returns the decoded size, or -1 if the data is not valid COBS.
+int cobs_decode(unsigned char *buf, size_t len)
+{
+    size_t size = 0;
+    size_t i = 0;
+
+    while (i < len)
+    {
+        size_t run = (buf[i++] ^ FLAG) - 1;
+        if (run > COBS_MAX_RUN || run > len - i)
+            return -1; // Code byte 0 (a FLAG) or run past the end
+
+        memmove(buf + size, buf + i, run); // The output never overtakes the input
+        size += run;
+        i += run;
+
+        if (run < COBS_MAX_RUN && i < len)
+            buf[size++] = FLAG; // Implied FLAG between runs
+    }
+
+    return size;
+}
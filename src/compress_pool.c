@@ -0,0 +1,195 @@
+#include "compress_pool.h"
+#include "lz.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Helper Functions prototypes
+void *compress_worker(void *arg);
+void compress_block(struct compress_block *block);
+
+// Start num_threads workers (0 disables compression) for blocks of up to
+// block_size bytes.
+// Returns 1 on success, -1 on failure.
+int compress_pool_init(struct compress_pool *pool, int num_threads, int block_size)
+{
+    if (num_threads > COMPRESS_MAX_THREADS)
+        num_threads = COMPRESS_MAX_THREADS;
+
+    pool->num_threads = 0;
+    pool->num_blocks = num_threads > 0 ? 2 * num_threads : 1;
+    pool->first = 0;
+    pool->count = 0;
+    pool->stop = 0;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->pending, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pthread_cond_init(&pool->freed, NULL);
+
+    for (int i = 0; i < COMPRESS_MAX_BLOCKS; i++)
+    {
+        pool->blocks[i].raw = NULL;
+        pool->blocks[i].packed = NULL;
+        pool->blocks[i].state = BLOCK_FREE;
+    }
+
+    for (int i = 0; i < pool->num_blocks; i++)
+    {
+        pool->blocks[i].raw = malloc(block_size);
+        pool->blocks[i].packed = num_threads > 0 ? malloc(block_size) : NULL;
+        if (pool->blocks[i].raw == NULL || (num_threads > 0 && pool->blocks[i].packed == NULL))
+        {
+            printf("Failed to allocate compression blocks.\n");
+            compress_pool_destroy(pool);
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < num_threads; i++)
+    {
+        if (pthread_create(&pool->threads[i], NULL, compress_worker, pool) != 0)
+            break; // Run with the workers started so far
+        pool->num_threads++;
+    }
+
+    if (num_threads > 0 && pool->num_threads == 0)
+    {
+        printf("Failed to start compression threads.\n");
+        compress_pool_destroy(pool);
+        return -1;
+    }
+    return 1;
+}
+
+// Wait for the next block to fill.
+// Returns NULL if the pool was cancelled.
+struct compress_block *compress_pool_next(struct compress_pool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (pool->count == pool->num_blocks && !pool->stop)
+        pthread_cond_wait(&pool->freed, &pool->lock);
+    struct compress_block *block = pool->stop ? NULL : &pool->blocks[(pool->first + pool->count) % pool->num_blocks];
+    pthread_mutex_unlock(&pool->lock);
+    return block;
+}
+
+// Hand the block returned by compress_pool_next to the workers
+void compress_pool_submit(struct compress_pool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    struct compress_block *block = &pool->blocks[(pool->first + pool->count) % pool->num_blocks];
+    if (pool->num_threads == 0)
+    {
+        block->compressed = 0; // No workers: stored raw
+        block->state = BLOCK_DONE;
+        pthread_cond_broadcast(&pool->done);
+    }
+    else
+    {
+        block->state = BLOCK_PENDING;
+        pthread_cond_signal(&pool->pending);
+    }
+    pool->count++;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Wait for the oldest block to be submitted and compressed.
+// Returns NULL if the pool was cancelled.
+struct compress_block *compress_pool_collect(struct compress_pool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->stop && (pool->count == 0 || pool->blocks[pool->first].state != BLOCK_DONE))
+        pthread_cond_wait(&pool->done, &pool->lock);
+    struct compress_block *block = pool->stop ? NULL : &pool->blocks[pool->first];
+    pthread_mutex_unlock(&pool->lock);
+
+    return block;
+}
+
+// Give the block returned by compress_pool_collect back to the pool
+void compress_pool_release(struct compress_pool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->blocks[pool->first].state = BLOCK_FREE;
+    pool->first = (pool->first + 1) % pool->num_blocks;
+    pool->count--;
+    pthread_cond_signal(&pool->freed);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Wake up the producer and the consumer: their waits return NULL from now on
+void compress_pool_cancel(struct compress_pool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->pending);
+    pthread_cond_broadcast(&pool->done);
+    pthread_cond_broadcast(&pool->freed);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Stop the workers and free the blocks
+void compress_pool_destroy(struct compress_pool *pool)
+{
+    compress_pool_cancel(pool);
+
+    for (int i = 0; i < pool->num_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+    pool->num_threads = 0;
+
+    for (int i = 0; i < COMPRESS_MAX_BLOCKS; i++)
+    {
+        free(pool->blocks[i].raw);
+        free(pool->blocks[i].packed);
+        pool->blocks[i].raw = NULL;
+        pool->blocks[i].packed = NULL;
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->pending);
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->freed);
+}
+
+// Worker thread: compress pending blocks, oldest first
+void *compress_worker(void *arg)
+{
+    struct compress_pool *pool = arg;
+
+    pthread_mutex_lock(&pool->lock);
+    while (1)
+    {
+        struct compress_block *block = NULL;
+        for (int i = 0; i < pool->count && block == NULL; i++)
+        {
+            struct compress_block *candidate = &pool->blocks[(pool->first + i) % pool->num_blocks];
+            if (candidate->state == BLOCK_PENDING)
+                block = candidate;
+        }
+
+        if (block == NULL)
+        {
+            if (pool->stop)
+                break;
+            pthread_cond_wait(&pool->pending, &pool->lock);
+            continue;
+        }
+
+        block->state = BLOCK_BUSY;
+        pthread_mutex_unlock(&pool->lock);
+
+        compress_block(block);
+
+        pthread_mutex_lock(&pool->lock);
+        block->state = BLOCK_DONE;
+        pthread_cond_broadcast(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+// Compress a block, keeping it raw unless that saves at least one byte
+void compress_block(struct compress_block *block)
+{
+    block->packed_size = lz_compress(block->data, block->raw_size, block->packed, block->raw_size - 1);
+    block->compressed = block->packed_size > 0;
+}
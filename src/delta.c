@@ -0,0 +1,665 @@
+#include "delta.h"
+#include "app_config.h"
+#include "file_io.h"
+#include "file_transfer.h"
+#include "frame_check.h"
+#include "frame_sizer.h"
+#include "packet.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DATA_COPY_SIZE 17               // DATA_COPY packet: type, offset (8 bytes), first block (4) and count (4)
+#define SIGNATURE_HEADER_SIZE 5         // Header of SIGNATURE packets: type and index of the first block (4 bytes)
+#define SIGNATURE_ENTRY_SIZE 12         // Checksums of a block: rolling (4 bytes), CRC-32 (4) and CRC-32C (4)
+#define DELTA_SUFFIX ".delta"           // Appended to the output file name while its new version is built
+#define DELTA_MIN_BLOCK_SIZE 512        // Bounds of the block size of a signature
+#define DELTA_AUTO_MAX_BLOCK_SIZE 65536 // Largest block size picked from the file size
+#define DELTA_MAX_BLOCK_SIZE (1024 * 1024)
+#define DELTA_MAX_BLOCKS (1 << 24)      // Largest number of blocks in a signature
+#define DELTA_MAX_COPY_BLOCKS 65536     // Largest run of blocks in one DATA_COPY packet
+
+#if AL_DELTA_BLOCK_SIZE != 0 && (AL_DELTA_BLOCK_SIZE < DELTA_MIN_BLOCK_SIZE || AL_DELTA_BLOCK_SIZE > DELTA_MAX_BLOCK_SIZE)
+#error "AL_DELTA_BLOCK_SIZE must be 0 or between DELTA_MIN_BLOCK_SIZE and DELTA_MAX_BLOCK_SIZE"
+#endif
+
+// Checksums of a block of the receiver's copy of the file
+struct signature_block
+{
+    uint32_t weak;   // Rolling checksum
+    uint32_t crc32;  // CRC-32 and CRC-32C, checked on a rolling checksum match
+    uint32_t crc32c;
+};
+
+// Signature of the receiver's copy of the file, at the transmitter
+struct signature
+{
+    int block_size;                 // Size of the blocks
+    int count;                      // Number of full blocks
+    struct signature_block *blocks; // Their checksums
+    int *heads;                     // First block of each hash chain, -1 if none
+    int *next;                      // Next block in the chain of each block
+    int table_bits;                 // Hash chains: 2^table_bits
+};
+
+// Transmitter of a delta transfer
+struct delta_sender
+{
+    const unsigned char *map;   // File being sent
+    long long file_size;        // Size of the file
+    int block_size;             // Block size of the signature
+    struct frame_sizer sizer;   // Size of the literal data in each packet
+    struct ll_statistics start; // Statistics before the transfer
+    unsigned char *packet;      // Packet being built
+    long long copy_offset;      // Pending run of copied blocks: offset in the file,
+    int copy_block;             // first block of the receiver's copy
+    int copy_count;             // and number of blocks (0 = none)
+    long long literal_bytes;    // File bytes sent as literal data
+    long long copied_bytes;     // File bytes copied from the receiver's copy
+};
+
+// Helper Functions prototypes
+int receive_delta_file(const char *filename, const struct delta_basis *basis);
+int delta_basis_open(struct delta_basis *basis, const char *filename);
+void delta_basis_close(struct delta_basis *basis);
+int delta_block_size(long long file_size);
+void weak_checksum(const unsigned char *data, int size, uint32_t *a, uint32_t *b);
+void weak_checksum_roll(uint32_t *a, uint32_t *b, int size, unsigned char out, unsigned char in);
+int send_signature(const struct delta_basis *basis, const char *filename);
+int read_signature(struct signature *signature);
+int signature_bucket(const struct signature *signature, uint32_t weak);
+int signature_find(const struct signature *signature, const unsigned char *data, uint32_t weak);
+void signature_free(struct signature *signature);
+int send_delta_file(const char *filename, const struct signature *signature);
+int send_delta_packets(const unsigned char *map, long long file_size, const struct signature *signature);
+int delta_send_copy(struct delta_sender *sender, long long literal, long long position, int block);
+int delta_flush_copy(struct delta_sender *sender);
+int delta_send_literal(struct delta_sender *sender, long long from, long long to);
+int delta_send_packet(struct delta_sender *sender, int size);
+
+// Transmitter of a delta transfer: receive the signature of the receiver's
+// copy of the file over a link opened the other way round, then send the
+// file as literal data and copies of the blocks that match
+int handle_delta_transmitter(LinkLayer connection_parameters, const char *filename)
+{
+    struct signature signature;
+    LinkLayer reversed = connection_parameters;
+    reversed.role = LlRx;
+    if (llopen(reversed) < 0)
+    {
+        printf("Failed to open connection.\n");
+        return -1;
+    }
+    int result = read_signature(&signature);
+    if (llclose(FALSE) < 0)
+        result = -1; // The other side may not have seen the whole signature
+    if (result < 0)
+    {
+        signature_free(&signature);
+        return -1;
+    }
+
+    if (open_link(connection_parameters, filename) < 0)
+    {
+        printf("Failed to open connection.\n");
+        signature_free(&signature);
+        return -1;
+    }
+    result = send_delta_file(filename, &signature);
+    signature_free(&signature);
+
+    if (llclose(1) < 0)
+    {
+        printf("Failed to close connection.\n");
+    }
+    return result;
+}
+
+// Receiver of a delta transfer: send the signature of the current copy of the
+// file, then rebuild the new version next to it from literal data and copies
+// of its blocks, and replace it. Like any receiver it may be started before
+// the transmitter: it keeps asking for the signature session until answered.
+int handle_delta_receiver(LinkLayer connection_parameters, const char *filename)
+{
+    struct delta_basis basis;
+    if (delta_basis_open(&basis, filename) < 0)
+        return -1;
+
+    LinkLayer reversed = connection_parameters;
+    reversed.role = LlTx;
+    int result;
+    while ((result = llopen(reversed)) < 0)
+    {
+        if (ll_link_statistics(&ll_default_link).num_SET_sent == 0)
+            break; // The serial port could not be opened
+        printf("Waiting for the transmitter...\n");
+    }
+    if (result < 0)
+        printf("Failed to open connection.\n");
+    else
+    {
+        result = send_signature(&basis, filename);
+        if (llclose(FALSE) < 0)
+            result = -1;
+    }
+
+    if (result > 0 && open_link(connection_parameters, filename) < 0)
+    {
+        printf("Failed to open connection.\n");
+        result = -1;
+    }
+    else if (result > 0)
+    {
+        result = receive_delta_file(filename, &basis);
+        if (llclose(1) < 0)
+        {
+            printf("Failed to close connection.\n");
+        }
+    }
+
+    delta_basis_close(&basis);
+    return result;
+}
+
+// Receive the new version of a file into filename + DELTA_SUFFIX, copying
+// blocks from the basis, and rename it over the old one once complete.
+// Returns -1 on error (the old version is left untouched), 1 otherwise.
+int receive_delta_file(const char *filename, const struct delta_basis *basis)
+{
+    struct file_info info;
+    char path[PATH_MAX];
+    if (snprintf(path, PATH_MAX, "%s%s", filename, DELTA_SUFFIX) >= PATH_MAX)
+    {
+        printf("File name too long: %s\n", filename);
+        return -1;
+    }
+    if (read_control_packet(&info) < 0)
+        return -1;
+
+    int result = receive_file(path, &info, basis);
+    if (result > 0 && rename(path, filename) < 0)
+    {
+        printf("Failed to replace %s: %s\n", filename, strerror(errno));
+        result = -1;
+    }
+    if (result < 0)
+        unlink(path);
+    return result;
+}
+
+// Open the current copy of the file as the basis of a delta transfer and pick
+// its block size. A missing file is an empty basis.
+// Returns -1 on error, 1 otherwise.
+int delta_basis_open(struct delta_basis *basis, const char *filename)
+{
+    memset(basis, 0, sizeof(struct delta_basis));
+    basis->fd = open(filename, O_RDONLY);
+    struct stat status;
+    if (basis->fd >= 0 && fstat(basis->fd, &status) == 0 && S_ISREG(status.st_mode))
+        basis->file_size = status.st_size;
+    else if (basis->fd >= 0 || errno != ENOENT)
+    {
+        printf("Error opening file: %s\n", filename);
+        if (basis->fd >= 0)
+            close(basis->fd);
+        return -1;
+    }
+
+    basis->block_size = delta_block_size(basis->file_size);
+    basis->block = malloc(basis->block_size);
+    if (basis->block == NULL)
+    {
+        printf("Failed to allocate block buffer.\n");
+        delta_basis_close(basis);
+        return -1;
+    }
+    return 1;
+}
+
+void delta_basis_close(struct delta_basis *basis)
+{
+    if (basis->fd >= 0)
+        close(basis->fd);
+    free(basis->block);
+    basis->fd = -1;
+    basis->block = NULL;
+}
+
+// Block size of the signature of a file: AL_DELTA_BLOCK_SIZE, or about the
+// square root of its size (as rsync does), which balances the size of the
+// signature against the data sent again around each change
+int delta_block_size(long long file_size)
+{
+    long long block_size = AL_DELTA_BLOCK_SIZE;
+    if (block_size == 0)
+    {
+        block_size = DELTA_MIN_BLOCK_SIZE;
+        while (block_size * block_size < file_size && block_size < DELTA_AUTO_MAX_BLOCK_SIZE)
+            block_size += 64;
+    }
+    if (file_size / block_size > DELTA_MAX_BLOCKS)
+        block_size = (file_size + DELTA_MAX_BLOCKS - 1) / DELTA_MAX_BLOCKS; // Keep the signature bounded
+    return block_size < DELTA_MAX_BLOCK_SIZE ? block_size : DELTA_MAX_BLOCK_SIZE;
+}
+
+// rsync's rolling checksum of a block: a is the sum of its bytes and b the sum
+// of the running values of a, both mod 2^16. Sliding the block by one byte
+// only needs the byte that leaves and the one that enters.
+void weak_checksum(const unsigned char *data, int size, uint32_t *a, uint32_t *b)
+{
+    *a = 0;
+    *b = 0;
+    for (int i = 0; i < size; i++)
+    {
+        *a += data[i];
+        *b += (uint32_t)(size - i) * data[i];
+    }
+}
+
+// Slide the weak checksum (a, b) of a block of size bytes by one byte: out
+// leaves the block and in enters it
+void weak_checksum_roll(uint32_t *a, uint32_t *b, int size, unsigned char out, unsigned char in)
+{
+    *a += in - out;
+    *b += *a - (uint32_t)size * out;
+}
+
+// Send the signature of the basis: a START packet with its size and block
+// size, SIGNATURE packets with the checksums of every full block, and END
+int send_signature(const struct delta_basis *basis, const char *filename)
+{
+    struct file_info info;
+    if (file_info_init(&info, filename, basis->file_size) < 0)
+        return -1;
+    info.codec = CODEC_NONE;
+    info.block_size = basis->block_size;
+    if (send_control_packet(&ll_default_link, START, &info) < 0)
+        return -1;
+
+    unsigned char *packet = malloc(ll_max_payload_size());
+    if (packet == NULL)
+    {
+        printf("Failed to allocate packet buffer.\n");
+        return -1;
+    }
+
+    int per_packet = (ll_max_payload_size() - SIGNATURE_HEADER_SIZE) / SIGNATURE_ENTRY_SIZE;
+    int count = basis->file_size / basis->block_size;
+    int result = 1;
+    for (int first = 0; first < count && result > 0; first += per_packet)
+    {
+        int entries = count - first < per_packet ? count - first : per_packet;
+        packet[0] = SIGNATURE;
+        put_be(&packet[1], first, 4); // Index of the first block
+
+        for (int i = 0; i < entries && result > 0; i++)
+        {
+            long long offset = (long long)(first + i) * basis->block_size;
+            if (pread(basis->fd, basis->block, basis->block_size, offset) != basis->block_size)
+            {
+                printf("Failed to read the file at offset %lld.\n", offset);
+                result = -1;
+                break;
+            }
+
+            uint32_t a, b;
+            weak_checksum(basis->block, basis->block_size, &a, &b);
+            unsigned char *entry = &packet[SIGNATURE_HEADER_SIZE + i * SIGNATURE_ENTRY_SIZE];
+            put_be(entry, (a & 0xFFFF) | (b << 16), 4);
+            put_be(entry + 4, crc32(basis->block, basis->block_size), 4);
+            put_be(entry + 8, crc32c_update(0, basis->block, basis->block_size), 4);
+        }
+
+        if (result > 0 && llwrite(packet, SIGNATURE_HEADER_SIZE + entries * SIGNATURE_ENTRY_SIZE) < 0)
+        {
+            printf("Failed to send signature packet.\n");
+            result = -1;
+        }
+    }
+    free(packet);
+
+    if (result > 0 && send_control_packet(&ll_default_link, END, &info) < 0)
+        result = -1;
+    return result;
+}
+
+// Read the signature sent by the receiver (see send_signature) and index its
+// blocks by weak checksum.
+// Returns -1 on error, 1 otherwise.
+int read_signature(struct signature *signature)
+{
+    struct file_info info;
+    memset(signature, 0, sizeof(struct signature));
+    if (read_control_packet(&info) < 0)
+        return -1;
+
+    signature->block_size = info.block_size;
+    if (info.block_size < DELTA_MIN_BLOCK_SIZE || info.block_size > DELTA_MAX_BLOCK_SIZE ||
+        info.file_size / info.block_size > DELTA_MAX_BLOCKS)
+    {
+        printf("Invalid signature block size: %d\n", info.block_size);
+        return -1;
+    }
+    signature->count = info.file_size / info.block_size;
+
+    signature->table_bits = 1;
+    while ((1 << signature->table_bits) < signature->count)
+        signature->table_bits++;
+    signature->blocks = malloc((signature->count + 1) * sizeof(struct signature_block));
+    signature->next = malloc((signature->count + 1) * sizeof(int));
+    signature->heads = malloc((1 << signature->table_bits) * sizeof(int));
+    unsigned char *packet = malloc(ll_max_payload_size());
+    if (signature->blocks == NULL || signature->next == NULL || signature->heads == NULL || packet == NULL)
+    {
+        printf("Failed to allocate signature.\n");
+        free(packet);
+        return -1;
+    }
+    memset(signature->heads, 0xFF, (1 << signature->table_bits) * sizeof(int)); // Empty chains (-1)
+
+    int received = 0;
+    int result = 1;
+    while (result > 0)
+    {
+        int bytes_read = llread(packet);
+        if (bytes_read < 0)
+        {
+            printf("Failed to read signature packet.\n");
+            result = -1;
+        }
+        else if (packet[0] == END)
+            break;
+        else if (packet[0] == SIGNATURE && bytes_read >= SIGNATURE_HEADER_SIZE &&
+                 (bytes_read - SIGNATURE_HEADER_SIZE) % SIGNATURE_ENTRY_SIZE == 0)
+        {
+            int entries = (bytes_read - SIGNATURE_HEADER_SIZE) / SIGNATURE_ENTRY_SIZE;
+            if (get_be(&packet[1], 4) != (unsigned long long)received || entries > signature->count - received)
+            {
+                printf("Signature blocks out of order.\n");
+                result = -1;
+                break;
+            }
+            for (int i = 0; i < entries; i++)
+            {
+                const unsigned char *entry = &packet[SIGNATURE_HEADER_SIZE + i * SIGNATURE_ENTRY_SIZE];
+                struct signature_block *block = &signature->blocks[received];
+                block->weak = get_be(entry, 4);
+                block->crc32 = get_be(entry + 4, 4);
+                block->crc32c = get_be(entry + 8, 4);
+
+                int bucket = signature_bucket(signature, block->weak);
+                signature->next[received] = signature->heads[bucket];
+                signature->heads[bucket] = received++;
+            }
+        }
+    }
+    free(packet);
+
+    if (result > 0 && received != signature->count)
+    {
+        printf("Received %d of %d signature blocks.\n", received, signature->count);
+        result = -1;
+    }
+    return result;
+}
+
+// Chain of the signature blocks with the given weak checksum
+int signature_bucket(const struct signature *signature, uint32_t weak)
+{
+    return (weak * 0x9E3779B1u) >> (32 - signature->table_bits);
+}
+
+// Find a block of the receiver's copy equal to the block_size bytes at data,
+// whose weak checksum is weak. The CRCs are only computed on a weak match.
+// Returns the index of the block, or -1 if there is none.
+int signature_find(const struct signature *signature, const unsigned char *data, uint32_t weak)
+{
+    int checked = FALSE;
+    uint32_t crc = 0, crc_c = 0;
+    for (int i = signature->heads[signature_bucket(signature, weak)]; i >= 0; i = signature->next[i])
+    {
+        const struct signature_block *block = &signature->blocks[i];
+        if (block->weak != weak)
+            continue;
+        if (!checked)
+        {
+            crc = crc32(data, signature->block_size);
+            crc_c = crc32c_update(0, data, signature->block_size);
+            checked = TRUE;
+        }
+        if (block->crc32 == crc && block->crc32c == crc_c)
+            return i;
+    }
+    return -1;
+}
+
+void signature_free(struct signature *signature)
+{
+    free(signature->blocks);
+    free(signature->next);
+    free(signature->heads);
+    memset(signature, 0, sizeof(struct signature));
+}
+
+// Send a file against the signature of the receiver's copy: START, then
+// DATA_COPY packets for the blocks the receiver has and DATA_OFFSET packets
+// for the rest, then END with the checksum of the whole file. Files that
+// cannot be mapped are sent whole.
+int send_delta_file(const char *filename, const struct signature *signature)
+{
+    long long file_size;
+    const unsigned char *map;
+    int fd = open_file_source(filename, &file_size, &map); // Open file for reading
+    if (fd < 0)
+    {
+        return -1; // Error opening input file
+    }
+
+    struct file_info info;
+    int result = file_info_init(&info, filename, file_size);
+    if (map != NULL)
+        info.codec = CODEC_NONE; // Literal data is sent raw
+    if (result > 0)
+        result = send_control_packet(&ll_default_link, START, &info);
+
+    if (result > 0 && map != NULL)
+    {
+        result = send_delta_packets(map, file_size, signature);
+        info.checksum = crc32c_update(0, map, file_size);
+    }
+    else if (result > 0)
+        result = send_data_packets(fd, map, file_size, 0, &info.checksum);
+
+    info.has_checksum = AL_CHECKSUM;
+    if (result > 0 && send_control_packet(&ll_default_link, END, &info) < 0)
+        result = -1;
+
+    close_file_source(fd, map, file_size);
+    return result;
+}
+
+// Scan the file with the rolling checksum of a window of block_size bytes.
+// Where the window matches a block of the receiver, the block is copied and
+// the window jumps past it; otherwise it slides by one byte and the byte
+// that leaves it becomes literal data.
+int send_delta_packets(const unsigned char *map, long long file_size, const struct signature *signature)
+{
+    struct delta_sender sender;
+    memset(&sender, 0, sizeof(struct delta_sender));
+    sender.map = map;
+    sender.file_size = file_size;
+    sender.block_size = signature->block_size;
+    sender.packet = malloc(ll_max_payload_size());
+    if (sender.packet == NULL)
+    {
+        printf("Failed to allocate packet buffer.\n");
+        return -1;
+    }
+    int header_size = offset_header_size(file_size);
+    frame_sizer_init(&sender.sizer, LL_MIN_PAYLOAD_SIZE - header_size, ll_max_payload_size() - header_size, PACKET_OVERHEAD);
+    sender.start = ll_get_statistics(); // Only frames of this transfer count
+
+    int size = signature->block_size;
+    long long literal = 0; // First byte not sent yet
+    long long position = 0;
+    uint32_t a = 0, b = 0;
+    int rolling = FALSE;
+    int result = 1;
+
+    while (signature->count > 0 && position + size <= file_size && result > 0)
+    {
+        if (!rolling)
+        {
+            weak_checksum(map + position, size, &a, &b);
+            rolling = TRUE;
+        }
+
+        int block = signature_find(signature, map + position, (a & 0xFFFF) | (b << 16));
+        if (block >= 0)
+        {
+            if (delta_send_copy(&sender, literal, position, block) < 0)
+                result = -1;
+            position += size;
+            literal = position;
+            rolling = FALSE;
+            continue;
+        }
+
+        if (position + size < file_size)
+            weak_checksum_roll(&a, &b, size, map[position], map[position + size]);
+        position++;
+
+        // Send long runs of literal data as they grow
+        if (position - literal >= sender.sizer.size)
+        {
+            if (delta_flush_copy(&sender) < 0 || delta_send_literal(&sender, literal, literal + sender.sizer.size) < 0)
+                result = -1;
+            literal += sender.sizer.size;
+        }
+    }
+
+    if (result > 0 && (delta_flush_copy(&sender) < 0 || delta_send_literal(&sender, literal, file_size) < 0))
+        result = -1;
+
+    if (result > 0)
+        printf("Delta: %lld bytes sent as literal data, %lld copied from the receiver (%d blocks of %d bytes).\n",
+               sender.literal_bytes, sender.copied_bytes, signature->count, size);
+    free(sender.packet);
+    return result;
+}
+
+// Copy the block of the receiver at the given index to position, after the
+// literal data from literal on. Runs of consecutive blocks go in one packet.
+int delta_send_copy(struct delta_sender *sender, long long literal, long long position, int block)
+{
+    if (sender->copy_count > 0 && literal == position && block == sender->copy_block + sender->copy_count &&
+        sender->copy_count < DELTA_MAX_COPY_BLOCKS)
+    {
+        sender->copy_count++; // Extends the run
+        return 1;
+    }
+
+    if (delta_flush_copy(sender) < 0 || delta_send_literal(sender, literal, position) < 0)
+        return -1;
+    sender->copy_offset = position;
+    sender->copy_block = block;
+    sender->copy_count = 1;
+    return 1;
+}
+
+// Send the pending run of copied blocks as a DATA_COPY packet
+int delta_flush_copy(struct delta_sender *sender)
+{
+    if (sender->copy_count == 0)
+        return 1;
+
+    sender->packet[0] = DATA_COPY;                     // Packet type
+    put_be(&sender->packet[1], sender->copy_offset, 8); // Offset in the file
+    put_be(&sender->packet[9], sender->copy_block, 4);  // First block of the receiver's copy
+    put_be(&sender->packet[13], sender->copy_count, 4); // Number of blocks
+    sender->copied_bytes += (long long)sender->copy_count * sender->block_size;
+    sender->copy_count = 0;
+    return delta_send_packet(sender, DATA_COPY_SIZE);
+}
+
+// Send the file bytes in [from, to) as DATA_OFFSET packets
+int delta_send_literal(struct delta_sender *sender, long long from, long long to)
+{
+    while (from < to)
+    {
+        int data_size = to - from < sender->sizer.size ? to - from : sender->sizer.size;
+        int header_size = build_offset_header(sender->packet, FALSE, from, data_size);
+        memcpy(&sender->packet[header_size], sender->map + from, data_size);
+        if (delta_send_packet(sender, header_size + data_size) < 0)
+            return -1;
+        sender->literal_bytes += data_size;
+        from += data_size;
+    }
+    return 1;
+}
+
+// Send a packet of a delta transfer and adapt the size of literal data to the
+// frame error rate
+int delta_send_packet(struct delta_sender *sender, int size)
+{
+    if (llwrite(sender->packet, size) < 0)
+    {
+        printf("Failed to send data packet.\n");
+        return -1;
+    }
+
+    if (LL_ADAPTIVE_PAYLOAD)
+    {
+        struct ll_statistics now = ll_get_statistics();
+        if (frame_sizer_update(&sender->sizer, now.num_I_frames_sent - sender->start.num_I_frames_sent,
+                               failed_frames(now) - failed_frames(sender->start)))
+        {
+            printf("Packet data size: %d bytes (estimated byte error rate %.2e)\n",
+                   sender->sizer.size, sender->sizer.byte_error_rate);
+        }
+    }
+    return 1;
+}
+
+// Write the blocks of the basis a DATA_COPY packet asks for at their offset
+// in the new file, adding them to its checksum.
+// Returns the number of file bytes written, or -1 on error.
+long long copy_basis_blocks(int fd, const struct delta_basis *basis, const unsigned char *packet, int size,
+                            long long file_size, struct file_checksum *checksum)
+{
+    if (size != DATA_COPY_SIZE)
+    {
+        printf("Malformed copy packet of %d bytes.\n", size);
+        return -1;
+    }
+
+    long long offset = get_be(&packet[1], 8) > LLONG_MAX ? -1 : (long long)get_be(&packet[1], 8);
+    long long first = get_be(&packet[9], 4);
+    long long count = get_be(&packet[13], 4);
+    long long length = count * basis->block_size;
+    if (offset < 0 || offset > file_size || length > file_size - offset ||
+        (first + count) * basis->block_size > basis->file_size)
+    {
+        printf("Malformed copy packet of %d bytes.\n", size);
+        return -1;
+    }
+
+    for (long long i = 0; i < count; i++)
+    {
+        long long from = (first + i) * basis->block_size;
+        long long to = offset + i * basis->block_size;
+        if (pread(basis->fd, basis->block, basis->block_size, from) != basis->block_size ||
+            pwrite(fd, basis->block, basis->block_size, to) != basis->block_size)
+        {
+            printf("Failed to copy the block at offset %lld.\n", from);
+            return -1;
+        }
+        file_checksum_update(checksum, basis->block, basis->block_size, to);
+    }
+    return length;
+}
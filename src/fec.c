@@ -0,0 +1,311 @@
+// Reed-Solomon forward error correction.
+// Codes over GF(256) with the primitive polynomial x^8 + x^4 + x^3 + x^2 + 1
+// and generator roots alpha^0 .. alpha^(parity - 1). Short blocks are
+// shortened codes: the missing leading bytes are taken as zeros.
+// Decoding: syndromes, Berlekamp-Massey for the error locator, Chien search
+// for the error positions and Forney's formula for the error values.
+
+#include "fec.h"
+#include <pthread.h>
+#include <string.h>
+
+#define GF_POLYNOMIAL 0x11D // x^8 + x^4 + x^3 + x^2 + 1
+
+// Helper Functions prototypes
+void gf_build_tables();
+unsigned char gf_mul(unsigned char a, unsigned char b);
+unsigned char gf_div(unsigned char a, unsigned char b);
+unsigned char gf_pow_alpha(int power);
+void fec_build_generators();
+void fec_encode_block(const unsigned char *data, int len, int parity, unsigned char *out);
+int fec_syndromes(const unsigned char *block, int len, int parity, unsigned char *syndromes);
+int fec_decode_block(unsigned char *block, int len, int parity);
+
+// Exponent and logarithm tables of GF(256), built on first use (once,
+// whatever the number of links).
+// gf_exp is doubled so the sum of two logarithms needs no reduction.
+unsigned char gf_exp[2 * FEC_BLOCK_SIZE];
+unsigned char gf_log[256];
+pthread_once_t gf_once = PTHREAD_ONCE_INIT;
+
+// Generator polynomials (highest degree first), indexed by the number of parity bytes
+unsigned char fec_generators[FEC_MAX_PARITY + 1][FEC_MAX_PARITY + 1];
+
+// Size of len bytes of data once encoded
+int fec_encoded_size(int len, int parity)
+{
+    if (parity <= 0)
+        return len;
+
+    int block_data = FEC_BLOCK_SIZE - parity;
+    int blocks = (len + block_data - 1) / block_data;
+    return len + blocks * parity;
+}
+
+// Encode len bytes of data into out (fec_encoded_size(len, parity) bytes).
+// Returns the encoded size.
+int fec_encode(const unsigned char *data, int len, int parity, unsigned char *out)
+{
+    if (parity <= 0)
+    {
+        memcpy(out, data, len);
+        return len;
+    }
+
+    pthread_once(&gf_once, gf_build_tables);
+
+    int block_data = FEC_BLOCK_SIZE - parity;
+    int size = 0;
+    for (int i = 0; i < len; i += block_data)
+    {
+        int chunk = (len - i < block_data) ? len - i : block_data;
+        memcpy(out + size, data + i, chunk);
+        fec_encode_block(data + i, chunk, parity, out + size + chunk);
+        size += chunk + parity;
+    }
+    return size;
+}
+
+// Repair the encoded data in buf and remove the parity bytes, in place.
+// corrected receives the number of bytes repaired.
+// Returns the size of the data, or -1 if a block has too many errors.
+int fec_decode(unsigned char *buf, int len, int parity, int *corrected)
+{
+    *corrected = 0;
+    if (parity <= 0)
+        return len;
+
+    int size = 0;
+    for (int i = 0; i < len; i += FEC_BLOCK_SIZE)
+    {
+        int block = (len - i < FEC_BLOCK_SIZE) ? len - i : FEC_BLOCK_SIZE;
+        if (block <= parity)
+            return -1; // Truncated block
+
+        int errors = fec_decode_block(buf + i, block, parity);
+        if (errors < 0)
+            return -1; // Too many errors to repair
+
+        *corrected += errors;
+        memmove(buf + size, buf + i, block - parity); // Keep only the data
+        size += block - parity;
+    }
+    return size;
+}
+
+////////////////////////////////////////////////
+// GALOIS FIELD ARITHMETIC
+////////////////////////////////////////////////
+
+// Build the exponent and logarithm tables
+void gf_build_tables()
+{
+    int value = 1;
+    for (int i = 0; i < FEC_BLOCK_SIZE; i++)
+    {
+        gf_exp[i] = value;
+        gf_exp[i + FEC_BLOCK_SIZE] = value;
+        gf_log[value] = i;
+
+        value <<= 1; // Multiply by alpha
+        if (value & 0x100)
+            value ^= GF_POLYNOMIAL;
+    }
+    gf_log[0] = 0; // Undefined, never used
+
+    fec_build_generators();
+}
+
+unsigned char gf_mul(unsigned char a, unsigned char b)
+{
+    if (a == 0 || b == 0)
+        return 0;
+    return gf_exp[gf_log[a] + gf_log[b]];
+}
+
+// a / b, with b != 0
+unsigned char gf_div(unsigned char a, unsigned char b)
+{
+    if (a == 0)
+        return 0;
+    return gf_exp[gf_log[a] + FEC_BLOCK_SIZE - gf_log[b]];
+}
+
+// alpha^power, for any power >= 0
+unsigned char gf_pow_alpha(int power)
+{
+    return gf_exp[power % FEC_BLOCK_SIZE];
+}
+
+////////////////////////////////////////////////
+// ENCODER
+////////////////////////////////////////////////
+
+// Build the generator polynomials (x - alpha^0) ... (x - alpha^(parity - 1)),
+// each one from the previous: a link may use any number of parity bytes
+void fec_build_generators()
+{
+    memset(fec_generators, 0, sizeof(fec_generators));
+    fec_generators[0][0] = 1;
+    for (int j = 0; j < FEC_MAX_PARITY; j++)
+    {
+        // Multiply by (x + alpha^j), highest degree first
+        unsigned char root = gf_pow_alpha(j);
+        memcpy(fec_generators[j + 1], fec_generators[j], FEC_MAX_PARITY + 1);
+        for (int i = j + 1; i > 0; i--)
+            fec_generators[j + 1][i] ^= gf_mul(fec_generators[j][i - 1], root);
+    }
+}
+
+// Compute the parity bytes of a block: the remainder of data * x^parity
+// divided by the generator polynomial
+void fec_encode_block(const unsigned char *data, int len, int parity, unsigned char *out)
+{
+    memset(out, 0, parity);
+
+    for (int i = 0; i < len; i++)
+    {
+        unsigned char feedback = data[i] ^ out[0];
+        memmove(out, out + 1, parity - 1);
+        out[parity - 1] = 0;
+
+        if (feedback != 0)
+        {
+            for (int j = 0; j < parity; j++)
+                out[j] ^= gf_mul(feedback, fec_generators[parity][j + 1]);
+        }
+    }
+}
+
+////////////////////////////////////////////////
+// DECODER
+////////////////////////////////////////////////
+
+// Evaluate the block at the generator roots.
+// Returns 1 if any syndrome is not zero (the block is damaged), 0 otherwise.
+int fec_syndromes(const unsigned char *block, int len, int parity, unsigned char *syndromes)
+{
+    int damaged = 0;
+    for (int j = 0; j < parity; j++)
+    {
+        unsigned char root = gf_pow_alpha(j);
+        unsigned char value = 0;
+        for (int i = 0; i < len; i++)
+            value = gf_mul(value, root) ^ block[i]; // Horner's rule
+        syndromes[j] = value;
+        damaged |= value != 0;
+    }
+    return damaged;
+}
+
+// Repair a block of len bytes (data and parity) in place.
+// Returns the number of bytes repaired, or -1 if the block cannot be repaired.
+int fec_decode_block(unsigned char *block, int len, int parity)
+{
+    pthread_once(&gf_once, gf_build_tables);
+
+    unsigned char syndromes[FEC_MAX_PARITY];
+    if (!fec_syndromes(block, len, parity, syndromes))
+        return 0; // No errors
+
+    // Berlekamp-Massey: error locator polynomial (lowest degree first)
+    unsigned char locator[FEC_MAX_PARITY + 1] = {1};
+    unsigned char previous[FEC_MAX_PARITY + 1] = {1};
+    int errors = 0;         // Degree of the locator
+    int shift = 1;          // Steps since previous was last updated
+    unsigned char last = 1; // Discrepancy when previous was last updated
+
+    for (int r = 0; r < parity; r++)
+    {
+        unsigned char discrepancy = syndromes[r];
+        for (int i = 1; i <= errors; i++)
+            discrepancy ^= gf_mul(locator[i], syndromes[r - i]);
+
+        if (discrepancy == 0)
+        {
+            shift++;
+            continue;
+        }
+
+        unsigned char saved[FEC_MAX_PARITY + 1];
+        memcpy(saved, locator, sizeof(saved));
+
+        unsigned char scale = gf_div(discrepancy, last);
+        for (int i = 0; i + shift <= parity; i++)
+            locator[i + shift] ^= gf_mul(scale, previous[i]);
+
+        if (2 * errors <= r)
+        {
+            errors = r + 1 - errors;
+            memcpy(previous, saved, sizeof(previous));
+            last = discrepancy;
+            shift = 1;
+        }
+        else
+        {
+            shift++;
+        }
+    }
+
+    if (2 * errors > parity)
+        return -1; // More errors than the code can repair
+
+    // Error evaluator: syndromes * locator mod x^parity (lowest degree first)
+    unsigned char evaluator[FEC_MAX_PARITY] = {0};
+    for (int i = 0; i < parity; i++)
+    {
+        for (int j = 0; j <= errors && j <= i; j++)
+            evaluator[i] ^= gf_mul(syndromes[i - j], locator[j]);
+    }
+
+    // Chien search over the positions of the (possibly shortened) block.
+    // Byte i holds the coefficient of x^(len - 1 - i), so its locator is
+    // X = alpha^(len - 1 - i) and the locator polynomial vanishes at 1/X.
+    int found = 0;
+    for (int i = 0; i < len && found < errors; i++)
+    {
+        int power = len - 1 - i;
+        unsigned char inverse = gf_pow_alpha(FEC_BLOCK_SIZE - power);
+
+        unsigned char value = 0;
+        unsigned char term = 1;
+        for (int k = 0; k <= errors; k++)
+        {
+            value ^= gf_mul(locator[k], term);
+            term = gf_mul(term, inverse);
+        }
+        if (value != 0)
+            continue;
+
+        // Forney: error value = X * evaluator(1/X) / locator'(1/X)
+        unsigned char numerator = 0;
+        term = 1;
+        for (int k = 0; k < parity; k++)
+        {
+            numerator ^= gf_mul(evaluator[k], term);
+            term = gf_mul(term, inverse);
+        }
+
+        unsigned char denominator = 0; // Formal derivative: odd terms only
+        term = 1;
+        for (int k = 1; k <= errors; k += 2)
+        {
+            denominator ^= gf_mul(locator[k], term);
+            term = gf_mul(term, gf_mul(inverse, inverse));
+        }
+        if (denominator == 0)
+            return -1;
+
+        block[i] ^= gf_mul(gf_pow_alpha(power), gf_div(numerator, denominator));
+        found++;
+    }
+
+    if (found != errors)
+        return -1; // Locator roots outside the block: too many errors
+
+    // Guard against miscorrection beyond the capacity of the code
+    if (fec_syndromes(block, len, parity, syndromes))
+        return -1;
+
+    return errors;
+}
@@ -0,0 +1,61 @@
+#include "file_checksum.h"
+#include "frame_check.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define CHECKSUM_CHUNK_SIZE (64 * 1024) // Bytes read at a time to checksum the start of a file
+
+// CRC-32C of the first size bytes of a file (read from map when it is
+// mapped), for the part of a resumed transfer that is not sent again.
+// Returns -1 if the file cannot be read, 1 otherwise.
+int checksum_file_start(int fd, const unsigned char *map, long long size, uint32_t *checksum)
+{
+    *checksum = 0;
+    if (size <= 0)
+        return 1;
+    if (map != NULL)
+    {
+        *checksum = crc32c_update(0, map, size);
+        return 1;
+    }
+
+    unsigned char *chunk = malloc(CHECKSUM_CHUNK_SIZE);
+    if (chunk == NULL)
+    {
+        printf("Failed to allocate checksum buffer.\n");
+        return -1;
+    }
+
+    long long offset = 0;
+    while (offset < size)
+    {
+        int length = size - offset < CHECKSUM_CHUNK_SIZE ? size - offset : CHECKSUM_CHUNK_SIZE;
+        if (pread(fd, chunk, length, offset) != length)
+        {
+            printf("Failed to read the file at offset %lld.\n", offset);
+            free(chunk);
+            return -1;
+        }
+        *checksum = crc32c_update(*checksum, chunk, length);
+        offset += length;
+    }
+
+    free(chunk);
+    return 1;
+}
+
+// Add size bytes of data written at offset to the checksum of a file, which
+// only follows data arriving in order
+void file_checksum_update(struct file_checksum *checksum, const unsigned char *data, int size, long long offset)
+{
+    if (checksum->offset < 0)
+        return; // Already out of order
+    if (offset != checksum->offset)
+    {
+        checksum->offset = -1;
+        return;
+    }
+    checksum->value = crc32c_update(checksum->value, data, size);
+    checksum->offset += size;
+}
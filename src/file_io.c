@@ -0,0 +1,101 @@
+#include "file_io.h"
+#include "app_config.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Open the file to send and map it for sequential reading. *map is left NULL
+// if the file is empty or cannot be mapped; it is then read instead.
+// Returns the file descriptor, or -1 on error.
+int open_file_source(const char *filename, long long *file_size, const unsigned char **map)
+{
+    int fd = open(filename, O_RDONLY);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) < 0)
+    {
+        printf("Error opening file: %s\n", filename);
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    *file_size = status.st_size;
+    *map = NULL;
+    if (*file_size > 0)
+    {
+        void *pages = mmap(NULL, *file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (pages != MAP_FAILED)
+        {
+            madvise(pages, *file_size, MADV_SEQUENTIAL); // Read ahead aggressively, pages behind are dropped first
+            *map = pages;
+        }
+    }
+    return fd;
+}
+
+// Unmap and close the file to send
+void close_file_source(int fd, const unsigned char *map, long long file_size)
+{
+    if (map != NULL)
+        munmap((void *)map, file_size);
+    close(fd);
+}
+
+// Drop the pages of a mapped file between offsets from and to, already sent,
+// so a large file never holds more than a few blocks in memory.
+// Returns the offset the next call starts from (the end of the last page dropped).
+long long release_mapped_pages(const unsigned char *map, long long from, long long to)
+{
+    long page_size = sysconf(_SC_PAGESIZE);
+    long long end = to - to % page_size; // Pages still partly needed stay
+    if (end > from)
+        madvise((void *)(map + from), end - from, MADV_DONTNEED);
+    return end > from ? end : from;
+}
+
+// Create the file to receive, truncated unless a transfer is resumed into it.
+// Returns the file descriptor, or -1 on error.
+int open_file_sink(const char *filename, int truncate)
+{
+    int fd = open(filename, O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0), 0644); // Read back to checksum a resumed file
+    if (fd < 0)
+        printf("Error opening file for writing: %s\n", filename);
+    return fd;
+}
+
+// Reserve the blocks of the whole file (size told by the START packet), so
+// data packets written at their offsets do not fragment it and a full disk is
+// found before the transfer. File systems without fallocate are not an error.
+// Returns -1 if there is no room for the file, 1 otherwise.
+int preallocate_file_sink(int fd, long long file_size)
+{
+    if (file_size <= 0)
+        return 1;
+
+    int error = posix_fallocate(fd, 0, file_size);
+    if (error != 0 && error != EOPNOTSUPP && error != EINVAL)
+    {
+        printf("Failed to allocate %lld bytes for the file: %s\n", file_size, strerror(error));
+        return -1;
+    }
+    return 1;
+}
+
+// Flush the received file as AL_FSYNC asks and close it.
+// Returns -1 on error, 1 otherwise.
+int close_file_sink(int fd)
+{
+    int result = 1;
+    if ((AL_FSYNC == AL_FSYNC_DATA && fdatasync(fd) < 0) || (AL_FSYNC == AL_FSYNC_FULL && fsync(fd) < 0))
+    {
+        printf("Failed to flush the file: %s\n", strerror(errno));
+        result = -1;
+    }
+    if (close(fd) < 0)
+        result = -1;
+    return result;
+}
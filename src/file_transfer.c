@@ -0,0 +1,286 @@
+#include "file_transfer.h"
+#include "app_config.h"
+#include "delta.h"
+#include "file_io.h"
+#include "frame_sizer.h"
+#include "journal.h"
+#include "tx_pipeline.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Helper Functions prototypes
+int read_data_packets(int fd, const struct file_info *info, struct journal *journal, const struct delta_basis *basis);
+
+// Open the default link. With AL_RESUME the receiver offers the bytes of the
+// output file it already holds (see journal_offer).
+int open_link(LinkLayer connection_parameters, const char *filename)
+{
+    if (!AL_RESUME)
+        return llopen(connection_parameters);
+
+    unsigned char offer[RESUME_OFFER_SIZE];
+    int offer_size = 0;
+    if (connection_parameters.role == LlRx)
+        offer_size = journal_offer(filename, offer);
+    return llopen_reply(connection_parameters, offer, offer_size);
+}
+
+// Read incoming data packets and write each one straight to its place in the
+// output file, which already holds the bytes before info->resume_offset.
+// The journal (if kept) follows the bytes written. DATA_COPY packets of a
+// delta transfer take their blocks from basis.
+int read_data_packets(int fd, const struct file_info *info, struct journal *journal, const struct delta_basis *basis)
+{
+    // Buffers sized for the agreed payload
+    unsigned char *data_packet = malloc(ll_max_payload_size());
+    int block_size = ll_max_payload_size() - DATA_HEADER_SIZE; // Largest decompressed block
+    unsigned char *block = malloc(block_size);
+    if (data_packet == NULL || block == NULL)
+    {
+        printf("Failed to allocate packet buffers.\n");
+        free(data_packet);
+        free(block);
+        return -1;
+    }
+
+    long long offset = info->resume_offset;         // Offset of the next DATA packet, which carries none
+    long long received_bytes = info->resume_offset; // File bytes written
+    int result = 1;
+
+    // The checksum covers the whole file, including the bytes kept from an
+    // interrupted transfer
+    struct file_checksum checksum = {0, AL_CHECKSUM ? info->resume_offset : -1};
+    if (AL_CHECKSUM && checksum_file_start(fd, NULL, info->resume_offset, &checksum.value) < 0)
+        checksum.offset = -1;
+
+    while (result > 0)
+    {
+        int bytes_read = llread(data_packet); // Read data packet
+
+        if (bytes_read < 0)
+        {
+            printf("Failed to read data packet.\n");
+            result = -1; // Error reading data packet
+            break;
+        }
+
+        // Check for end packet
+        if (data_packet[0] == END)
+        {
+            if (check_end_packet(data_packet, bytes_read, info->name, info->file_size) < 0)
+            {
+                printf("Start and End control packet mismatch!\n");
+            }
+            if (AL_CHECKSUM && checksum.offset != info->file_size &&
+                checksum_file_start(fd, NULL, info->file_size, &checksum.value) > 0)
+                checksum.offset = info->file_size; // Data came out of order: read the file back
+            if (check_file_checksum(data_packet, bytes_read, &checksum) < 0)
+            {
+                result = -1; // Damaged file
+                if (journal != NULL)
+                    journal->committed = 0; // Nothing received can be trusted
+            }
+            break; // End packet received
+        }
+
+        int compressed = data_packet[0] == DATA_LZ || data_packet[0] == DATA_LZ_OFFSET || data_packet[0] == DATA_LZ_OFFSET64;
+        if (data_header_size(data_packet[0]) > 0 && (!compressed || info->codec == CODEC_LZ))
+        {
+            int written = write_data_packet(fd, data_packet, bytes_read, block, block_size, info->file_size, &offset, &checksum);
+            if (written < 0)
+                result = -1; // Damaged packet, or the file could not be written
+            else
+            {
+                if (journal != NULL && offset == journal->committed)
+                    journal_commit(journal, fd, offset + written); // Packets arrive in file order
+                offset += written;
+                received_bytes += written;
+            }
+        }
+        else if (data_packet[0] == DATA_COPY && basis != NULL)
+        {
+            long long copied = copy_basis_blocks(fd, basis, data_packet, bytes_read, info->file_size, &checksum);
+            if (copied < 0)
+                result = -1; // Damaged packet, or the blocks could not be copied
+            else
+                received_bytes += copied;
+        }
+    }
+
+    // The link delivers every packet once, so the bytes add up to the file
+    if (result > 0 && received_bytes != info->file_size)
+    {
+        printf("Received %lld of %lld bytes.\n", received_bytes, info->file_size);
+        result = -1;
+    }
+
+    free(data_packet);
+    free(block);
+    return result; // Successfully processed all packets
+}
+
+// Handle the receiver role and manage the file reception
+int handle_receiver(const char *filename)
+{
+    struct file_info info;
+
+    // Read the control packet to get file info
+    if (read_control_packet(&info) < 0)
+    {
+        return -1; // Error reading control packet
+    }
+
+    return receive_file(filename, &info, NULL);
+}
+
+// Receive the data of the file announced by a START packet into filename,
+// up to its END packet (copying blocks from basis, if not NULL)
+int receive_file(const char *filename, const struct file_info *info, const struct delta_basis *basis)
+{
+    // A resumed transfer continues the file the journal describes
+    struct journal journal;
+    if (journal_start(&journal, filename, info) < 0)
+    {
+        return -1; // Cannot resume
+    }
+    if (info->resume_offset > 0)
+        printf("Resuming at byte %lld of %lld.\n", info->resume_offset, info->file_size);
+
+    // Open file for writing, with room for the whole file
+    int fd = open_file_sink(filename, info->resume_offset == 0);
+    if (fd < 0)
+    {
+        journal_finish(&journal, filename, FALSE);
+        return -1; // Error opening output file
+    }
+    if (preallocate_file_sink(fd, info->file_size) < 0)
+    {
+        close_file_sink(fd);
+        journal_finish(&journal, filename, FALSE);
+        return -1; // No room for the file
+    }
+
+    // Read and process data packets
+    int result = read_data_packets(fd, info, journal.fd >= 0 ? &journal : NULL, basis);
+
+    if (close_file_sink(fd) < 0) // Flushed as AL_FSYNC asks
+        result = -1;
+    journal_finish(&journal, filename, result > 0); // Kept up to date if the transfer stopped early
+    return result;
+}
+
+// Send data packets from the file (read from map when it is mapped), and
+// give the CRC-32C of the whole file in *checksum
+int send_data_packets(int fd, const unsigned char *map, long long file_size, long long start_offset, uint32_t *checksum)
+{
+    // Size of the file data in each packet, adapted to the frame error rate
+    int header_size = offset_header_size(file_size);
+    struct frame_sizer sizer;
+    frame_sizer_init(&sizer, LL_MIN_PAYLOAD_SIZE - header_size, ll_max_payload_size() - header_size, PACKET_OVERHEAD);
+    struct ll_statistics start = ll_get_statistics(); // Only frames of this transfer count
+
+    // Packets are read, compressed and encoded ahead of the link
+    struct tx_pipeline pipeline;
+    if (tx_pipeline_start(&pipeline, fd, map, file_size, start_offset, sizer.size) < 0)
+        return -1;
+
+    int result = 1;
+    struct encoded_frame *frame;
+    while ((frame = spsc_ring_pop(&pipeline.ready)) != NULL)
+    {
+        if (ll_write_encoded(&ll_default_link, frame) < 0)
+        {
+            printf("Failed to send data packet.\n");
+            result = -1; // Error sending data packet
+            break;
+        }
+        spsc_ring_push(&pipeline.sent, frame); // The framer may reuse the buffer
+
+        if (LL_ADAPTIVE_PAYLOAD)
+        {
+            struct ll_statistics now = ll_get_statistics();
+            if (frame_sizer_update(&sizer, now.num_I_frames_sent - start.num_I_frames_sent,
+                                   failed_frames(now) - failed_frames(start)))
+            {
+                printf("Packet data size: %d bytes (estimated byte error rate %.2e)\n",
+                       sizer.size, sizer.byte_error_rate);
+                atomic_store(&pipeline.block_size, sizer.size); // Blocks read from now on
+            }
+        }
+    }
+
+    if (tx_pipeline_stop(&pipeline) < 0)
+        result = -1; // A packet could not be encoded
+    *checksum = pipeline.checksum;
+    return result; // Successfully sent all data packets
+}
+
+// Handle the transmitter role and manage the file transmission
+int handle_transmitter(const char *filename)
+{
+    return send_file(filename, filename, AL_RESUME, FALSE);
+}
+
+// Send the file at path under the given name: START, data packets and END.
+// A resumable file skips the bytes the receiver offered to keep; next_file
+// tells the receiver another file follows in the session.
+int send_file(const char *path, const char *name, int resumable, int next_file)
+{
+    long long file_size;
+    const unsigned char *map;
+    int fd = open_file_source(path, &file_size, &map); // Open file for reading
+    if (fd < 0)
+    {
+        return -1; // Error opening input file
+    }
+
+    struct file_info info;
+    if (file_info_init(&info, name, file_size) < 0)
+    {
+        close_file_source(fd, map, file_size);
+        return -1; // Name does not fit the control packets
+    }
+    info.next_file = next_file;
+
+    // With AL_RESUME, skip the bytes the receiver already holds
+    if (resumable)
+    {
+        info.tag = file_tag(name, fd, file_size);
+        info.resume_offset = resume_offset(info.tag, file_size);
+    }
+    if (info.resume_offset > 0)
+        printf("Resuming at byte %lld of %lld.\n", info.resume_offset, file_size);
+
+    // Send start control packet with file info
+    if (send_control_packet(&ll_default_link, START, &info) < 0)
+    {
+        close_file_source(fd, map, file_size);
+        return -1; // Error sending start control packet
+    }
+
+    // Send data packets
+    if (send_data_packets(fd, map, file_size, info.resume_offset, &info.checksum) < 0)
+    {
+        close_file_source(fd, map, file_size);
+        return -1; // Error sending data packets
+    }
+
+    // Send end control packet
+    info.has_checksum = AL_CHECKSUM;
+    if (send_control_packet(&ll_default_link, END, &info) < 0)
+    {
+        close_file_source(fd, map, file_size);
+        return -1; // Error sending end control packet
+    };
+
+    close_file_source(fd, map, file_size); // Close input file
+    return 1;                              // Successfully sent file
+}
+
+// I frames that failed: rejected, or timed out at the configured timeout. An
+// earlier adaptive timeout may only mean the estimate was low, and counting it
+// would make a clean link look noisy.
+int failed_frames(struct ll_statistics statistics)
+{
+    return statistics.num_REJ_received + statistics.num_SREJ_received + statistics.num_full_timeouts;
+}
@@ -0,0 +1,260 @@
+// Frame check sequences for I frames, and the CRC-32C of whole files.
+// The CRCs are computed with slicing-by-8: eight lookup tables let the loop
+// consume eight bytes per step instead of one. CRC-32C uses the SSE4.2 crc32
+// instruction instead when the CPU has it.
+
+#include "frame_check.h"
+#include <pthread.h>
+#include <string.h>
+
+#if LL_SIMD && defined(__x86_64__)
+#define FRAME_CHECK_X86 1
+#include <nmmintrin.h>
+#else
+#define FRAME_CHECK_X86 0
+#endif
+
+#define CRC16_POLYNOMIAL 0x8408      // 0x1021 bit-reversed
+#define CRC32_POLYNOMIAL 0xEDB88320  // 0x04C11DB7 bit-reversed
+#define CRC32C_POLYNOMIAL 0x82F63B78 // 0x1EDC6F41 bit-reversed
+
+// Helper Functions prototypes
+void crc16_init();
+void crc32_init();
+void crc32c_init();
+uint32_t crc32c_scalar(uint32_t crc, const unsigned char *data, size_t len);
+#if FRAME_CHECK_X86
+uint32_t crc32c_sse42(uint32_t crc, const unsigned char *data, size_t len);
+#endif
+void crc_build_tables(uint32_t tables[8][256], uint32_t polynomial);
+uint32_t crc_update(uint32_t tables[8][256], uint32_t crc, const unsigned char *data, size_t len);
+
+// Lookup tables, built on first use (once, whatever the number of links)
+uint32_t crc16_tables[8][256];
+uint32_t crc32_tables[8][256];
+uint32_t crc32c_tables[8][256];
+pthread_once_t crc16_once = PTHREAD_ONCE_INIT;
+pthread_once_t crc32_once = PTHREAD_ONCE_INIT;
+pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+// CRC-32C implementation, picked on first use
+uint32_t (*crc32c_impl)(uint32_t crc, const unsigned char *data, size_t len) = NULL;
+const char *crc32c_name = "scalar";
+
+// Number of check bytes appended to the data of an I frame
+int frame_check_size(int type)
+{
+    switch (type)
+    {
+    case LL_CHECK_CRC16:
+        return 2;
+    case LL_CHECK_CRC32:
+        return 4;
+    default:
+        return 1; // BCC2
+    }
+}
+
+// Start a check sequence of the given type
+void frame_check_begin(struct frame_check *check, int type)
+{
+    check->type = type;
+    switch (type)
+    {
+    case LL_CHECK_CRC16:
+        pthread_once(&crc16_once, crc16_init);
+        check->value = 0xFFFF;
+        break;
+    case LL_CHECK_CRC32:
+        pthread_once(&crc32_once, crc32_init);
+        check->value = 0xFFFFFFFF;
+        break;
+    default:
+        check->value = 0; // BCC2
+        break;
+    }
+}
+
+// Add len bytes of data to the check sequence
+void frame_check_update(struct frame_check *check, const unsigned char *data, size_t len)
+{
+    switch (check->type)
+    {
+    case LL_CHECK_CRC16:
+        check->value = crc_update(crc16_tables, check->value, data, len);
+        break;
+    case LL_CHECK_CRC32:
+        check->value = crc_update(crc32_tables, check->value, data, len);
+        break;
+    default:
+        for (size_t i = 0; i < len; i++)
+            check->value ^= data[i]; // BCC2
+        break;
+    }
+}
+
+// Finish the check sequence into bytes (least significant byte first).
+// Returns the number of check bytes.
+int frame_check_end(struct frame_check *check, unsigned char *bytes)
+{
+    uint32_t value = check->value;
+    if (check->type == LL_CHECK_CRC16)
+        value ^= 0xFFFF;
+    else if (check->type == LL_CHECK_CRC32)
+        value ^= 0xFFFFFFFF;
+
+    int size = frame_check_size(check->type);
+    for (int i = 0; i < size; i++)
+        bytes[i] = (value >> (8 * i)) & 0xFF;
+    return size;
+}
+
+// Compute the check sequence of data into check (least significant byte first).
+// Returns the number of check bytes.
+int frame_check_compute(int type, const unsigned char *data, size_t len, unsigned char *check)
+{
+    struct frame_check state;
+    frame_check_begin(&state, type);
+    frame_check_update(&state, data, len);
+    return frame_check_end(&state, check);
+}
+
+// Returns 1 if check holds the check sequence of data, 0 otherwise
+int frame_check_verify(int type, const unsigned char *data, size_t len, const unsigned char *check)
+{
+    unsigned char expected[MAX_CHECK_SIZE];
+    int size = frame_check_compute(type, data, len, expected);
+
+    for (int i = 0; i < size; i++)
+    {
+        if (check[i] != expected[i])
+            return 0;
+    }
+    return 1;
+}
+
+// CRC-16-CCITT as used by HDLC (CRC-16/X-25: reflected, init and final XOR 0xFFFF)
+uint16_t crc16_ccitt(const unsigned char *data, size_t len)
+{
+    pthread_once(&crc16_once, crc16_init);
+    return crc_update(crc16_tables, 0xFFFF, data, len) ^ 0xFFFF;
+}
+
+// CRC-32 as used by HDLC and Ethernet (reflected 0x04C11DB7, init and final XOR 0xFFFFFFFF)
+uint32_t crc32(const unsigned char *data, size_t len)
+{
+    pthread_once(&crc32_once, crc32_init);
+    return crc_update(crc32_tables, 0xFFFFFFFF, data, len) ^ 0xFFFFFFFF;
+}
+
+// CRC-32C (Castagnoli: reflected 0x1EDC6F41, init and final XOR 0xFFFFFFFF)
+// of data, continuing the CRC-32C crc of the data before it (0 to start)
+uint32_t crc32c_update(uint32_t crc, const unsigned char *data, size_t len)
+{
+    pthread_once(&crc32c_once, crc32c_init);
+    return crc32c_impl(crc ^ 0xFFFFFFFF, data, len) ^ 0xFFFFFFFF;
+}
+
+// Name of the CRC-32C implementation in use ("sse4.2" or "scalar")
+const char *crc32c_implementation()
+{
+    pthread_once(&crc32c_once, crc32c_init);
+    return crc32c_name;
+}
+
+void crc16_init()
+{
+    crc_build_tables(crc16_tables, CRC16_POLYNOMIAL);
+}
+
+void crc32_init()
+{
+    crc_build_tables(crc32_tables, CRC32_POLYNOMIAL);
+}
+
+// Pick the crc32 instruction if the CPU supports it, the tables otherwise
+void crc32c_init()
+{
+    crc32c_impl = crc32c_scalar;
+    crc32c_name = "scalar";
+
+#if FRAME_CHECK_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+        crc32c_impl = crc32c_sse42;
+        crc32c_name = "sse4.2";
+        return;
+    }
+#endif
+    crc_build_tables(crc32c_tables, CRC32C_POLYNOMIAL);
+}
+
+uint32_t crc32c_scalar(uint32_t crc, const unsigned char *data, size_t len)
+{
+    return crc_update(crc32c_tables, crc, data, len);
+}
+
+#if FRAME_CHECK_X86
+// Eight bytes per crc32 instruction
+__attribute__((target("sse4.2"))) uint32_t crc32c_sse42(uint32_t crc, const unsigned char *data, size_t len)
+{
+    uint64_t value = crc;
+    while (len >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        value = _mm_crc32_u64(value, word);
+        data += 8;
+        len -= 8;
+    }
+
+    crc = (uint32_t)value;
+    while (len-- > 0)
+        crc = _mm_crc32_u8(crc, *data++);
+    return crc;
+}
+#endif
+
+// Build the slicing-by-8 tables of a reflected CRC.
+// tables[0] is the classic byte at a time table; tables[k] gives the effect of
+// a byte followed by k zero bytes.
+void crc_build_tables(uint32_t tables[8][256], uint32_t polynomial)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? (crc >> 1) ^ polynomial : crc >> 1;
+        tables[0][i] = crc;
+    }
+
+    for (int k = 1; k < 8; k++)
+    {
+        for (int i = 0; i < 256; i++)
+            tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFF];
+    }
+}
+
+// Run a reflected CRC (of up to 32 bits) over data, eight bytes per step
+uint32_t crc_update(uint32_t tables[8][256], uint32_t crc, const unsigned char *data, size_t len)
+{
+    while (len >= 8)
+    {
+        uint32_t low = crc ^ (data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24));
+        uint32_t high = data[4] | (data[5] << 8) | (data[6] << 16) | ((uint32_t)data[7] << 24);
+
+        crc = tables[7][low & 0xFF] ^ tables[6][(low >> 8) & 0xFF] ^
+              tables[5][(low >> 16) & 0xFF] ^ tables[4][low >> 24] ^
+              tables[3][high & 0xFF] ^ tables[2][(high >> 8) & 0xFF] ^
+              tables[1][(high >> 16) & 0xFF] ^ tables[0][high >> 24];
+
+        data += 8;
+        len -= 8;
+    }
+
+    while (len-- > 0)
+        crc = (crc >> 8) ^ tables[0][(crc ^ *data++) & 0xFF];
+
+    return crc;
+}
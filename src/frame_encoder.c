@@ -0,0 +1,200 @@
+// I frame encoder, shared by the link layer and the transmitters that encode
+// frames ahead of the link
+
+#include "frame_encoder.h"
+#include "state_machine.h"
+#include "byte_scan.h"
+#include "frame_check.h"
+#include "fec.h"
+#include "whitening.h"
+#include "cobs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Helper Functions prototypes
+int frame_message_size(struct ll_parameters parameters);
+
+// Largest data and check sequence of an I frame, with the whitening mask
+int frame_message_size(struct ll_parameters parameters)
+{
+    return parameters.max_payload_size + (parameters.whitening ? 1 : 0) + MAX_CHECK_SIZE;
+}
+
+// Size of the header of I frames: FLAG, address, control, sequence number
+// (sliding window only) and BCC1
+int frame_header_size(struct ll_parameters parameters)
+{
+    return parameters.window_size > 1 ? 5 : 4;
+}
+
+// Largest I frame
+int frame_max_size(struct ll_parameters parameters)
+{
+    int encoded_size = fec_encoded_size(frame_message_size(parameters), parameters.fec_parity);
+    return MAX_STUFFED_SIZE(encoded_size) + 6; // As FRAME_SIZE_BOUND, with the parity bytes (also bounds COBS)
+}
+
+// Allocate the buffers of an encoder for frames sent with the given parameters.
+// Returns 1 on success, -1 on failure.
+int frame_encoder_init(struct frame_encoder *encoder, struct ll_parameters parameters)
+{
+    memset(encoder, 0, sizeof(*encoder));
+    encoder->parameters = parameters;
+
+    if (parameters.whitening)
+    {
+        encoder->whitened = malloc(parameters.max_payload_size + 1);
+        if (encoder->whitened == NULL)
+        {
+            printf("Failed to allocate whitening buffer\n");
+            return -1;
+        }
+    }
+
+    if (parameters.fec_parity > 0 || parameters.framing == LL_FRAMING_COBS)
+    {
+        int message_size = frame_message_size(parameters);
+        encoder->message = malloc(message_size);
+        encoder->encoded = parameters.fec_parity > 0 ? malloc(fec_encoded_size(message_size, parameters.fec_parity)) : encoder->message;
+        if (encoder->message == NULL || encoder->encoded == NULL)
+        {
+            printf("Failed to allocate FEC buffers\n");
+            frame_encoder_free(encoder);
+            return -1;
+        }
+    }
+    return 1;
+}
+
+// Release the buffers of an encoder
+void frame_encoder_free(struct frame_encoder *encoder)
+{
+    if (encoder->encoded != encoder->message)
+        free(encoder->encoded); // Same buffer when COBS is used without FEC
+    free(encoder->message);
+    free(encoder->whitened);
+    encoder->message = NULL;
+    encoder->encoded = NULL;
+    encoder->whitened = NULL;
+}
+
+// Encode buf_size bytes of buf (at most the agreed payload) after the room
+// for the header of frame->frame.
+// Returns the size of the frame, or -1 if the data is too large.
+int frame_encode(struct frame_encoder *encoder, const unsigned char *buf, int buf_size, struct encoded_frame *frame)
+{
+    return frame_encode_parts(encoder, buf, buf_size, NULL, 0, frame);
+}
+
+// Encode the data made of head followed by tail (e.g. a packet header and
+// file data read straight from a mapped file) without joining them first.
+// Returns the size of the frame, or -1 if the data is too large.
+int frame_encode_parts(struct frame_encoder *encoder, const unsigned char *head, int head_size,
+                       const unsigned char *tail, int tail_size, struct encoded_frame *frame)
+{
+    struct ll_parameters parameters = encoder->parameters;
+    int buf_size = head_size + tail_size;
+    if (buf_size > parameters.max_payload_size)
+    {
+        printf("Frame too large: %d bytes (max %d)\n", buf_size, parameters.max_payload_size);
+        return -1;
+    }
+
+    unsigned char *out = frame->frame;
+    int frame_size = frame_header_size(parameters);
+    frame->data_size = buf_size;
+    frame->escapes_avoided = 0;
+    frame->whitened = parameters.whitening;
+
+    if (parameters.whitening)
+    {
+        // The mask goes first; the check sequence covers the whitened data
+        unsigned char *data = encoder->whitened + 1;
+        memcpy(data, head, head_size);
+        if (tail_size > 0)
+            memcpy(data + head_size, tail, tail_size);
+
+        int escapes, escapes_before;
+        unsigned char mask = whitening_choose_mask(data, buf_size, &escapes, &escapes_before);
+        encoder->whitened[0] = mask;
+        whitening_apply(data, data, buf_size, mask);
+        head = encoder->whitened;
+        head_size = buf_size + 1;
+        tail_size = 0;
+        frame->escapes_avoided = escapes_before - escapes;
+    }
+
+    if (parameters.fec_parity > 0 || parameters.framing == LL_FRAMING_COBS)
+    {
+        // Data and check sequence, in Reed-Solomon blocks if FEC is on
+        memcpy(encoder->message, head, head_size);
+        if (tail_size > 0)
+            memcpy(encoder->message + head_size, tail, tail_size);
+        int message_size = head_size + tail_size;
+        message_size += frame_check_compute(parameters.frame_check, encoder->message, message_size, encoder->message + message_size);
+        int encoded_size = message_size;
+        if (parameters.fec_parity > 0)
+            encoded_size = fec_encode(encoder->message, message_size, parameters.fec_parity, encoder->encoded);
+
+        if (parameters.framing == LL_FRAMING_COBS)
+        {
+            frame_size += cobs_encode(encoder->encoded, encoded_size, out + frame_size);
+        }
+        else
+        {
+            unsigned char unused = 0;
+            frame_size += stuff_bytes(encoder->encoded, encoded_size, out + frame_size, &unused);
+        }
+        out[frame_size++] = FLAG; // End flag
+        frame->size = frame_size;
+        return frame_size;
+    }
+
+    // Byte stuff the data, computing BCC2 in the same pass
+    unsigned char BCC2 = 0;
+    frame_size += stuff_bytes(head, head_size, out + frame_size, &BCC2);
+    if (tail_size > 0)
+        frame_size += stuff_bytes(tail, tail_size, out + frame_size, &BCC2);
+
+    // Check sequence: BCC2, or a CRC of the data
+    unsigned char check[MAX_CHECK_SIZE];
+    int check_size = 1;
+    if (parameters.frame_check == LL_CHECK_BCC2)
+    {
+        check[0] = BCC2;
+    }
+    else
+    {
+        struct frame_check state;
+        frame_check_begin(&state, parameters.frame_check);
+        frame_check_update(&state, head, head_size);
+        frame_check_update(&state, tail, tail_size);
+        check_size = frame_check_end(&state, check);
+    }
+
+    frame_size += stuff_bytes(check, check_size, out + frame_size, &BCC2); // Byte stuff the check sequence
+
+    out[frame_size++] = FLAG; // End flag
+    frame->size = frame_size;
+    return frame_size;
+}
+
+// Write the header of the I frame with the given sequence number (0 or 1 with
+// stop-and-wait) at the start of frame
+void frame_write_header(struct ll_parameters parameters, int sequence_number, unsigned char *frame)
+{
+    frame[0] = FLAG;                // Start flag
+    frame[1] = TRANSMITTER_ADDRESS; // Transmitter address
+    if (parameters.window_size > 1)
+    {
+        frame[2] = I_FRAME_N;                      // Frame type (sliding window)
+        frame[3] = sequence_number;                // Sequence number
+        frame[4] = frame[1] ^ frame[2] ^ frame[3]; // Calculate BCC1 (XOR of address, control and sequence number)
+    }
+    else
+    {
+        frame[2] = (sequence_number == 0) ? I_FRAME_0 : I_FRAME_1; // Frame type (I_FRAME_0 or I_FRAME_1)
+        frame[3] = frame[1] ^ frame[2];                            // Calculate BCC1 (XOR of address and control field)
+    }
+}
@@ -0,0 +1,103 @@
+#include "frame_sizer.h"
+
+#define FRAME_SIZER_INTERVAL 16   // I frames sent between two estimates
+#define FRAME_SIZER_ALPHA 0.25    // Gain of the smoothed byte error rate
+#define FRAME_SIZER_MAX_RATIO 0.9 // Frame error ratios above this are clamped
+#define FRAME_SIZER_DEADBAND 8    // Changes below 1/8 of the size are ignored
+
+// Helper Functions prototypes
+double frame_sizer_sqrt(double x);
+int frame_sizer_optimum(const struct frame_sizer *sizer);
+
+// Square root by Newton's method (the project does not link libm)
+double frame_sizer_sqrt(double x)
+{
+    if (x <= 0)
+        return 0;
+
+    double root = x > 1 ? x : 1;
+    for (int i = 0; i < 64; i++)
+    {
+        double next = (root + x / root) / 2;
+        if (next >= root)
+            break; // Converged (the sequence decreases down to the root)
+        root = next;
+    }
+    return root;
+}
+
+// Payload size with the best expected goodput for the estimated byte error rate.
+// A frame of L payload bytes and H overhead bytes gets through with probability
+// (1 - b)^(L + H), so the goodput is L * (1 - b)^(L + H) / (L + H). Setting its
+// derivative to zero (with ln(1 - b) ~ -b) gives L^2 + H*L - H/b = 0.
+int frame_sizer_optimum(const struct frame_sizer *sizer)
+{
+    double b = sizer->byte_error_rate;
+    double h = sizer->overhead;
+    if (b <= 0)
+        return sizer->max_size; // No errors seen: largest frames
+
+    double optimum = (-h + frame_sizer_sqrt(h * h + 4 * h / b)) / 2;
+    if (optimum > sizer->max_size)
+        return sizer->max_size;
+    if (optimum < sizer->min_size)
+        return sizer->min_size;
+    return (int)optimum;
+}
+
+// Initialize the sizer; the payload starts at its largest size
+void frame_sizer_init(struct frame_sizer *sizer, int min_size, int max_size, int overhead)
+{
+    sizer->min_size = min_size < max_size ? min_size : max_size;
+    sizer->max_size = max_size;
+    sizer->size = max_size;
+    sizer->overhead = overhead;
+    sizer->frames_sent = 0;
+    sizer->errors = 0;
+    sizer->byte_error_rate = 0;
+    sizer->samples = 0;
+}
+
+// Update the estimate from the link layer counters (totals since llopen).
+// Returns 1 if the payload size changed, 0 otherwise.
+int frame_sizer_update(struct frame_sizer *sizer, int frames_sent, int errors)
+{
+    int sent = frames_sent - sizer->frames_sent;
+    if (sent < FRAME_SIZER_INTERVAL)
+        return 0; // Too few frames for a meaningful ratio
+
+    double ratio = (double)(errors - sizer->errors) / sent;
+    if (ratio < 0)
+        ratio = 0;
+    if (ratio > FRAME_SIZER_MAX_RATIO)
+        ratio = FRAME_SIZER_MAX_RATIO;
+    sizer->frames_sent = frames_sent;
+    sizer->errors = errors;
+
+    // Frames of the current size failed with this ratio; for small error rates
+    // each of their bytes fails with about ratio / (size + overhead)
+    double sample = ratio / (sizer->size + sizer->overhead);
+    if (sizer->samples++ == 0)
+        sizer->byte_error_rate = sample;
+    else
+        sizer->byte_error_rate += FRAME_SIZER_ALPHA * (sample - sizer->byte_error_rate);
+
+    // Move towards the optimum, at most halving or doubling per update so one
+    // noisy interval cannot swing the size from one bound to the other
+    int size = frame_sizer_optimum(sizer);
+    if (size > sizer->size * 2)
+        size = sizer->size * 2;
+    if (size < sizer->size / 2)
+        size = sizer->size / 2;
+    if (size > sizer->max_size)
+        size = sizer->max_size;
+    if (size < sizer->min_size)
+        size = sizer->min_size;
+
+    int change = size > sizer->size ? size - sizer->size : sizer->size - size;
+    if (change == 0 || (change < sizer->size / FRAME_SIZER_DEADBAND &&
+                        size != sizer->min_size && size != sizer->max_size))
+        return 0; // Not worth a change
+    sizer->size = size;
+    return 1;
+}
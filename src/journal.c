@@ -0,0 +1,217 @@
+#include "journal.h"
+#include "app_config.h"
+#include "frame_check.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define JOURNAL_SUFFIX ".journal" // Appended to the output file name to name its journal
+#define JOURNAL_MAGIC "RCJ1"      // First bytes of a journal
+#define JOURNAL_SIZE 28           // Magic, tag (4 bytes), file size (8), committed bytes (8) and CRC-32
+
+// Helper Functions prototypes
+int journal_path(const char *filename, char *path);
+int journal_read(const char *filename, struct journal *journal);
+int journal_save(struct journal *journal, int data_fd);
+
+// Name of the journal of an output file, into path (PATH_MAX bytes).
+// Returns -1 if it is too long, 1 otherwise.
+int journal_path(const char *filename, char *path)
+{
+    if (snprintf(path, PATH_MAX, "%s%s", filename, JOURNAL_SUFFIX) >= PATH_MAX)
+    {
+        printf("File name too long for a journal: %s\n", filename);
+        return -1;
+    }
+    return 1;
+}
+
+// Tag of the file to send: CRC-32 of its name, size and modification time.
+// A file changed since an interrupted transfer gets another tag, so the
+// receiver does not resume it. Never 0, which means no tag.
+uint32_t file_tag(const char *filename, int fd, long long file_size)
+{
+    struct stat status;
+    if (fstat(fd, &status) < 0)
+        return 0; // Not resumable
+
+    unsigned char fields[24];
+    put_le(fields, file_size, 8);
+    put_le(fields + 8, status.st_mtim.tv_sec, 8);
+    put_le(fields + 16, status.st_mtim.tv_nsec, 8);
+
+    struct frame_check check;
+    unsigned char bytes[MAX_CHECK_SIZE];
+    frame_check_begin(&check, LL_CHECK_CRC32);
+    frame_check_update(&check, (const unsigned char *)filename, strlen(filename));
+    frame_check_update(&check, fields, sizeof(fields));
+    frame_check_end(&check, bytes);
+
+    uint32_t tag = get_le(bytes, 4);
+    return tag != 0 ? tag : 1;
+}
+
+// Bytes of the file with the given tag the receiver offered to keep in the
+// handshake of the default link (see journal_offer).
+// Returns the offset to send the file from, 0 to send it all.
+long long resume_offset(uint32_t tag, long long file_size)
+{
+    unsigned char offer[LL_REPLY_DATA_MAX_SIZE];
+    if (tag == 0 || ll_link_reply_data(&ll_default_link, offer) != RESUME_OFFER_SIZE)
+        return 0; // Nothing offered
+    if (get_le(offer, 4) != tag)
+        return 0; // Offered for another file, or another version of it
+
+    long long committed = decode_file_size(offer + 4, 8);
+    return committed > 0 && committed <= file_size ? committed : 0;
+}
+
+// Read the journal of an output file into journal (left closed), checking it
+// is intact and the output file still holds the bytes it commits.
+// Returns -1 if there is no valid journal, 1 otherwise.
+int journal_read(const char *filename, struct journal *journal)
+{
+    char path[PATH_MAX];
+    unsigned char record[JOURNAL_SIZE];
+    if (journal_path(filename, path) < 0)
+        return -1;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1; // No journal
+    int size = read(fd, record, JOURNAL_SIZE);
+    close(fd);
+
+    if (size != JOURNAL_SIZE || memcmp(record, JOURNAL_MAGIC, 4) != 0 ||
+        get_le(record + 24, 4) != crc32(record, 24))
+        return -1; // Damaged journal
+
+    journal->fd = -1;
+    journal->tag = get_le(record + 4, 4);
+    journal->file_size = decode_file_size(record + 8, 8);
+    journal->committed = decode_file_size(record + 16, 8);
+    journal->saved = journal->committed;
+
+    struct stat status;
+    if (journal->file_size < 0 || journal->committed < 0 || journal->committed > journal->file_size ||
+        stat(filename, &status) < 0 || status.st_size < journal->committed)
+        return -1; // The output file lost bytes the journal commits
+    return 1;
+}
+
+// Offer of the receiver in the handshake: the tag and the committed bytes of
+// the journal of the output file, into offer (RESUME_OFFER_SIZE bytes).
+// Returns the size of the offer, 0 if there is nothing to resume.
+int journal_offer(const char *filename, unsigned char *offer)
+{
+    struct journal journal;
+    if (journal_read(filename, &journal) < 0 || journal.committed == 0)
+        return 0;
+
+    put_le(offer, journal.tag, 4);
+    put_le(offer + 4, journal.committed, 8);
+    return RESUME_OFFER_SIZE;
+}
+
+// Start the journal of a file announced by a START packet, before the output
+// file is opened. Resuming requires the journal offered in the handshake to
+// still commit the bytes the transmitter skips. Without AL_RESUME, or for a
+// file without a tag, no journal is kept (journal->fd = -1).
+// Returns -1 if the transfer cannot go on, 1 otherwise.
+int journal_start(struct journal *journal, const char *filename, const struct file_info *info)
+{
+    journal->fd = -1;
+    if (info->resume_offset > 0)
+    {
+        struct journal old;
+        if (journal_read(filename, &old) < 0 || old.tag != info->tag || old.file_size != info->file_size ||
+            old.committed < info->resume_offset)
+        {
+            printf("Cannot resume %s from byte %lld: no matching journal.\n", filename, info->resume_offset);
+            return -1;
+        }
+    }
+    if (!AL_RESUME)
+        return 1;
+
+    char path[PATH_MAX];
+    if (journal_path(filename, path) < 0)
+        return -1;
+    if (info->tag == 0)
+    {
+        unlink(path); // A stale journal would commit bytes of another file
+        return 1;
+    }
+
+    journal->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (journal->fd < 0)
+    {
+        printf("Error opening journal: %s\n", path);
+        return -1;
+    }
+    journal->tag = info->tag;
+    journal->file_size = info->file_size;
+    journal->committed = info->resume_offset;
+    return journal_save(journal, -1); // Rewritten before the output file is truncated
+}
+
+// Write the journal. The output file (data_fd, if not -1) is flushed first,
+// whatever AL_FSYNC says, so the journal never commits bytes that a crash of
+// the system would lose from the page cache.
+// Returns -1 on error, 1 otherwise.
+int journal_save(struct journal *journal, int data_fd)
+{
+    if (data_fd >= 0 && fdatasync(data_fd) < 0)
+    {
+        printf("Failed to flush the file: %s\n", strerror(errno));
+        return -1;
+    }
+
+    unsigned char record[JOURNAL_SIZE];
+    memcpy(record, JOURNAL_MAGIC, 4);
+    put_le(record + 4, journal->tag, 4);
+    put_le(record + 8, journal->file_size, 8);
+    put_le(record + 16, journal->committed, 8);
+    put_le(record + 24, crc32(record, 24), 4);
+
+    if (pwrite(journal->fd, record, JOURNAL_SIZE, 0) != JOURNAL_SIZE)
+    {
+        printf("Failed to update the journal.\n");
+        return -1;
+    }
+    journal->saved = journal->committed;
+    return 1;
+}
+
+// Record that the first committed bytes of the file are written, saving the
+// journal every AL_JOURNAL_INTERVAL bytes, after flushing the output file
+// (data_fd) to the disk
+void journal_commit(struct journal *journal, int data_fd, long long committed)
+{
+    journal->committed = committed;
+    if (committed - journal->saved >= AL_JOURNAL_INTERVAL)
+        journal_save(journal, data_fd); // On failure a later resume only starts further back
+}
+
+// Close the journal of a transfer: removed once the file is complete, saved
+// for the next llopen otherwise. The output file is already closed (and
+// flushed as AL_FSYNC asks); without AL_FSYNC the bytes written since the
+// last save may not be on the disk, so the journal only moves back.
+void journal_finish(struct journal *journal, const char *filename, int complete)
+{
+    if (journal->fd < 0)
+        return; // No journal kept
+
+    if (!complete && (AL_FSYNC != AL_FSYNC_NONE || journal->committed < journal->saved))
+        journal_save(journal, -1);
+    close(journal->fd);
+    journal->fd = -1;
+
+    char path[PATH_MAX];
+    if (complete && journal_path(filename, path) > 0)
+        unlink(path);
+}
@@ -0,0 +1,249 @@
+// Link parameters and their negotiation block.
+// The block is a list of TLVs (type, length, value) followed by a CRC-16 of
+// the TLVs, least significant byte first. Unknown types are skipped.
+
+#include "link_config.h"
+#include "link_handle.h"
+#include "frame_check.h"
+#include "fec.h"
+#include <string.h>
+
+#define PARAMETER_PAYLOAD_SIZE 0  // Largest payload (2 bytes, most significant first)
+#define PARAMETER_WINDOW_SIZE 1   // Window size (1 byte)
+#define PARAMETER_ARQ_MODE 2      // ARQ mode (1 byte)
+#define PARAMETER_FRAME_CHECK 3   // Frame check (1 byte)
+#define PARAMETER_FEC_PARITY 4    // Reed-Solomon parity bytes per block (1 byte)
+#define PARAMETER_WHITENING 5     // Whitening (no value)
+#define PARAMETER_FRAMING 6       // Framing (1 byte)
+#define PARAMETER_REPLY_REQUEST 7 // The transmitter asks for reply data (no value, SET only)
+#define PARAMETER_REPLY_DATA 8    // Application data of the receiver (UA only)
+
+// Parameters proposed by this side (build settings)
+struct ll_parameters ll_proposed_parameters()
+{
+    struct ll_parameters proposed = {
+        .max_payload_size = LL_MAX_PAYLOAD_SIZE,
+        .window_size = LL_WINDOW_SIZE,
+        .arq_mode = LL_ARQ_MODE,
+        .frame_check = LL_FRAME_CHECK,
+        .fec_parity = LL_FEC_PARITY,
+        .whitening = LL_WHITENING,
+        .framing = LL_FRAMING};
+    return proposed;
+}
+
+// Parameters of the original protocol, used with peers that send a plain SET/UA
+struct ll_parameters ll_legacy_parameters()
+{
+    struct ll_parameters legacy = {
+        .max_payload_size = MAX_PAYLOAD_SIZE,
+        .window_size = 1,
+        .arq_mode = LL_GO_BACK_N,
+        .frame_check = LL_CHECK_BCC2,
+        .fec_parity = 0,
+        .whitening = 0,
+        .framing = LL_FRAMING_HDLC};
+    return legacy;
+}
+
+// Returns 1 if the parameters are those of the original protocol
+int ll_parameters_are_legacy(struct ll_parameters parameters)
+{
+    return parameters.max_payload_size == MAX_PAYLOAD_SIZE &&
+           parameters.window_size == 1 &&
+           parameters.frame_check == LL_CHECK_BCC2 &&
+           parameters.fec_parity == 0 &&
+           !parameters.whitening &&
+           parameters.framing == LL_FRAMING_HDLC;
+}
+
+// Agree on the parameters proposed by both sides
+struct ll_parameters ll_merge_parameters(struct ll_parameters a, struct ll_parameters b)
+{
+    struct ll_parameters agreed;
+    agreed.max_payload_size = a.max_payload_size < b.max_payload_size ? a.max_payload_size : b.max_payload_size;
+    agreed.window_size = a.window_size < b.window_size ? a.window_size : b.window_size;
+    agreed.arq_mode = (a.arq_mode == LL_SELECTIVE_REPEAT && b.arq_mode == LL_SELECTIVE_REPEAT) ? LL_SELECTIVE_REPEAT : LL_GO_BACK_N;
+    agreed.frame_check = a.frame_check > b.frame_check ? a.frame_check : b.frame_check;
+    agreed.fec_parity = a.fec_parity > b.fec_parity ? a.fec_parity : b.fec_parity;
+    agreed.whitening = a.whitening || b.whitening;
+    agreed.framing = a.framing > b.framing ? a.framing : b.framing;
+    return agreed;
+}
+
+// Encode the parameters and the reply request or data (reply may be NULL)
+// into block (at least LL_PARAMETERS_MAX_SIZE bytes).
+// Returns the size of the block.
+int ll_encode_parameters(struct ll_parameters parameters, const struct ll_reply *reply, unsigned char *block)
+{
+    int size = 0;
+
+    block[size++] = PARAMETER_PAYLOAD_SIZE;                    // T
+    block[size++] = 2;                                         // L
+    block[size++] = (parameters.max_payload_size >> 8) & 0xFF; // V
+    block[size++] = parameters.max_payload_size & 0xFF;
+
+    block[size++] = PARAMETER_WINDOW_SIZE;
+    block[size++] = 1;
+    block[size++] = parameters.window_size;
+
+    block[size++] = PARAMETER_ARQ_MODE;
+    block[size++] = 1;
+    block[size++] = parameters.arq_mode;
+
+    block[size++] = PARAMETER_FRAME_CHECK;
+    block[size++] = 1;
+    block[size++] = parameters.frame_check;
+
+    if (parameters.fec_parity > 0) // Left out so peers without FEC can still agree
+    {
+        block[size++] = PARAMETER_FEC_PARITY;
+        block[size++] = 1;
+        block[size++] = parameters.fec_parity;
+    }
+
+    if (parameters.whitening)
+    {
+        block[size++] = PARAMETER_WHITENING;
+        block[size++] = 0;
+    }
+
+    if (parameters.framing != LL_FRAMING_HDLC)
+    {
+        block[size++] = PARAMETER_FRAMING;
+        block[size++] = 1;
+        block[size++] = parameters.framing;
+    }
+
+    // Only sent when asked for, so peers without reply data never see a longer block
+    if (reply != NULL && reply->requested)
+    {
+        block[size++] = PARAMETER_REPLY_REQUEST;
+        block[size++] = 0;
+    }
+    if (reply != NULL && reply->size > 0)
+    {
+        block[size++] = PARAMETER_REPLY_DATA;
+        block[size++] = reply->size;
+        memcpy(&block[size], reply->data, reply->size);
+        size += reply->size;
+    }
+
+    uint16_t crc = crc16_ccitt(block, size);
+    block[size++] = crc & 0xFF;
+    block[size++] = crc >> 8;
+
+    return size;
+}
+
+// Decode a parameter block, and the reply request or data it carries into
+// reply (may be NULL).
+// Returns -1 if the block is damaged or holds invalid values, 1 otherwise.
+int ll_decode_parameters(const unsigned char *block, int size, struct ll_parameters *parameters, struct ll_reply *reply)
+{
+    if (size < 2)
+        return -1;
+
+    size -= 2; // CRC-16
+    uint16_t crc = block[size] | (block[size + 1] << 8);
+    if (crc != crc16_ccitt(block, size))
+        return -1;
+
+    *parameters = ll_legacy_parameters(); // Values not in the block
+    if (reply != NULL)
+        memset(reply, 0, sizeof(struct ll_reply));
+
+    int index = 0;
+    while (index + 2 <= size)
+    {
+        unsigned char type = block[index++];
+        unsigned char length = block[index++];
+        if (index + length > size)
+            return -1;
+
+        const unsigned char *value = &block[index];
+        index += length;
+
+        if (type == PARAMETER_PAYLOAD_SIZE && length == 2)
+            parameters->max_payload_size = (value[0] << 8) | value[1];
+        else if (type == PARAMETER_WINDOW_SIZE && length == 1)
+            parameters->window_size = value[0];
+        else if (type == PARAMETER_ARQ_MODE && length == 1)
+            parameters->arq_mode = value[0];
+        else if (type == PARAMETER_FRAME_CHECK && length == 1)
+            parameters->frame_check = value[0];
+        else if (type == PARAMETER_FEC_PARITY && length == 1)
+            parameters->fec_parity = value[0];
+        else if (type == PARAMETER_WHITENING && length == 0)
+            parameters->whitening = 1;
+        else if (type == PARAMETER_FRAMING && length == 1)
+            parameters->framing = value[0];
+        else if (type == PARAMETER_REPLY_REQUEST && length == 0 && reply != NULL)
+            reply->requested = 1;
+        else if (type == PARAMETER_REPLY_DATA && length <= LL_REPLY_DATA_MAX_SIZE && reply != NULL)
+        {
+            memcpy(reply->data, value, length);
+            reply->size = length;
+        }
+    }
+    if (index != size)
+        return -1; // A type without its length
+
+    if (parameters->max_payload_size < LL_MIN_PAYLOAD_SIZE ||
+        parameters->window_size < 1 || parameters->window_size > LL_MAX_WINDOW_SIZE ||
+        (parameters->arq_mode != LL_GO_BACK_N && parameters->arq_mode != LL_SELECTIVE_REPEAT) ||
+        parameters->frame_check < LL_CHECK_BCC2 || parameters->frame_check > LL_CHECK_CRC32 ||
+        parameters->fec_parity < 0 || parameters->fec_parity > FEC_MAX_PARITY || parameters->fec_parity % 2 != 0 ||
+        (parameters->framing != LL_FRAMING_HDLC && parameters->framing != LL_FRAMING_COBS))
+    {
+        return -1;
+    }
+
+    return 1;
+}
+
+// Parameters in effect on the current link (agreed by ll_open)
+void ll_set_parameters(struct ll_parameters agreed)
+{
+    current_link->parameters = agreed;
+}
+
+struct ll_parameters ll_agreed_parameters()
+{
+    return current_link->parameters;
+}
+
+int ll_max_payload_size()
+{
+    return current_link->parameters.max_payload_size;
+}
+
+int ll_window_size()
+{
+    return current_link->parameters.window_size;
+}
+
+int ll_arq_mode()
+{
+    return current_link->parameters.arq_mode;
+}
+
+int ll_frame_check()
+{
+    return current_link->parameters.frame_check;
+}
+
+int ll_fec_parity()
+{
+    return current_link->parameters.fec_parity;
+}
+
+int ll_whitening()
+{
+    return current_link->parameters.whitening;
+}
+
+int ll_framing()
+{
+    return current_link->parameters.framing;
+}
@@ -0,0 +1,90 @@
+// Link handles: the default link, the link of each thread and the serial
+// port of each link.
+
+#include "link_handle.h"
+#include "serial_port.h"
+
+#include <pthread.h>
+#include <string.h>
+
+// Serial port state of serial_port.c, which handles a single port
+extern int fd;
+extern struct termios oldtio;
+
+// openSerialPort and closeSerialPort work on the globals above; links take
+// turns with them and keep their own copy
+pthread_mutex_t serial_port_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+struct ll_link ll_default_link = {
+    .fd = -1,
+    .parameters = {
+        .max_payload_size = MAX_PAYLOAD_SIZE,
+        .window_size = 1,
+        .arq_mode = LL_GO_BACK_N,
+        .frame_check = LL_CHECK_BCC2,
+        .fec_parity = 0,
+        .whitening = 0,
+        .framing = LL_FRAMING_HDLC}};
+
+_Thread_local struct ll_link *current_link = &ll_default_link;
+
+// Reset a link to the state of a closed one (legacy parameters, no statistics)
+void ll_link_init(struct ll_link *link)
+{
+    memset(link, 0, sizeof(*link));
+    link->fd = -1;
+    link->parameters = ll_legacy_parameters();
+}
+
+// Open and configure the serial port of a link.
+// Returns -1 on error, 1 otherwise.
+int ll_link_open_port(struct ll_link *link, const char *serialPort, int baudRate)
+{
+    pthread_mutex_lock(&serial_port_mutex);
+    int result = openSerialPort(serialPort, baudRate);
+    link->fd = fd;
+    link->oldtio = oldtio;
+    fd = -1;
+    pthread_mutex_unlock(&serial_port_mutex);
+
+    return result < 0 ? -1 : 1;
+}
+
+// Restore the original settings of the serial port of a link and close it.
+// Returns -1 on error.
+int ll_link_close_port(struct ll_link *link)
+{
+    pthread_mutex_lock(&serial_port_mutex);
+    fd = link->fd;
+    oldtio = link->oldtio;
+    int result = closeSerialPort();
+    fd = -1;
+    pthread_mutex_unlock(&serial_port_mutex);
+
+    link->fd = -1;
+    return result;
+}
+
+// Number of I frames sent on a link and not yet acknowledged, the newest ones
+int ll_link_unacknowledged(struct ll_link *link)
+{
+    return link->parameters.window_size > 1 ? link->tx_window.count : 0;
+}
+
+// Statistics and parameters in effect of a link
+struct ll_statistics ll_link_statistics(struct ll_link *link)
+{
+    return link->statistics;
+}
+
+struct ll_parameters ll_link_parameters(struct ll_link *link)
+{
+    return link->parameters;
+}
+
+// Data the receiver answered the handshake of a link with
+int ll_link_reply_data(struct ll_link *link, unsigned char *data)
+{
+    memcpy(data, link->reply.data, link->reply.size);
+    return link->reply.size;
+}
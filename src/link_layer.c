@@ -1,34 +1,63 @@
 // Link layer protocol implementation
 
 #include "link_layer.h"
-#include "serial_port.h"
+#include "link_config.h"
+#include "link_handle.h"
 #include "state_machine.h"
-#include "alarm.h"
+#include "rtt.h"
+#include "byte_scan.h"
+#include "rx_buffer.h"
+#include "fec.h"
+#include "cobs.h"
+#include "frame_encoder.h"
+#include "timer.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
-#include <signal.h>
 
 // MISC
 #define _POSIX_SOURCE 1 // POSIX compliant source
 
-// Global variables
-LinkLayer connection_parameters; // Connection parameters for link layer
-int frame_number = 0;            // Current frame number (0 or 1)
-int frames_received = 0;         // Count of frames received
-
-// Statistics structure
-extern struct ll_statistics statistics;
-
 // Helper Functions prototypes
+int link_open(struct ll_link *link, LinkLayer connectionParameters, const struct ll_reply *reply);
+void prepare_reply(struct ll_reply *reply, LinkLayerRole role, const unsigned char *data, int size);
+int link_close(struct ll_link *link, int showStatistics);
 int safe_write(const unsigned char *bytes, int num_bytes);
 int send_SET();
-int send_ACK();
+int send_ACK(int answers_SET);
+int append_parameters(unsigned char *frame, struct ll_parameters parameters, const struct ll_reply *reply);
+int buffers_init();
+void buffers_free();
 int llopen_receiver();
 int llopen_transmitter();
-int send_data_frame(const unsigned char *buf, int buf_size);
+int build_data_frame(const unsigned char *buf, int buf_size, int sequence_number, unsigned char *frame);
+void count_encoded_frame(const struct encoded_frame *frame);
+int send_data_frame(const unsigned char *frame, int frame_size);
+int frame_timeout(int frame_size);
+int write_stop_and_wait(const unsigned char *frame, int frame_size);
 int send_RR();
 int send_REJ();
+int send_RR_N(int sequence_number);
+int send_REJ_N(int sequence_number);
+int send_extended_supervision(unsigned char control_byte, int sequence_number);
+int send_SREJ_N(int sequence_number);
+int llwrite_window(const unsigned char *buf, int bufSize);
+int llwrite_window_encoded(struct encoded_frame *frame);
+struct tx_window_slot *window_reserve(int *sequence_number);
+int window_commit();
+int llread_go_back_n(unsigned char *packet);
+int llread_selective_repeat(unsigned char *packet);
+void rx_window_advance();
+void window_init();
+int window_send(int index, int retransmission);
+int window_go_back();
+int window_acknowledge(int sequence_number);
+int window_handle_frame();
+int window_check_timers();
+const struct timer *window_next_timer();
+int window_receive_acknowledgements(int wait);
+int window_flush();
 int send_DISC();
 int llclose_receiver();
 int llclose_transmitter();
@@ -39,30 +68,106 @@ void show_statistics(struct ll_statistics statistics);
 ////////////////////////////////////////////////
 int llopen(LinkLayer connectionParameters)
 {
+    return link_open(&ll_default_link, connectionParameters, NULL);
+}
+
+struct ll_link *ll_open(LinkLayer connectionParameters)
+{
+    return ll_open_reply(connectionParameters, NULL, -1);
+}
+
+int llopen_reply(LinkLayer connectionParameters, const unsigned char *data, int size)
+{
+    struct ll_reply reply;
+    prepare_reply(&reply, connectionParameters.role, data, size);
+    return link_open(&ll_default_link, connectionParameters, &reply);
+}
+
+// Open a link on the heap; a negative size opens it without reply data (ll_open)
+struct ll_link *ll_open_reply(LinkLayer connectionParameters, const unsigned char *data, int size)
+{
+    struct ll_link *link = malloc(sizeof(struct ll_link));
+    if (link == NULL)
+    {
+        printf("Failed to allocate link\n");
+        return NULL;
+    }
+
+    struct ll_reply reply;
+    prepare_reply(&reply, connectionParameters.role, data, size);
+    if (link_open(link, connectionParameters, size < 0 ? NULL : &reply) < 0)
+    {
+        free(link);
+        current_link = &ll_default_link;
+        return NULL;
+    }
+    return link;
+}
+
+// Reply data of the handshake: the transmitter asks for it, the receiver
+// answers with data
+void prepare_reply(struct ll_reply *reply, LinkLayerRole role, const unsigned char *data, int size)
+{
+    memset(reply, 0, sizeof(struct ll_reply));
+    reply->requested = role == LlTx;
+    if (role == LlRx && size > 0)
+    {
+        reply->size = size < LL_REPLY_DATA_MAX_SIZE ? size : LL_REPLY_DATA_MAX_SIZE;
+        memcpy(reply->data, data, reply->size);
+    }
+}
+
+// Open the serial port of a link and establish the connection. With reply,
+// the transmitter asks for reply data and the receiver answers with it.
+int link_open(struct ll_link *link, LinkLayer connectionParameters, const struct ll_reply *reply)
+{
+    ll_link_init(link);  // Closed link, legacy parameters
+    current_link = link; // Calls below work on this link
+    if (reply != NULL)
+        link->reply = *reply;
+
     // Open the serial port with specified parameters
-    if (openSerialPort(connectionParameters.serialPort,
-                       connectionParameters.baudRate) < 0)
+    if (ll_link_open_port(link, connectionParameters.serialPort,
+                          connectionParameters.baudRate) < 0)
     {
         return -1; // Error opening serial port
     }
 
-    connection_parameters = connectionParameters; // Store connection parameters
+    link->connection_parameters = connectionParameters; // Store connection parameters
+
+    // The configured timeout becomes the upper bound of the adaptive timeout
+    rtt_init(&link->rtt, LL_ADAPTIVE_TIMEOUT ? LL_MIN_TIMEOUT_MS : connectionParameters.timeout * 1000,
+             connectionParameters.timeout * 1000);
 
     // Handle connection based on role (Receiver or Transmitter)
     switch (connectionParameters.role)
     {
     case LlRx: // Receiver
         if (llopen_receiver() < 0)
+        {
+            ll_link_close_port(link);
             return -1; // Error during receiver connection
+        }
         break;
     case LlTx: // Transmitter
         if (llopen_transmitter() < 0)
+        {
+            ll_link_close_port(link);
             return -1; // Error during transmitter connection
+        }
         break;
     default:
+        ll_link_close_port(link);
         return -1; // Invalid role
     }
 
+    window_init();          // Empty sliding windows
+    if (buffers_init() < 0) // Frame buffers for the agreed parameters
+    {
+        ll_link_close_port(link);
+        return -1;
+    }
+
     return 1; // Connection successful
 }
 
@@ -70,76 +175,140 @@ int llopen(LinkLayer connectionParameters)
 // LLWRITE
 ////////////////////////////////////////////////
 int llwrite(const unsigned char *buf, int bufSize)
+{
+    return ll_write(&ll_default_link, buf, bufSize);
+}
+
+int ll_write(struct ll_link *link, const unsigned char *buf, int bufSize)
+{
+    current_link = link; // Calls below work on this link
+
+    if (bufSize > ll_max_payload_size())
+    {
+        printf("Frame too large: %d bytes (max %d)\n", bufSize, ll_max_payload_size());
+        return -1;
+    }
+
+    if (ll_window_size() > 1)
+        return llwrite_window(buf, bufSize); // Go-Back-N or Selective Repeat
+
+    // The frame number only changes once the frame is acknowledged
+    int frame_size = build_data_frame(buf, bufSize, current_link->frame_number, current_link->tx_frame);
+    if (frame_size < 0 || write_stop_and_wait(current_link->tx_frame, frame_size) < 0)
+        return -1;
+    return bufSize; // Return size of buffer written
+}
+
+int ll_write_encoded(struct ll_link *link, struct encoded_frame *frame)
+{
+    current_link = link; // Calls below work on this link
+
+    if (ll_window_size() > 1)
+        return llwrite_window_encoded(frame); // Go-Back-N or Selective Repeat
+
+    frame_write_header(current_link->parameters, current_link->frame_number, frame->frame);
+    count_encoded_frame(frame);
+    if (write_stop_and_wait(frame->frame, frame->size) < 0)
+        return -1;
+    return frame->data_size; // Return size of the data written
+}
+
+// Wait until every I frame sent on a link is acknowledged
+// Returns -1 on error, 1 otherwise.
+int ll_flush(struct ll_link *link)
+{
+    current_link = link; // Calls below work on this link
+
+    if (ll_window_size() > 1)
+        return window_flush();
+    return 1; // Stop-and-wait frames are acknowledged by ll_write
+}
+
+// Retransmission timeout of a stuffed frame of frame_size bytes, which takes
+// 10 bits per byte (start, 8 data and stop bits) to go out at the baud rate
+int frame_timeout(int frame_size)
+{
+    int baud_rate = current_link->connection_parameters.baudRate;
+    int transmission_ms = baud_rate > 0 ? (int)(frame_size * 10000LL / baud_rate) : 0;
+    return rtt_timeout(&current_link->rtt, transmission_ms);
+}
+
+// Stop-and-wait: send a frame until it is acknowledged (RR) or the attempts run out.
+// Returns 1 on success, -1 on error.
+int write_stop_and_wait(const unsigned char *frame, int frame_size)
 {
     struct state_machine machine;
     // Create a type WRITE state machine
-    create_state_machine(&machine, WRITE, (frame_number == 0 ? RR1 : RR0), REPLY_FROM_RECEIVER_ADDRESS, START);
+    create_state_machine(&machine, WRITE, (current_link->frame_number == 0 ? RR1 : RR0), REPLY_FROM_RECEIVER_ADDRESS, START);
 
     unsigned int attempt = 0;
-    extern int alarm_enabled;
-    extern int alarm_count;
-    alarm_enabled = FALSE; // Disable alarm initially
-    alarm_count = 0;       // Reset alarm count
 
-    (void)signal(SIGALRM, alarm_handler); // Set signal handler for alarm
+    struct timer timer;      // Retransmission timer
+    struct timespec sent_at; // Time of the last transmission
+    int resent = FALSE;      // Frame sent more than once: no RTT sample (Karn's rule)
 
     // Retry sending data frame based on the number of retransmissions
-    while (attempt < connection_parameters.nRetransmissions)
+    while (attempt < current_link->connection_parameters.nRetransmissions)
     {
         attempt++;
 
         // Attempt to send the data frame
-        if (send_data_frame(buf, bufSize) < 0) // Failed to send frame
+        if (send_data_frame(frame, frame_size) < 0) // Failed to send frame
         {
-            alarm(0);                         // Disable alarm on failure
-            statistics.num_retransmissions++; // Count retransmission
-            continue;                         // Retry sending frame
+            timer_stop(&timer);                             // Stop timer
+            current_link->statistics.num_retransmissions++; // Count retransmission
+            continue;                                       // Retry sending frame
         }
 
-        alarm(connection_parameters.timeout); // Set alarm for timeout
-        alarm_enabled = TRUE;                 // Enable alarm
-        machine.state = START;                // Reset state machine
+        timer_now(&sent_at);                          // Start measuring the round trip
+        timer_start(&timer, frame_timeout(frame_size)); // Start retransmission timer
+        machine.state = START;                        // Reset state machine
+        int rejected = FALSE;                         // REJ received for this transmission
 
-        // Wait for response while alarm is enabled
-        while (alarm_enabled)
+        // Wait for response until the timer expires
+        while (!timer_expired(&timer))
         {
-            unsigned char byte = 0;
-            int read_byte = readByteSerialPort(&byte); // Read byte from serial port
+            int received = rx_buffer_receive_frame(&machine, &timer); // Run the state machine over the received bytes
 
-            if (read_byte == 0)
+            if (received == 0)
             {
-                continue; // No bytes read, continue waiting
+                continue; // No complete frame yet, continue waiting
             }
-            else if (read_byte < 0)
+            else if (received < 0)
             {
                 printf("Read ERROR!"); // Error reading byte
                 return -1;
             }
-
-            // Process the byte through the state machine
-            state_machine(&machine, byte);
             if (machine.state == STP && machine.REJ) // REJ received
             {
-                statistics.num_REJ_received++; // Count REJ received
-                statistics.num_timeouts--;     // No timeout when REJ is received
-                alarm(0);                      // Disable alarm
-                alarm_enabled = FALSE;         // Disable alarm
-                attempt--;                     // Stay on the same attempt
-                break;                         // Send frame again
+                current_link->statistics.num_REJ_received++; // Count REJ received
+                current_link->statistics.num_timeouts--;     // No timeout when REJ is received
+                timer_stop(&timer);                          // Stop timer
+                attempt--;                                   // Stay on the same attempt
+                rejected = TRUE;                             // Not a timeout
+                break;                                       // Send frame again
             }
             else if (machine.state == STP) // RR received
             {
-                frame_number = 1 - frame_number; // Switch frame number
-                statistics.num_RR_received++;    // Count RR received
-                alarm(0);                        // Disable alarm
-                alarm_enabled = FALSE;           // Disable alarm
-                return bufSize;                  // Return size of buffer written
+                current_link->frame_number = 1 - current_link->frame_number; // Switch frame number
+                current_link->statistics.num_RR_received++;                  // Count RR received
+                timer_stop(&timer);                                          // Stop timer
+                if (!resent)
+                    rtt_sample(&current_link->rtt, elapsed_ms(&sent_at)); // Update timeout estimate
+                return 1;                                                 // Frame acknowledged
             }
         }
-        statistics.num_retransmissions++; // Increment retransmission count
-        statistics.num_timeouts++;        // Increment timeout count
+        current_link->statistics.num_retransmissions++; // Increment retransmission count
+        current_link->statistics.num_timeouts++;        // Increment timeout count
+        resent = TRUE;                                  // Next transmission is a retransmission
+        if (rejected)
+            continue;
+        if (rtt_backoff(&current_link->rtt))
+            current_link->statistics.num_full_timeouts++; // Timeout at the configured value
+        else
+            attempt--; // Timeout below the configured one: back off without using up an attempt
     }
-    printf("Failed to send frame after %d attempts\n", connection_parameters.nRetransmissions);
+    printf("Failed to send frame after %d attempts\n", current_link->connection_parameters.nRetransmissions);
     return -1; // Failed to send frame after retries
 }
 
@@ -148,42 +317,51 @@ int llwrite(const unsigned char *buf, int bufSize)
 ////////////////////////////////////////////////
 int llread(unsigned char *packet)
 {
+    return ll_read(&ll_default_link, packet);
+}
+
+int ll_read(struct ll_link *link, unsigned char *packet)
+{
+    current_link = link; // Calls below work on this link
+
+    if (ll_window_size() > 1 && ll_arq_mode() == LL_SELECTIVE_REPEAT)
+        return llread_selective_repeat(packet);
+    if (ll_window_size() > 1)
+        return llread_go_back_n(packet);
+
     struct state_machine machine;
     // Create a type READ state machine
-    create_state_machine(&machine, READ, (frame_number == 0 ? I_FRAME_0 : I_FRAME_1), TRANSMITTER_ADDRESS, START);
+    create_state_machine(&machine, READ, (current_link->frame_number == 0 ? I_FRAME_0 : I_FRAME_1), TRANSMITTER_ADDRESS, START);
+    state_machine_use_buffer(&machine, current_link->rx_frame, current_link->rx_frame_capacity);
 
     do
     {
-        unsigned char byte = 0;
-        int read_byte = readByteSerialPort(&byte); // Read byte from serial port
+        int received = rx_buffer_receive_frame(&machine, NULL); // Run the state machine over the received bytes
 
-        if (read_byte == 0)
+        if (received == 0)
         {
-            continue; // No bytes read, continue waiting
+            continue; // No complete frame yet, continue waiting
         }
-        else if (read_byte < 0)
+        else if (received < 0)
         {
             printf("Read ERROR!"); // Error reading byte
             return -1;
         }
 
-        // Process the byte through the state machine
-        state_machine(&machine, byte);
-
         // Handle received frames based on state machine state
-        if (machine.state == STP && machine.ACK && frames_received == 0) // SET received
+        if (machine.state == STP && machine.ACK && current_link->frames_received == 0) // SET received
         {
-            statistics.num_SET_received++; // Count SET received
+            current_link->statistics.num_SET_received++; // Count SET received
 
-            if (send_ACK() < 0) // Send ACK command
+            if (send_ACK(TRUE) < 0) // Send ACK command
                 return -1;      // Error sending ACK
 
             machine.state = START; // Reset state for next frame
         }
         else if (machine.state == STP && machine.duplicate) // Duplicate received
         {
-            statistics.num_I_frames_received++; // Count I frames received
-            statistics.num_duplicated_frames++; // Count duplicated frames
+            current_link->statistics.num_I_frames_received++; // Count I frames received
+            current_link->statistics.num_duplicated_frames++; // Count duplicated frames
 
             if (send_RR() < 0)     // Send RR command
                 return -1;         // Error sending RR
@@ -191,7 +369,7 @@ int llread(unsigned char *packet)
         }
         else if (machine.state == STP && machine.REJ) // New frame with bad data received
         {
-            statistics.num_I_frames_received++; // Count I frames received
+            current_link->statistics.num_I_frames_received++; // Count I frames received
 
             if (send_REJ() < 0)    // Send REJ command
                 return -1;         // Error sending REJ
@@ -199,15 +377,15 @@ int llread(unsigned char *packet)
         }
         else if (machine.state == STP) // Frame received
         {
-            statistics.num_I_frames_received++; // Count I frames received
-            frames_received++;                  // Increment frames received count
-            break;                              // Frame received successfully
+            current_link->statistics.num_I_frames_received++; // Count I frames received
+            current_link->frames_received++;                  // Increment frames received count
+            break;                                            // Frame received successfully
         }
     } while (machine.state != STP);
 
-    frame_number = 1 - frame_number; // Switch frame number
-    if (send_RR() < 0)               // Send RR command
-        return -1;                   // Error sending RR
+    current_link->frame_number = 1 - current_link->frame_number; // Switch frame number
+    if (send_RR() < 0)                                           // Send RR command
+        return -1;                                               // Error sending RR
 
     memcpy(packet, machine.buf, machine.buf_size); // Copy received packet to provided buffer
 
@@ -219,27 +397,46 @@ int llread(unsigned char *packet)
 ////////////////////////////////////////////////
 int llclose(int showStatistics)
 {
-    int clstat = 1; // Connection status
+    return link_close(&ll_default_link, showStatistics);
+}
+
+int ll_close(struct ll_link *link, int showStatistics)
+{
+    int clstat = link_close(link, showStatistics);
+    free(link);
+    current_link = &ll_default_link; // The link is gone
+    return clstat;
+}
+
+// Close the connection of a link and its serial port
+int link_close(struct ll_link *link, int showStatistics)
+{
+    current_link = link; // Calls below work on this link
+    int clstat = 1;      // Connection status
 
     // Handle connection closure based on role
-    if (connection_parameters.role == LlRx)
+    if (link->connection_parameters.role == LlRx)
     {
         if (llclose_receiver() < 0)
             clstat = -1; // Error during receiver close
     }
-    else if (connection_parameters.role == LlTx)
+    else if (link->connection_parameters.role == LlTx)
     {
+        if (ll_window_size() > 1 && window_flush() < 0)
+            clstat = -1; // Frames left unacknowledged
         if (llclose_transmitter() < 0)
             clstat = -1; // Error during transmitter close
     }
 
+    buffers_free(); // Release the frame buffers
+
     // Close the serial port
-    if (closeSerialPort() < 0)
+    if (ll_link_close_port(link) < 0)
         clstat = -1; // Error closing serial port
 
     // Show statistics if requested
     if (showStatistics)
-        show_statistics(statistics);
+        show_statistics(link->statistics);
 
     return clstat; // Return connection status
 }
@@ -248,7 +445,7 @@ int llclose(int showStatistics)
 // HELPER FUNCTIONS
 ////////////////////////////////////////////////
 
-// Safely writes bytes to the serial port, handling partial writes
+// Safely writes bytes to the serial port of the current link, handling partial writes
 int safe_write(const unsigned char *bytes, int num_bytes)
 {
     int total_bytes_written = 0;
@@ -257,7 +454,7 @@ int safe_write(const unsigned char *bytes, int num_bytes)
     while (total_bytes_written < num_bytes)
     {
         int bytes_to_write = num_bytes - total_bytes_written;
-        int bytes_written = writeBytesSerialPort(bytes + total_bytes_written, bytes_to_write);
+        int bytes_written = write(current_link->fd, bytes + total_bytes_written, bytes_to_write);
 
         if (bytes_written < 0)
         {
@@ -274,41 +471,73 @@ int safe_write(const unsigned char *bytes, int num_bytes)
 // Send SET command to establish connection
 int send_SET()
 {
-    unsigned char buf[5] = {FLAG, TRANSMITTER_ADDRESS, SET, 0, FLAG};
+    unsigned char buf[5 + MAX_STUFFED_SIZE(LL_PARAMETERS_MAX_SIZE)] = {FLAG, TRANSMITTER_ADDRESS, SET, 0};
     buf[3] = buf[1] ^ buf[2]; // Calculate BCC1
+    int size = 4;
 
-    if (safe_write(buf, 5) < 0)
+    // Propose this side's link parameters; a plain SET keeps the original
+    // protocol, unless reply data is asked for
+    struct ll_parameters proposed = ll_proposed_parameters();
+    if (!ll_parameters_are_legacy(proposed) || current_link->reply.requested)
+        size += append_parameters(buf + size, proposed, &current_link->reply);
+    buf[size++] = FLAG;
+
+    if (safe_write(buf, size) < 0)
     {
         printf("Failed to send SET command.\n");
         return -1; // Error sending SET command
     }
 
-    statistics.num_SET_sent++; // Count SET command sent
-    return 1;                  // Successful send
+    current_link->statistics.num_SET_sent++; // Count SET command sent
+    return 1;                                // Successful send
 }
 
-// Send ACK command to acknowledge receipt
-int send_ACK()
+// Send ACK command to acknowledge receipt. A UA answering a SET carries the
+// agreed link parameters if the transmitter proposed any.
+int send_ACK(int answers_SET)
 {
-    unsigned char buf[5] = {FLAG, 0, UA, 0, FLAG};
-    if (connection_parameters.role == LlRx)
+    unsigned char buf[5 + MAX_STUFFED_SIZE(LL_PARAMETERS_MAX_SIZE)] = {FLAG, 0, UA, 0};
+    int size = 4;
+    if (current_link->connection_parameters.role == LlRx)
     {
         buf[1] = REPLY_FROM_RECEIVER_ADDRESS; // Set address for receiver case
     }
-    else if (connection_parameters.role == LlTx)
+    else if (current_link->connection_parameters.role == LlTx)
     {
         buf[1] = REPLY_FROM_TRANSMITTER_ADDRESS; // Set address for trasmitter case
     }
     buf[3] = buf[1] ^ buf[2]; // Calculate BCC1
 
-    if (safe_write(buf, 5) < 0)
+    if (answers_SET && current_link->parameters_exchanged)
+    {
+        struct ll_reply reply = current_link->reply; // Reply data, only if the transmitter asked for it
+        reply.requested = FALSE;
+        if (!current_link->reply.requested)
+            reply.size = 0;
+        size += append_parameters(buf + size, ll_agreed_parameters(), &reply);
+    }
+    buf[size++] = FLAG;
+
+    if (safe_write(buf, size) < 0)
     {
         printf("Failed to send ACK command.\n");
         return -1; // Error sending UA command
     }
 
-    statistics.num_UA_sent++; // Count UA command sent
-    return 1;                 // Successful send
+    current_link->statistics.num_UA_sent++; // Count UA command sent
+    return 1;                               // Successful send
+}
+
+// Append the stuffed parameter block, with the reply request or data, to a
+// SET or UA frame
+// Returns the number of bytes appended
+int append_parameters(unsigned char *frame, struct ll_parameters parameters, const struct ll_reply *reply)
+{
+    unsigned char block[LL_PARAMETERS_MAX_SIZE];
+    int block_size = ll_encode_parameters(parameters, reply, block);
+
+    unsigned char unused = 0;
+    return stuff_bytes(block, block_size, frame, &unused);
 }
 
 // Function to establish a connection on the receiver side
@@ -318,28 +547,42 @@ int llopen_receiver()
     struct state_machine machine;
     create_state_machine(&machine, CONNECTION, SET, TRANSMITTER_ADDRESS, START);
 
-    // Loop until the state machine reaches the STOP state (STP)
+    unsigned char information[LL_PARAMETERS_MAX_SIZE];                  // Link parameters proposed by the transmitter
+    state_machine_use_buffer(&machine, information, sizeof(information));
+    struct ll_parameters proposed;
+    struct ll_reply request; // Whether the transmitter asks for reply data
+
+    // Loop until the state machine reaches the STOP state (STP) with a valid SET
     do
     {
-        unsigned char byte = 0;                    // Variable to store the byte read from the serial port
-        int read_byte = readByteSerialPort(&byte); // Read a byte from the serial port
+        int received = rx_buffer_receive_frame(&machine, NULL); // Run the state machine over the received bytes
 
-        if (read_byte == 0)
+        if (received == 0)
         {
-            continue; // No bytes read, continue waiting
+            continue; // No complete frame yet, continue waiting
         }
-        else if (read_byte < 0)
+        else if (received < 0)
         {
             printf("Read ERROR!"); // Error reading byte
             return -1;
         }
 
-        state_machine(&machine, byte); // Process the read byte with the state machine
+        if (machine.state == STP && machine.buf_size > 0 &&
+            ll_decode_parameters(machine.buf, machine.buf_size, &proposed, &request) < 0)
+            machine.state = START; // Damaged parameters; wait for the SET to be resent
 
     } while (machine.state != STP);
 
-    statistics.num_SET_received++; // Increment the count of SET frames received
-    return send_ACK();             // Send an acknowledgment (ACK) back to the transmitter
+    // A plain SET comes from a peer speaking the original protocol
+    current_link->parameters_exchanged = machine.buf_size > 0;
+    current_link->reply.requested = current_link->parameters_exchanged && request.requested;
+    if (current_link->parameters_exchanged)
+        ll_set_parameters(ll_merge_parameters(ll_proposed_parameters(), proposed));
+    else
+        ll_set_parameters(ll_legacy_parameters());
+
+    current_link->statistics.num_SET_received++; // Increment the count of SET frames received
+    return send_ACK(TRUE);                       // Send an acknowledgment (ACK) back to the transmitter
 }
 
 // Function to establish a connection on the transmitter side
@@ -349,160 +592,198 @@ int llopen_transmitter()
     struct state_machine machine;
     create_state_machine(&machine, CONNECTION, UA, REPLY_FROM_RECEIVER_ADDRESS, START);
 
+    unsigned char information[LL_PARAMETERS_MAX_SIZE];                  // Link parameters agreed by the receiver
+    state_machine_use_buffer(&machine, information, sizeof(information));
+    struct ll_parameters agreed;
+    struct ll_reply reply; // Reply data of the receiver
+
     unsigned int attempt = 0;             // Counter for connection attempts
-    extern int alarm_enabled;             // Flag indicating if the alarm is enabled
-    extern int alarm_count;               // Counter for alarm events
-    alarm_enabled = FALSE;                // Initially, alarm is disabled
-    alarm_count = 0;                      // Reset alarm count
-    (void)signal(SIGALRM, alarm_handler); // Set the signal handler for alarms
+    struct timer timer;                   // Retransmission timer
 
     // Loop until the maximum number of retransmissions is reached
-    while (attempt < connection_parameters.nRetransmissions)
+    while (attempt < current_link->connection_parameters.nRetransmissions)
     {
         attempt++; // Increment the attempt counter
 
         if (send_SET() < 0) // Attempt to send the SET frame
         {
-            alarm(0);                         // Disable the alarm
-            statistics.num_retransmissions++; // Increment retransmission count
-            continue;                         // Retry sending SET if it fails
+            timer_stop(&timer);                             // Stop timer
+            current_link->statistics.num_retransmissions++; // Increment retransmission count
+            continue;                                       // Retry sending SET if it fails
         }
 
-        alarm(connection_parameters.timeout); // Set the alarm for timeout duration
-        alarm_enabled = TRUE;                 // Enable the alarm
-        machine.state = START;                // Reset the state machine state
+        timer_start(&timer, current_link->rtt.rto); // Start retransmission timer
+        machine.state = START;                      // Reset the state machine state
 
-        // Loop while the alarm is enabled (waiting for UA frame)
-        while (alarm_enabled)
+        // Loop until the timer expires (waiting for UA frame)
+        while (!timer_expired(&timer))
         {
-            unsigned char byte = 0;                    // Variable to store the byte read from the serial port
-            int read_byte = readByteSerialPort(&byte); // Read a byte from the serial port
+            int received = rx_buffer_receive_frame(&machine, &timer); // Run the state machine over the received bytes
 
-            if (read_byte == 0)
+            if (received == 0)
             {
-                continue; // No bytes read, continue waiting
+                continue; // No complete frame yet, continue waiting
             }
-            else if (read_byte < 0)
+            else if (received < 0)
             {
                 printf("Read ERROR!"); // Error reading byte
                 return -1;
             }
 
-            state_machine(&machine, byte); // Process the read byte with the state machine
+            if (machine.state == STP && machine.buf_size > 0 &&
+                ll_decode_parameters(machine.buf, machine.buf_size, &agreed, &reply) < 0)
+            {
+                machine.state = START; // Damaged parameters; wait for the UA to be resent
+                continue;
+            }
 
             // Check if the state machine has reached the STOP state (STP)
             if (machine.state == STP)
             {
-                alarm(0);                     // Disable the alarm
-                alarm_enabled = FALSE;        // Mark alarm as disabled
-                statistics.num_UA_received++; // Increment the count of UA frames received
-                return 1;                     // Successful connection establishment
+                // A plain UA comes from a peer speaking the original protocol
+                if (machine.buf_size > 0)
+                {
+                    ll_set_parameters(ll_merge_parameters(ll_proposed_parameters(), agreed));
+                    current_link->reply.size = reply.size;
+                    memcpy(current_link->reply.data, reply.data, reply.size);
+                }
+                else
+                    ll_set_parameters(ll_legacy_parameters());
+
+                timer_stop(&timer);                         // Stop timer
+                current_link->statistics.num_UA_received++; // Increment the count of UA frames received
+                return 1;                                   // Successful connection establishment
             }
         }
-        statistics.num_retransmissions++; // Increment retransmission count
-        statistics.num_timeouts++;        // Increment timeout count
+        current_link->statistics.num_retransmissions++; // Increment retransmission count
+        current_link->statistics.num_timeouts++;        // Increment timeout count
+        if (!rtt_backoff(&current_link->rtt))
+            attempt--; // Timeout below the configured one: back off without using up an attempt
     }
-    printf("Failed to establish connection after %d attempts\n", connection_parameters.nRetransmissions);
+    printf("Failed to establish connection after %d attempts\n", current_link->connection_parameters.nRetransmissions);
     return -1; // Return error if maximum retransmissions are reached without success
 }
 
-// Function to send a data frame over the serial connection
-int send_data_frame(const unsigned char *buf, int buf_size)
+// Function to build a stuffed data frame into "frame", which must hold
+// frame_max_size() bytes
+// Returns the frame size, or -1 on error
+int build_data_frame(const unsigned char *buf, int buf_size, int sequence_number, unsigned char *frame)
 {
-    // Allocate memory for the frame:
-    // (data_size + BCC2) * 2 for potential byte stuffing + (F; A; C; BCC1) + F
-    unsigned char frame[(buf_size + 1) * 2 + 5];
-    int frame_size = 0; // Initialize frame size counter
+    struct encoded_frame encoded = {.frame = frame};
+    if (frame_encode(&current_link->encoder, buf, buf_size, &encoded) < 0)
+        return -1;
 
-    // Start constructing the frame
-    frame[frame_size++] = FLAG;                                        // Start flag
-    frame[frame_size++] = TRANSMITTER_ADDRESS;                         // Transmitter address
-    frame[frame_size++] = (frame_number == 0) ? I_FRAME_0 : I_FRAME_1; // Frame type (I_FRAME_0 or I_FRAME_1)
-    frame[frame_size++] = frame[1] ^ frame[2];                         // Calculate BCC1 (XOR of address and control field)
-
-    unsigned char BCC2 = 0; // Initialize BCC2
-    for (int i = 0; i < buf_size; i++)
-    {
-        if (buf[i] == FLAG) // Check for FLAG byte to perform byte stuffing
-        {
-            frame[frame_size++] = ESC;      // Add ESC before FLAG
-            frame[frame_size++] = ESC_FLAG; // Escape FLAG
-        }
-        else if (buf[i] == ESC) // Check for ESC byte to perform byte stuffing
-        {
-            frame[frame_size++] = ESC;     // Add ESC before ESC
-            frame[frame_size++] = ESC_ESC; // Escape ESC
-        }
-        else
-        {
-            frame[frame_size++] = buf[i]; // Add data byte to frame
-        }
-        BCC2 ^= buf[i]; // Compute BCC2 using XOR
-    }
+    frame_write_header(current_link->parameters, sequence_number, frame);
+    count_encoded_frame(&encoded);
+    return encoded.size;
+}
 
-    // Byte Stuff BCC2
-    if (BCC2 == FLAG) // Check if BCC2 is equal to the FLAG byte
-    {
-        frame[frame_size++] = ESC;      // Add ESC before BCC2
-        frame[frame_size++] = ESC_FLAG; // Escape FLAG
-    }
-    else if (BCC2 == ESC) // Check if BCC2 is equal to the ESC byte
-    {
-        frame[frame_size++] = ESC;     // Add ESC before BCC2
-        frame[frame_size++] = ESC_ESC; // Escape ESC
-    }
-    else
+// Count the whitening statistics of a frame about to be sent
+void count_encoded_frame(const struct encoded_frame *frame)
+{
+    if (frame->whitened)
     {
-        frame[frame_size++] = BCC2; // Add BCC2 to frame
+        current_link->statistics.num_escapes_avoided += frame->escapes_avoided;
+        current_link->statistics.num_whitening_masks_sent++;
     }
+}
 
-    frame[frame_size++] = FLAG; // End flag
-
+// Function to send a data frame over the serial connection
+int send_data_frame(const unsigned char *frame, int frame_size)
+{
     // Attempt to write the frame to the serial port
     if (safe_write(frame, frame_size) < 0)
     {
-        printf("Failed to send frame %d!\n", frame_number);
+        printf("Failed to send frame %d!\n", current_link->frame_number);
         return -1; // Return -1 on failure
     }
 
-    statistics.num_I_frames_sent++; // Increment the count of I frames sent
-    return 1;                       // Return 1 on success
+    current_link->statistics.num_I_frames_sent++; // Increment the count of I frames sent
+    return 1;                                     // Return 1 on success
 }
 
 // Function to send a RR command
 int send_RR()
 {
     // Create a buffer to hold the RR frame
-    unsigned char buf[5] = {FLAG, REPLY_FROM_RECEIVER_ADDRESS, frame_number == 0 ? RR0 : RR1, 0, FLAG};
+    unsigned char buf[5] = {FLAG, REPLY_FROM_RECEIVER_ADDRESS, current_link->frame_number == 0 ? RR0 : RR1, 0, FLAG};
     buf[3] = buf[1] ^ buf[2]; // Calculate BCC1
 
     // Attempt to send the RR command
     if (safe_write(buf, 5) < 0)
     {
-        printf("Failed to send RR%d command.\n", frame_number);
+        printf("Failed to send RR%d command.\n", current_link->frame_number);
         return -1; // Return -1 on failure
     }
 
-    statistics.num_RR_sent++; // Increment the count of RR commands sent
-    return 1;                 // Return 1 on success
+    current_link->statistics.num_RR_sent++; // Increment the count of RR commands sent
+    return 1;                               // Return 1 on success
 }
 
 // Function to send a REJ command
 int send_REJ()
 {
     // Create a buffer to hold the REJ frame
-    unsigned char buf[5] = {FLAG, REPLY_FROM_RECEIVER_ADDRESS, frame_number == 0 ? REJ0 : REJ1, 0, FLAG};
+    unsigned char buf[5] = {FLAG, REPLY_FROM_RECEIVER_ADDRESS, current_link->frame_number == 0 ? REJ0 : REJ1, 0, FLAG};
     buf[3] = buf[1] ^ buf[2]; // Calculate BCC1
 
     // Attempt to send the REJ command
     if (safe_write(buf, 5) < 0)
     {
-        printf("Failed to send REJ%d command.\n", frame_number);
+        printf("Failed to send REJ%d command.\n", current_link->frame_number);
+        return -1; // Return -1 on failure
+    }
+
+    current_link->statistics.num_REJ_sent++; // Increment the count of REJ commands sent
+    return 1;                                // Return 1 on success
+}
+
+// Function to send a sliding window supervision frame (RR_N / REJ_N) carrying a sequence number
+int send_extended_supervision(unsigned char control_byte, int sequence_number)
+{
+    unsigned char buf[6] = {FLAG, REPLY_FROM_RECEIVER_ADDRESS, control_byte, sequence_number, 0, FLAG};
+    buf[4] = buf[1] ^ buf[2] ^ buf[3]; // Calculate BCC1
+
+    return safe_write(buf, 6) < 0 ? -1 : 1;
+}
+
+// Function to send a RR command acknowledging every frame before "sequence_number"
+int send_RR_N(int sequence_number)
+{
+    if (send_extended_supervision(RR_N, sequence_number) < 0)
+    {
+        printf("Failed to send RR%d command.\n", sequence_number);
+        return -1; // Return -1 on failure
+    }
+
+    current_link->statistics.num_RR_sent++; // Increment the count of RR commands sent
+    return 1;                               // Return 1 on success
+}
+
+// Function to send a REJ command asking for every frame from "sequence_number" onwards
+int send_REJ_N(int sequence_number)
+{
+    if (send_extended_supervision(REJ_N, sequence_number) < 0)
+    {
+        printf("Failed to send REJ%d command.\n", sequence_number);
         return -1; // Return -1 on failure
     }
 
-    statistics.num_REJ_sent++; // Increment the count of REJ commands sent
-    return 1;                  // Return 1 on success
+    current_link->statistics.num_REJ_sent++; // Increment the count of REJ commands sent
+    return 1;                                // Return 1 on success
+}
+
+// Function to send a SREJ command asking for the frame "sequence_number" only
+int send_SREJ_N(int sequence_number)
+{
+    if (send_extended_supervision(SREJ_N, sequence_number) < 0)
+    {
+        printf("Failed to send SREJ%d command.\n", sequence_number);
+        return -1; // Return -1 on failure
+    }
+
+    current_link->statistics.num_SREJ_sent++; // Increment the count of SREJ commands sent
+    return 1;                                 // Return 1 on success
 }
 
 // Function to send a DISC command
@@ -512,11 +793,11 @@ int send_DISC()
     unsigned char buf[5] = {FLAG, 0, DISC, 0, FLAG};
 
     // Set the second byte based on the role (Receiver or Transmitter)
-    if (connection_parameters.role == LlRx)
+    if (current_link->connection_parameters.role == LlRx)
     {
         buf[1] = RECEIVER_ADDRESS; // Receiver's address
     }
-    else if (connection_parameters.role == LlTx)
+    else if (current_link->connection_parameters.role == LlTx)
     {
         buf[1] = TRANSMITTER_ADDRESS; // Transmitter's address
     }
@@ -530,8 +811,8 @@ int send_DISC()
         return -1; // Return -1 on failure
     }
 
-    statistics.num_DISC_sent++; // Increment the count of DISC commands sent
-    return 1;                   // Return 1 on success
+    current_link->statistics.num_DISC_sent++; // Increment the count of DISC commands sent
+    return 1;                                 // Return 1 on success
 }
 
 // Function to close the connection from the transmitter's side
@@ -542,64 +823,56 @@ int llclose_transmitter()
     create_state_machine(&machine, DISCONNECTION, DISC, RECEIVER_ADDRESS, START);
 
     unsigned int attempt = 0;
-    extern int alarm_enabled;
-    extern int alarm_count;
-    alarm_enabled = FALSE; // Disable alarm
-    alarm_count = 0;       // Reset alarm count
 
-    (void)signal(SIGALRM, alarm_handler); // Set the alarm handler
+    struct timer timer;                   // Retransmission timer
 
     // Try sending the DISC command up to nRetransmissions times
-    while (attempt < connection_parameters.nRetransmissions)
+    while (attempt < current_link->connection_parameters.nRetransmissions)
     {
         attempt++;
 
         if (send_DISC() < 0) // Attempt to send DISC
         {
-            alarm(0);                         // Disable alarm if sending fails
-            statistics.num_retransmissions++; // Increment retransmission count
-            continue;                         // Retry sending DISC
+            timer_stop(&timer);                             // Stop timer
+            current_link->statistics.num_retransmissions++; // Increment retransmission count
+            continue;                                       // Retry sending DISC
         }
 
-        alarm(connection_parameters.timeout); // Set the alarm with the timeout value
-        alarm_enabled = TRUE;                 // Enable the alarm
-        machine.state = START;                // Reset state machine state
+        timer_start(&timer, current_link->rtt.rto); // Start retransmission timer
+        machine.state = START;                      // Reset state machine state
 
-        // Wait for a response while the alarm is enabled
-        while (alarm_enabled)
+        // Wait for a response until the timer expires
+        while (!timer_expired(&timer))
         {
-            unsigned char byte = 0;
-            int read_byte = readByteSerialPort(&byte); // Read a byte from the serial port
+            int received = rx_buffer_receive_frame(&machine, &timer); // Run the state machine over the received bytes
 
-            if (read_byte == 0)
+            if (received == 0)
             {
-                continue; // No bytes read, continue waiting
+                continue; // No complete frame yet, continue waiting
             }
-            else if (read_byte < 0)
+            else if (received < 0)
             {
                 printf("Read ERROR!");
                 return -1; // Return error on read failure
             }
 
-            // Process the received byte with the state machine
-            state_machine(&machine, byte);
-
             if (machine.state == STP) // If in STOP state, DISC received successfully
             {
-                statistics.num_DISC_received++; // Increment DISC received count
-                alarm(0);                       // Disable alarm
-                alarm_enabled = FALSE;          // Disable alarm flag
+                current_link->statistics.num_DISC_received++; // Increment DISC received count
+                timer_stop(&timer);                           // Stop timer
 
-                if (send_ACK() < 0) // Send ACK in response
+                if (send_ACK(FALSE) < 0) // Send ACK in response
                     return -1;
 
                 return 1; // Return success
             }
         }
-        statistics.num_retransmissions++; // Increment retransmission count on timeout
-        statistics.num_timeouts++;        // Increment timeout count
+        current_link->statistics.num_retransmissions++; // Increment retransmission count on timeout
+        current_link->statistics.num_timeouts++;        // Increment timeout count
+        if (!rtt_backoff(&current_link->rtt))
+            attempt--; // Timeout below the configured one: back off without using up an attempt
     }
-    printf("Failed to send DISC after %d attempts\n", connection_parameters.nRetransmissions);
+    printf("Failed to send DISC after %d attempts\n", current_link->connection_parameters.nRetransmissions);
     return -1; // Return error after max attempts
 }
 
@@ -613,26 +886,22 @@ int llclose_receiver()
     // Wait for the DISC frame from the transmitter
     do
     {
-        unsigned char byte = 0;
-        int read_byte = readByteSerialPort(&byte); // Read a byte from the serial port
+        int received = rx_buffer_receive_frame(&machine, NULL); // Run the state machine over the received bytes
 
-        if (read_byte == 0)
+        if (received == 0)
         {
-            continue; // No bytes read, continue waiting
+            continue; // No complete frame yet, continue waiting
         }
-        else if (read_byte < 0)
+        else if (received < 0)
         {
             printf("Read ERROR!");
             return -1; // Return error on read failure
         }
 
-        // Process the received byte with the state machine
-        state_machine(&machine, byte);
-
         if (machine.state == STP) // If in STOP state, DISC received successfully
         {
-            statistics.num_DISC_received++; // Increment DISC received count
-            break;                          // Exit the loop
+            current_link->statistics.num_DISC_received++; // Increment DISC received count
+            break;                                        // Exit the loop
         }
     } while (machine.state != STP);
 
@@ -640,60 +909,52 @@ int llclose_receiver()
     create_state_machine(&machine, DISCONNECTION, UA, REPLY_FROM_TRANSMITTER_ADDRESS, START);
 
     unsigned int attempt = 0;
-    extern int alarm_enabled;
-    extern int alarm_count;
-    alarm_enabled = FALSE; // Disable alarm
-    alarm_count = 0;       // Reset alarm count
 
-    (void)signal(SIGALRM, alarm_handler); // Set the alarm handler
+    struct timer timer;                   // Retransmission timer
 
     // Try sending the DISC command up to nRetransmissions times
-    while (attempt < connection_parameters.nRetransmissions)
+    while (attempt < current_link->connection_parameters.nRetransmissions)
     {
         attempt++;
 
         if (send_DISC() < 0) // Attempt to send DISC
         {
-            alarm(0);                         // Disable alarm if sending fails
-            statistics.num_retransmissions++; // Increment retransmission count
-            continue;                         // Retry sending DISC
+            timer_stop(&timer);                             // Stop timer
+            current_link->statistics.num_retransmissions++; // Increment retransmission count
+            continue;                                       // Retry sending DISC
         }
 
-        alarm(connection_parameters.timeout); // Set the alarm with the timeout value
-        alarm_enabled = TRUE;                 // Enable the alarm
-        machine.state = START;                // Reset state machine state
+        timer_start(&timer, current_link->rtt.rto); // Start retransmission timer
+        machine.state = START;                      // Reset state machine state
 
-        // Wait for a response while the alarm is enabled
-        while (alarm_enabled)
+        // Wait for a response until the timer expires
+        while (!timer_expired(&timer))
         {
-            unsigned char byte = 0;
-            int read_byte = readByteSerialPort(&byte); // Read a byte from the serial port
+            int received = rx_buffer_receive_frame(&machine, &timer); // Run the state machine over the received bytes
 
-            if (read_byte == 0)
+            if (received == 0)
             {
-                continue; // No bytes read, continue waiting
+                continue; // No complete frame yet, continue waiting
             }
-            else if (read_byte < 0)
+            else if (received < 0)
             {
                 printf("Read ERROR!");
                 return -1; // Return error on read failure
             }
 
-            // Process the received byte with the state machine
-            state_machine(&machine, byte);
-
             if (machine.state == STP) // If in STOP state, UA received successfully
             {
-                statistics.num_UA_received++; // Increment UA received count
-                alarm(0);                     // Disable alarm
-                alarm_enabled = FALSE;        // Disable alarm flag
-                return 1;                     // Return success
+                current_link->statistics.num_UA_received++; // Increment UA received count
+                timer_stop(&timer);                         // Stop timer
+                return 1;                                   // Return success
             }
         }
-        statistics.num_retransmissions++; // Increment retransmission count on timeout
-        statistics.num_timeouts++;        // Increment timeout count
+        current_link->statistics.num_retransmissions++; // Increment retransmission count on timeout
+        current_link->statistics.num_timeouts++;        // Increment timeout count
+        if (!rtt_backoff(&current_link->rtt))
+            attempt--; // Timeout below the configured one: back off without using up an attempt
     }
-    printf("Failed to send DISC after %d attempts\n", connection_parameters.nRetransmissions);
+    printf("Failed to send DISC after %d attempts\n", current_link->connection_parameters.nRetransmissions);
     return -1; // Return error after max attempts
 }
 
@@ -705,6 +966,7 @@ void show_statistics(struct ll_statistics statistics)
                           statistics.num_UA_sent +
                           statistics.num_RR_sent +
                           statistics.num_REJ_sent +
+                          statistics.num_SREJ_sent +
                           statistics.num_I_frames_sent +
                           statistics.num_DISC_sent;
 
@@ -712,6 +974,7 @@ void show_statistics(struct ll_statistics statistics)
                               statistics.num_UA_received +
                               statistics.num_RR_received +
                               statistics.num_REJ_received +
+                              statistics.num_SREJ_received +
                               statistics.num_I_frames_received +
                               statistics.num_DISC_received;
 
@@ -727,6 +990,8 @@ void show_statistics(struct ll_statistics statistics)
     printf("Total RR Frames Received: %d\n", statistics.num_RR_received);
     printf("Total REJ Frames Sent: %d\n", statistics.num_REJ_sent);
     printf("Total REJ Frames Received: %d\n", statistics.num_REJ_received);
+    printf("Total SREJ Frames Sent: %d\n", statistics.num_SREJ_sent);
+    printf("Total SREJ Frames Received: %d\n", statistics.num_SREJ_received);
     printf("Total I Frames Sent: %d\n", statistics.num_I_frames_sent);
     printf("Total I Frames Received: %d\n", statistics.num_I_frames_received);
     printf("Total DISC Frames Sent: %d\n", statistics.num_DISC_sent);
@@ -734,7 +999,542 @@ void show_statistics(struct ll_statistics statistics)
     printf("Total Invalid BCC1 Received: %d\n", statistics.num_invalid_BCC1_received);
     printf("Total Invalid BCC2 Received: %d\n", statistics.num_invalid_BCC2_received);
     printf("Total Duplicated Frames Received: %d\n", statistics.num_duplicated_frames);
+    if (ll_fec_parity() > 0)
+        printf("Total Frames Repaired by FEC: %d (%d bytes)\n", statistics.num_FEC_repaired_frames, statistics.num_FEC_repaired_bytes);
+    if (ll_whitening() && statistics.num_whitening_masks_sent > 0)
+        printf("Stuffing Bytes Saved by Whitening: %d (%d escapes avoided, %d mask bytes sent)\n",
+               statistics.num_escapes_avoided - statistics.num_whitening_masks_sent,
+               statistics.num_escapes_avoided, statistics.num_whitening_masks_sent);
     printf("Total Timeouts: %d\n", statistics.num_timeouts);
     printf("Total Retransmissions: %d\n", statistics.num_retransmissions);
+    if (current_link->rtt.samples > 0)
+        printf("Smoothed RTT: %.0f ms (variation %.0f ms), Timeout: %d ms\n", current_link->rtt.srtt, current_link->rtt.rttvar, current_link->rtt.rto);
     printf("\n");
 }
+
+
+////////////////////////////////////////////////
+// SLIDING WINDOW (GO-BACK-N / SELECTIVE REPEAT)
+////////////////////////////////////////////////
+
+// Queue a frame in the transmitter window, blocking only while the window is full
+int llwrite_window(const unsigned char *buf, int bufSize)
+{
+    int sequence_number;
+    struct tx_window_slot *slot = window_reserve(&sequence_number);
+    if (slot == NULL)
+        return -1;
+
+    slot->frame_size = build_data_frame(buf, bufSize, sequence_number, slot->frame);
+    if (slot->frame_size < 0 || window_commit() < 0)
+        return -1;
+    return bufSize;
+}
+
+// Sliding window: queue a frame encoded ahead, completing its header
+int llwrite_window_encoded(struct encoded_frame *frame)
+{
+    int sequence_number;
+    struct tx_window_slot *slot = window_reserve(&sequence_number);
+    if (slot == NULL)
+        return -1;
+
+    // The slot keeps the frame until it is acknowledged and gives its own buffer back
+    unsigned char *buffer = slot->frame;
+    slot->frame = frame->frame;
+    frame->frame = buffer;
+    frame_write_header(current_link->parameters, sequence_number, slot->frame);
+    slot->frame_size = frame->size;
+    count_encoded_frame(frame);
+    if (window_commit() < 0)
+        return -1;
+    return frame->data_size;
+}
+
+// Wait for the receiver to free a slot of the window.
+// Returns the slot for the next frame and its sequence number, or NULL on error.
+struct tx_window_slot *window_reserve(int *sequence_number)
+{
+    while (current_link->tx_window.count == ll_window_size())
+    {
+        if (window_receive_acknowledgements(TRUE) < 0)
+            return NULL;
+    }
+
+    *sequence_number = (current_link->tx_window.base + current_link->tx_window.count) % LL_SEQUENCE_MODULUS;
+    struct tx_window_slot *slot = &current_link->tx_window.slots[(current_link->tx_window.first_slot + current_link->tx_window.count) % ll_window_size()];
+    slot->attempt = 0;
+    return slot;
+}
+
+// Send the frame placed in the slot returned by window_reserve.
+// Returns 1 on success, -1 on error.
+int window_commit()
+{
+    if (window_send(current_link->tx_window.count++, FALSE) < 0)
+        return -1;
+
+    // Handle acknowledgements that already arrived, without waiting for more
+    if (window_receive_acknowledgements(FALSE) < 0)
+        return -1;
+
+    return 1;
+}
+
+// Go-Back-N: receive the next in-order frame; anything else is answered with RR or REJ
+int llread_go_back_n(unsigned char *packet)
+{
+    struct state_machine machine;
+    // Create a type READ state machine accepting any sequence number
+    create_state_machine(&machine, READ, I_FRAME_N, TRANSMITTER_ADDRESS, START);
+    state_machine_use_buffer(&machine, current_link->rx_frame, current_link->rx_frame_capacity);
+
+    while (1)
+    {
+        int received = rx_buffer_receive_frame(&machine, NULL); // Run the state machine over the received bytes
+
+        if (received == 0)
+        {
+            continue; // No complete frame yet, continue waiting
+        }
+        else if (received < 0)
+        {
+            printf("Read ERROR!"); // Error reading byte
+            return -1;
+        }
+        if (machine.state != STP)
+            continue;
+        machine.state = START; // Reset state for next frame
+
+        if (machine.ACK) // SET received
+        {
+            if (current_link->frames_received == 0) // UA was lost, acknowledge again
+            {
+                current_link->statistics.num_SET_received++; // Count SET received
+                if (send_ACK(TRUE) < 0)
+                    return -1; // Error sending ACK
+            }
+            continue;
+        }
+
+        current_link->statistics.num_I_frames_received++; // Count I frames received
+
+        // Position of the frame relative to the one we expect
+        int distance = (machine.sequence_number - current_link->expected_sequence + LL_SEQUENCE_MODULUS) % LL_SEQUENCE_MODULUS;
+
+        if (distance >= ll_window_size()) // Retransmission of a frame already delivered
+        {
+            current_link->statistics.num_duplicated_frames++; // Count duplicated frames
+            if (send_RR_N(current_link->expected_sequence) < 0)
+                return -1; // Error sending RR
+        }
+        else if (distance > 0 || machine.REJ) // Earlier frame lost, or bad data
+        {
+            if (!current_link->reject_sent) // One REJ per gap, the transmitter resends everything after it
+            {
+                if (send_REJ_N(current_link->expected_sequence) < 0)
+                    return -1; // Error sending REJ
+                current_link->reject_sent = TRUE;
+            }
+        }
+        else // Frame received in sequence
+        {
+            current_link->frames_received++;                                                               // Increment frames received count
+            current_link->expected_sequence = (current_link->expected_sequence + 1) % LL_SEQUENCE_MODULUS; // Advance window
+            current_link->reject_sent = FALSE;
+
+            if (send_RR_N(current_link->expected_sequence) < 0)
+                return -1; // Error sending RR
+
+            memcpy(packet, machine.buf, machine.buf_size); // Copy received packet to provided buffer
+            return machine.buf_size;                       // Return size of received packet
+        }
+    }
+}
+
+// Selective Repeat: keep good frames received out of order and ask (SREJ) only
+// for the ones missing or damaged
+int llread_selective_repeat(unsigned char *packet)
+{
+    // Deliver a frame that is already buffered. Frames are only acknowledged
+    // once delivered, as their slots stay taken until then: the RR goes at the
+    // end of the run of buffered frames.
+    struct rx_window_slot *first = &current_link->rx_window.slots[current_link->rx_window.first_slot];
+    if (first->received)
+    {
+        int size = first->size;
+        memcpy(packet, first->data, size);
+        rx_window_advance();
+        current_link->frames_received++; // Increment frames received count
+
+        if (!current_link->rx_window.slots[current_link->rx_window.first_slot].received &&
+            send_RR_N(current_link->expected_sequence) < 0)
+            return -1; // Error sending RR
+        return size;
+    }
+
+    struct state_machine machine;
+    // Create a type READ state machine accepting any sequence number
+    create_state_machine(&machine, READ, I_FRAME_N, TRANSMITTER_ADDRESS, START);
+    state_machine_use_buffer(&machine, current_link->rx_frame, current_link->rx_frame_capacity);
+
+    while (1)
+    {
+        int received = rx_buffer_receive_frame(&machine, NULL); // Run the state machine over the received bytes
+
+        if (received == 0)
+        {
+            continue; // No complete frame yet, continue waiting
+        }
+        else if (received < 0)
+        {
+            printf("Read ERROR!"); // Error reading byte
+            return -1;
+        }
+        if (machine.state != STP)
+            continue;
+        machine.state = START; // Reset state for next frame
+
+        if (machine.ACK) // SET received
+        {
+            if (current_link->frames_received == 0) // UA was lost, acknowledge again
+            {
+                current_link->statistics.num_SET_received++; // Count SET received
+                if (send_ACK(TRUE) < 0)
+                    return -1; // Error sending ACK
+            }
+            continue;
+        }
+
+        current_link->statistics.num_I_frames_received++; // Count I frames received
+
+        // Position of the frame relative to the one we expect
+        int distance = (machine.sequence_number - current_link->expected_sequence + LL_SEQUENCE_MODULUS) % LL_SEQUENCE_MODULUS;
+        struct rx_window_slot *slot = &current_link->rx_window.slots[(current_link->rx_window.first_slot + distance) % ll_window_size()];
+
+        if (distance >= ll_window_size() || slot->received) // Frame already received
+        {
+            current_link->statistics.num_duplicated_frames++; // Count duplicated frames
+            if (send_RR_N(current_link->expected_sequence) < 0)
+                return -1; // Error sending RR
+            continue;
+        }
+
+        if (machine.REJ) // Bad data: the header (checked by BCC1) still tells which frame it was
+        {
+            if (send_SREJ_N(machine.sequence_number) < 0)
+                return -1; // Error sending SREJ
+            slot->rejected = TRUE;
+            continue;
+        }
+
+        // Ask once for every frame missing before this one
+        for (int i = 0; i < distance; i++)
+        {
+            struct rx_window_slot *missing = &current_link->rx_window.slots[(current_link->rx_window.first_slot + i) % ll_window_size()];
+            if (!missing->received && !missing->rejected)
+            {
+                if (send_SREJ_N((current_link->expected_sequence + i) % LL_SEQUENCE_MODULUS) < 0)
+                    return -1; // Error sending SREJ
+                missing->rejected = TRUE;
+            }
+        }
+
+        if (distance > 0) // Keep it until the gap is filled
+        {
+            memcpy(slot->data, machine.buf, machine.buf_size);
+            slot->size = machine.buf_size;
+            slot->received = TRUE;
+            continue;
+        }
+
+        // Frame received in sequence
+        rx_window_advance();
+        current_link->frames_received++; // Increment frames received count
+
+        if (send_RR_N(current_link->expected_sequence) < 0)
+            return -1; // Error sending RR
+
+        memcpy(packet, machine.buf, machine.buf_size); // Copy received packet to provided buffer
+        return machine.buf_size;                       // Return size of received packet
+    }
+}
+
+// Release the first receiver slot and move on to the next frame
+void rx_window_advance()
+{
+    struct rx_window_slot *first = &current_link->rx_window.slots[current_link->rx_window.first_slot];
+    first->received = FALSE;
+    first->rejected = FALSE;
+    current_link->rx_window.first_slot = (current_link->rx_window.first_slot + 1) % ll_window_size();
+    current_link->expected_sequence = (current_link->expected_sequence + 1) % LL_SEQUENCE_MODULUS;
+}
+
+// Reset both sliding windows
+void window_init()
+{
+    memset(&current_link->tx_window, 0, sizeof(current_link->tx_window));
+    memset(&current_link->rx_window, 0, sizeof(current_link->rx_window));
+    current_link->expected_sequence = 0;
+    current_link->reject_sent = FALSE;
+    create_state_machine(&current_link->tx_window.machine, WRITE, RR_N, REPLY_FROM_RECEIVER_ADDRESS, START);
+}
+
+// Allocate the frame buffers for the agreed payload size and window
+// Returns 1 on success, -1 on failure
+int buffers_init()
+{
+    int message_size = ll_max_payload_size() + (ll_whitening() ? 1 : 0) + MAX_CHECK_SIZE; // Data, mask and check
+    int encoded_size = fec_encoded_size(message_size, ll_fec_parity());
+    int frame_size = frame_max_size(current_link->parameters);
+    current_link->rx_frame_capacity = encoded_size;
+    if (ll_framing() == LL_FRAMING_COBS)
+        current_link->rx_frame_capacity = COBS_MAX_SIZE(encoded_size); // Decoded in place at the closing FLAG
+
+    current_link->tx_frame = malloc(frame_size);
+    current_link->rx_frame = malloc(current_link->rx_frame_capacity);
+    if (current_link->tx_frame == NULL || current_link->rx_frame == NULL)
+    {
+        printf("Failed to allocate frame buffers\n");
+        buffers_free();
+        return -1;
+    }
+
+    if (frame_encoder_init(&current_link->encoder, current_link->parameters) < 0)
+    {
+        buffers_free();
+        return -1;
+    }
+
+    for (int i = 0; i < ll_window_size() && ll_window_size() > 1; i++)
+    {
+        current_link->tx_window.slots[i].frame = malloc(frame_size);
+        current_link->rx_window.slots[i].data = malloc(ll_max_payload_size());
+        if (current_link->tx_window.slots[i].frame == NULL || current_link->rx_window.slots[i].data == NULL)
+        {
+            printf("Failed to allocate window buffers\n");
+            buffers_free();
+            return -1;
+        }
+    }
+    return 1;
+}
+
+// Release the frame buffers
+void buffers_free()
+{
+    free(current_link->tx_frame);
+    free(current_link->rx_frame);
+    frame_encoder_free(&current_link->encoder);
+    current_link->tx_frame = NULL;
+    current_link->rx_frame = NULL;
+    current_link->rx_frame_capacity = 0;
+
+    for (int i = 0; i < LL_WINDOW_SIZE; i++)
+    {
+        free(current_link->tx_window.slots[i].frame);
+        free(current_link->rx_window.slots[i].data);
+        current_link->tx_window.slots[i].frame = NULL;
+        current_link->rx_window.slots[i].data = NULL;
+    }
+}
+
+// Write the frame at position "index" of the window and start its timer
+int window_send(int index, int retransmission)
+{
+    struct tx_window_slot *slot = &current_link->tx_window.slots[(current_link->tx_window.first_slot + index) % ll_window_size()];
+
+    if (safe_write(slot->frame, slot->frame_size) < 0)
+    {
+        printf("Failed to send frame %d!\n", (current_link->tx_window.base + index) % LL_SEQUENCE_MODULUS);
+        return -1;
+    }
+
+    current_link->statistics.num_I_frames_sent++; // Count I frames sent
+    if (retransmission)
+        current_link->statistics.num_retransmissions++; // Count retransmission
+
+    slot->retransmitted = retransmission;
+    timer_now(&slot->sent_at); // Start measuring the round trip
+    timer_start(&slot->timer, frame_timeout(slot->frame_size));
+    return 1;
+}
+
+// Resend every unacknowledged frame, oldest first
+int window_go_back()
+{
+    for (int i = 0; i < current_link->tx_window.count; i++)
+    {
+        if (window_send(i, TRUE) < 0)
+            return -1;
+    }
+    return 1;
+}
+
+// Slide the window past every frame before "sequence_number" (cumulative acknowledgement)
+// Returns the number of frames acknowledged
+int window_acknowledge(int sequence_number)
+{
+    int acknowledged = (sequence_number - current_link->tx_window.base + LL_SEQUENCE_MODULUS) % LL_SEQUENCE_MODULUS;
+    if (acknowledged == 0 || acknowledged > current_link->tx_window.count)
+        return 0; // Nothing new, or a stale acknowledgement
+
+    // Measure the round trip on the newest frame acknowledged, unless it was resent (Karn's rule)
+    struct tx_window_slot *newest = &current_link->tx_window.slots[(current_link->tx_window.first_slot + acknowledged - 1) % ll_window_size()];
+    if (!newest->retransmitted)
+        rtt_sample(&current_link->rtt, elapsed_ms(&newest->sent_at));
+
+    current_link->tx_window.base = sequence_number;
+    current_link->tx_window.first_slot = (current_link->tx_window.first_slot + acknowledged) % ll_window_size();
+    current_link->tx_window.count -= acknowledged;
+
+    // The receiver is making progress: restart the timers of the frames still queued
+    // behind the acknowledged ones, so they are not resent just for waiting in line
+    for (int i = 0; i < current_link->tx_window.count; i++)
+    {
+        struct tx_window_slot *slot = &current_link->tx_window.slots[(current_link->tx_window.first_slot + i) % ll_window_size()];
+        timer_start(&slot->timer, frame_timeout(slot->frame_size));
+    }
+
+    return acknowledged;
+}
+
+// Handle the RR, REJ or SREJ frame parsed by the window state machine
+int window_handle_frame()
+{
+    struct state_machine *machine = &current_link->tx_window.machine;
+    machine->state = START; // Reset state machine for the next frame
+
+    if (machine->SREJ) // SREJ received: resend only the frame asked for
+    {
+        current_link->statistics.num_SREJ_received++; // Count SREJ received
+        int index = (machine->sequence_number - current_link->tx_window.base + LL_SEQUENCE_MODULUS) % LL_SEQUENCE_MODULUS;
+        if (index < current_link->tx_window.count)
+            return window_send(index, TRUE);
+        return 1;
+    }
+
+    if (machine->REJ) // REJ received: resend everything from the rejected frame
+    {
+        current_link->statistics.num_REJ_received++; // Count REJ received
+        window_acknowledge(machine->sequence_number);
+
+        // Go back only if the rejected frame is still outstanding
+        if (current_link->tx_window.count > 0 && machine->sequence_number == current_link->tx_window.base)
+            return window_go_back();
+        return 1;
+    }
+
+    current_link->statistics.num_RR_received++; // Count RR received
+    window_acknowledge(machine->sequence_number);
+    return 1;
+}
+
+// Resend frames whose timer expired: the whole window for Go-Back-N (timer of
+// the oldest frame), or each expired frame on its own for Selective Repeat
+int window_check_timers()
+{
+    // Go-Back-N only runs the timer of the oldest frame
+    int timers = (ll_arq_mode() == LL_SELECTIVE_REPEAT) ? current_link->tx_window.count : (current_link->tx_window.count > 0);
+
+    for (int i = 0; i < timers; i++)
+    {
+        struct tx_window_slot *slot = &current_link->tx_window.slots[(current_link->tx_window.first_slot + i) % ll_window_size()];
+        if (!timer_expired(&slot->timer))
+            continue;
+
+        current_link->statistics.num_timeouts++; // Count timeout
+        // Only timeouts at the configured value use up an attempt
+        if (rtt_backoff(&current_link->rtt))
+        {
+            current_link->statistics.num_full_timeouts++;
+            if (++slot->attempt >= current_link->connection_parameters.nRetransmissions)
+            {
+                printf("Failed to send frame after %d attempts\n", current_link->connection_parameters.nRetransmissions);
+                return -1;
+            }
+        }
+
+        if (ll_arq_mode() == LL_SELECTIVE_REPEAT)
+        {
+            if (window_send(i, TRUE) < 0)
+                return -1;
+        }
+        else
+        {
+            return window_go_back(); // Every frame after the oldest one is resent too
+        }
+    }
+    return 1;
+}
+
+// Timer of the window that expires first, or NULL if no frame is outstanding
+const struct timer *window_next_timer()
+{
+    // Go-Back-N only runs the timer of the oldest frame
+    int timers = (ll_arq_mode() == LL_SELECTIVE_REPEAT) ? current_link->tx_window.count : (current_link->tx_window.count > 0);
+    const struct timer *next = NULL;
+    int next_remaining = 0;
+
+    for (int i = 0; i < timers; i++)
+    {
+        const struct timer *timer = &current_link->tx_window.slots[(current_link->tx_window.first_slot + i) % ll_window_size()].timer;
+        int remaining = timer_remaining_ms(timer);
+        if (remaining < 0)
+            continue; // Not running
+        if (next == NULL || remaining < next_remaining)
+        {
+            next = timer;
+            next_remaining = remaining;
+        }
+    }
+    return next;
+}
+
+// Process acknowledgements from the receiver.
+// When "wait" is set, block until at least one frame is acknowledged, handling
+// timeouts meanwhile; otherwise only consume the bytes already available.
+int window_receive_acknowledgements(int wait)
+{
+    int initial_count = current_link->tx_window.count;
+
+    while (1)
+    {
+        if (wait && window_check_timers() < 0)
+            return -1;
+
+        struct timer no_wait; // Expires at once: only process the bytes already received
+        timer_start(&no_wait, 0);
+
+        // Sleep until a frame arrives or a timer expires
+        int received = rx_buffer_receive_frame(&current_link->tx_window.machine, wait ? window_next_timer() : &no_wait);
+
+        if (received == 0)
+        {
+            if (!wait)
+                return 1; // Nothing more available
+            continue;     // No complete frame yet, continue waiting
+        }
+        else if (received < 0)
+        {
+            printf("Read ERROR!"); // Error reading byte
+            return -1;
+        }
+
+        if (window_handle_frame() < 0)
+            return -1;
+        if (wait && current_link->tx_window.count < initial_count)
+            return 1; // Window moved
+    }
+}
+
+// Wait until every frame in the window is acknowledged
+int window_flush()
+{
+    while (current_link->tx_window.count > 0)
+    {
+        if (window_receive_acknowledgements(TRUE) < 0)
+            return -1;
+    }
+    return 1;
+}
@@ -0,0 +1,183 @@
+// LZ77 block codec (see lz.h). The compressor finds matches through a hash
+// table of the last position of every 4 byte sequence, as LZ4 does: a single
+// probe per position, so it runs at memory speed and needs no allocation.
+
+#include "lz.h"
+#include <stdint.h>
+#include <string.h>
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_BITS 12
+
+// Helper Functions prototypes
+uint32_t lz_read32(const unsigned char *p);
+int lz_hash(uint32_t sequence);
+int lz_put_length(unsigned char *dst, int size, int capacity, int length);
+int lz_put_sequence(unsigned char *dst, int size, int capacity,
+                    const unsigned char *literals, int literal_count, int offset, int match_length);
+int lz_get_length(const unsigned char *src, int len, int *index, int length);
+
+uint32_t lz_read32(const unsigned char *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Multiplicative hash of a 4 byte sequence
+int lz_hash(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Compress len bytes of src into dst (capacity bytes).
+// Returns the compressed size, or -1 if it does not fit in capacity.
+int lz_compress(const unsigned char *src, int len, unsigned char *dst, int capacity)
+{
+    int table[1 << LZ_HASH_BITS]; // Last position of each hashed sequence
+    for (int i = 0; i < (1 << LZ_HASH_BITS); i++)
+        table[i] = -1;
+
+    int size = 0;
+    int anchor = 0; // First literal not yet written
+    int i = 0;
+
+    while (i + LZ_MIN_MATCH <= len)
+    {
+        uint32_t sequence = lz_read32(src + i);
+        int h = lz_hash(sequence);
+        int candidate = table[h];
+        table[h] = i;
+
+        if (candidate < 0 || i - candidate > LZ_MAX_OFFSET || lz_read32(src + candidate) != sequence)
+        {
+            i++;
+            continue;
+        }
+
+        int length = LZ_MIN_MATCH;
+        while (i + length < len && src[candidate + length] == src[i + length])
+            length++;
+
+        size = lz_put_sequence(dst, size, capacity, src + anchor, i - anchor, i - candidate, length);
+        if (size < 0)
+            return -1;
+
+        i += length;
+        anchor = i;
+    }
+
+    // Remaining bytes as a literals only sequence
+    return lz_put_sequence(dst, size, capacity, src + anchor, len - anchor, 0, 0);
+}
+
+// Decompress len bytes of src into dst (capacity bytes).
+// Returns the decompressed size, or -1 if the data is damaged or too large.
+int lz_decompress(const unsigned char *src, int len, unsigned char *dst, int capacity)
+{
+    int index = 0;
+    int size = 0;
+
+    while (index < len)
+    {
+        unsigned char token = src[index++];
+
+        int literal_count = lz_get_length(src, len, &index, token >> 4);
+        if (literal_count < 0 || literal_count > len - index || literal_count > capacity - size)
+            return -1;
+        memcpy(dst + size, src + index, literal_count);
+        index += literal_count;
+        size += literal_count;
+
+        if (index == len)
+            break; // Last sequence: literals only
+
+        if (len - index < 2)
+            return -1;
+        int offset = src[index] | (src[index + 1] << 8);
+        index += 2;
+
+        int match_length = lz_get_length(src, len, &index, token & 0x0F);
+        if (match_length < 0)
+            return -1;
+        match_length += LZ_MIN_MATCH;
+
+        if (offset == 0 || offset > size || match_length > capacity - size)
+            return -1;
+
+        // Byte by byte: the match may overlap the bytes it produces
+        for (int i = 0; i < match_length; i++, size++)
+            dst[size] = dst[size - offset];
+    }
+
+    return size;
+}
+
+// Write the extra bytes of a length whose nibble was 15
+// Returns the new size of dst, or -1 if it does not fit
+int lz_put_length(unsigned char *dst, int size, int capacity, int length)
+{
+    for (length -= 15; length >= 255; length -= 255)
+    {
+        if (size >= capacity)
+            return -1;
+        dst[size++] = 255;
+    }
+    if (size >= capacity)
+        return -1;
+    dst[size++] = length;
+    return size;
+}
+
+// Write a sequence; offset 0 writes the last, literals only, sequence
+// Returns the new size of dst, or -1 if it does not fit
+int lz_put_sequence(unsigned char *dst, int size, int capacity,
+                    const unsigned char *literals, int literal_count, int offset, int match_length)
+{
+    int match_code = offset > 0 ? match_length - LZ_MIN_MATCH : 0;
+
+    if (size >= capacity)
+        return -1;
+    dst[size++] = ((literal_count < 15 ? literal_count : 15) << 4) | (match_code < 15 ? match_code : 15);
+
+    if (literal_count >= 15 && (size = lz_put_length(dst, size, capacity, literal_count)) < 0)
+        return -1;
+
+    if (literal_count > capacity - size)
+        return -1;
+    memcpy(dst + size, literals, literal_count);
+    size += literal_count;
+
+    if (offset == 0)
+        return size;
+
+    if (capacity - size < 2)
+        return -1;
+    dst[size++] = offset & 0xFF;
+    dst[size++] = offset >> 8;
+
+    if (match_code >= 15 && (size = lz_put_length(dst, size, capacity, match_code)) < 0)
+        return -1;
+
+    return size;
+}
+
+// Read a length given its nibble and, if the nibble is 15, its extra bytes
+// Returns the length, or -1 if the data ends too early
+int lz_get_length(const unsigned char *src, int len, int *index, int length)
+{
+    if (length < 15)
+        return length;
+
+    unsigned char byte;
+    do
+    {
+        if (*index >= len)
+            return -1;
+        byte = src[(*index)++];
+        length += byte;
+    } while (byte == 255);
+
+    return length;
+}
@@ -0,0 +1,463 @@
+// Control packets, data packet headers and the byte order of their fields
+
+#include "packet.h"
+#include "app_config.h"
+#include "lz.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// File information of a file to send under the given name, with the codec
+// of this side. Returns -1 if the name does not fit a FILE_NAME field, 1
+// otherwise.
+int file_info_init(struct file_info *info, const char *name, long long file_size)
+{
+    memset(info, 0, sizeof(struct file_info));
+    if (strlen(name) > UCHAR_MAX)
+    {
+        printf("File name too long: %s\n", name);
+        return -1;
+    }
+    strcpy((char *)info->name, name);
+    info->file_size = file_size;
+    info->codec = AL_COMPRESSION ? CODEC_LZ : CODEC_NONE;
+    return 1;
+}
+
+// Send a control packet with file information over a link. A START packet
+// also carries the codec, the tag of the file, the offset its data starts
+// from and whether another file follows, when they are set.
+int send_control_packet(struct ll_link *link, int control_byte, const struct file_info *info)
+{
+    unsigned char packet[MAX_PAYLOAD_SIZE];
+    int packet_size = 0;
+    const char *filename = (const char *)info->name;
+    long long file_size = info->file_size;
+
+    packet[packet_size++] = control_byte; // Control field
+
+    // Include file size in the packet, least significant byte first. Files
+    // past 2 GiB use FILE_SIZE_64, which older receivers skip instead of
+    // copying 8 bytes into their 4 byte size.
+    int length = file_size > INT_MAX ? 8 : 4;
+    packet[packet_size++] = length == 8 ? FILE_SIZE_64 : FILE_SIZE; // T
+    packet[packet_size++] = (unsigned char)length;                  // L (Length of V)
+    put_le(&packet[packet_size], file_size, length);                // V
+    packet_size += length;
+
+    // Include file name in the packet
+    packet[packet_size++] = FILE_NAME;                        // T
+    packet[packet_size++] = (unsigned char)strlen(filename);  // L (Length of V)
+    memcpy(&packet[packet_size], filename, strlen(filename)); // V
+    packet_size += strlen(filename);
+
+    // Advertise the codec of the data packets
+    if (control_byte == START && info->codec != CODEC_NONE)
+    {
+        packet[packet_size++] = CODEC;       // T
+        packet[packet_size++] = 1;           // L
+        packet[packet_size++] = info->codec; // V
+    }
+
+    // Identify the file and where its data starts
+    if (control_byte == START && info->tag != 0)
+    {
+        packet[packet_size++] = FILE_TAG;           // T
+        packet[packet_size++] = 4;                  // L
+        put_le(&packet[packet_size], info->tag, 4); // V
+        packet_size += 4;
+    }
+    if (control_byte == START && info->resume_offset > 0)
+    {
+        packet[packet_size++] = RESUME_OFFSET;                // T
+        packet[packet_size++] = 8;                            // L
+        put_le(&packet[packet_size], info->resume_offset, 8); // V
+        packet_size += 8;
+    }
+
+    // Block size of a signature
+    if (control_byte == START && info->block_size > 0)
+    {
+        packet[packet_size++] = BLOCK_SIZE;                // T
+        packet[packet_size++] = 4;                         // L
+        put_le(&packet[packet_size], info->block_size, 4); // V
+        packet_size += 4;
+    }
+
+    // Tell the receiver to expect another START after the END
+    if (control_byte == START && info->next_file)
+    {
+        packet[packet_size++] = NEXT_FILE; // T
+        packet[packet_size++] = 1;         // L
+        packet[packet_size++] = 1;         // V
+    }
+
+    // Close the file with its checksum
+    if (control_byte == END && info->has_checksum)
+    {
+        packet[packet_size++] = FILE_CHECKSUM;           // T
+        packet[packet_size++] = 4;                       // L
+        put_le(&packet[packet_size], info->checksum, 4); // V
+        packet_size += 4;
+    }
+
+    int bytes_written = ll_write(link, packet, packet_size);
+    if (bytes_written < 0)
+    {
+        printf("Failed to send control packet.\n");
+        return -1;
+    }
+
+    return 1; // Successfully sent control packet
+}
+
+// Read a control packet and extract file information
+int read_control_packet(struct file_info *info)
+{
+    unsigned char *control_packet = malloc(ll_max_payload_size()); // Sized for the agreed payload
+    if (control_packet == NULL)
+    {
+        printf("Failed to allocate packet buffer.\n");
+        return -1;
+    }
+
+    int bytes_read = llread(control_packet); // Read the start control packet
+
+    if (bytes_read < 0)
+    {
+        printf("Failed to read start control packet.\n");
+        free(control_packet);
+        return -1;
+    }
+
+    // Process the start control packet
+    if (control_packet[0] == START)
+    {
+        int result = parse_control_packet(control_packet, bytes_read, info);
+        free(control_packet);
+        return result;
+    }
+
+    printf("Unexpected control packet received: %d\n", control_packet[0]);
+    free(control_packet);
+    return -1; // Unexpected control packet received
+}
+
+// Extract file information from a start control packet of the given size.
+// Returns -1 if a field runs past the end of the packet, the file sizes sent
+// disagree or the resume offset is past the end of the file, 1 otherwise.
+int parse_control_packet(const unsigned char *control_packet, int size, struct file_info *info)
+{
+    int index = 1;
+    int file_size_sent = 0; // FILE_SIZE or FILE_SIZE_64 seen
+    memset(info, 0, sizeof(struct file_info));
+    info->codec = CODEC_NONE; // Raw data packets unless advertised
+
+    // Extract file size and filename from the control packet
+    while (index < size)
+    {
+        if (index + 2 > size || index + 2 + control_packet[index + 1] > size)
+        {
+            printf("Malformed control packet of %d bytes.\n", size);
+            return -1; // Field runs past the end of the packet
+        }
+        unsigned char type = control_packet[index++];
+        unsigned char length = control_packet[index++];
+        if (type == FILE_SIZE || type == FILE_SIZE_64)
+        {
+            long long file_size = decode_file_size(&control_packet[index], length); // Get file size
+            index += length;
+
+            if (file_size_sent && file_size != info->file_size)
+            {
+                printf("Conflicting file sizes: %lld and %lld.\n", info->file_size, file_size);
+                return -1;
+            }
+            info->file_size = file_size;
+            file_size_sent = 1;
+        }
+        else if (type == FILE_NAME)
+        {
+            memcpy(info->name, &control_packet[index], length); // Get filename
+            info->name[length] = '\0';                          // Null-terminate the string
+            index += length;
+        }
+        else if (type == CODEC && length == 1)
+        {
+            info->codec = control_packet[index]; // Get codec
+            index += length;
+        }
+        else if (type == FILE_TAG && length == 4)
+        {
+            info->tag = get_le(&control_packet[index], length); // Get file tag
+            index += length;
+        }
+        else if (type == RESUME_OFFSET && length == 8)
+        {
+            info->resume_offset = decode_file_size(&control_packet[index], length); // Get first byte sent
+            index += length;
+        }
+        else if (type == NEXT_FILE && length == 1)
+        {
+            info->next_file = control_packet[index] != 0; // Another file follows
+            index += length;
+        }
+        else if (type == BLOCK_SIZE && length == 4)
+        {
+            info->block_size = get_le(&control_packet[index], length) & INT_MAX; // Get signature block size
+            index += length;
+        }
+        else
+        {
+            index += length; // Skip unknown fields
+        }
+    }
+
+    if (info->codec != CODEC_NONE && info->codec != CODEC_LZ)
+    {
+        printf("Unsupported codec: %d\n", info->codec);
+        return -1;
+    }
+    if (info->file_size < 0 || info->resume_offset < 0 || info->resume_offset > info->file_size)
+    {
+        printf("Invalid file size.\n");
+        return -1;
+    }
+    return 1; // Successfully read control packet
+}
+
+// Value of a FILE_SIZE or FILE_SIZE_64 field, least significant byte first.
+// Returns -1 if it does not fit in 63 bits.
+long long decode_file_size(const unsigned char *value, int length)
+{
+    unsigned long long size = 0;
+    for (int i = length - 1; i >= 0; i--)
+    {
+        if (size >> 55 != 0)
+            return -1; // Would overflow
+        size = size << 8 | value[i];
+    }
+    return size > LLONG_MAX ? -1 : (long long)size;
+}
+
+// Check the end packet for consistency with the start packet
+int check_end_packet(unsigned char *control_packet, int data_size, const unsigned char *filename, long long file_size)
+{
+    int index = 1; // Start from first data after control byte
+
+    long long received_file_size = 0; // To store received file size
+    unsigned char received_filename[MAX_PAYLOAD_SIZE];
+
+    int end_filename_sent = 0; // Flag to check if end filename was sent
+
+    // Extract file size and filename from the control packet
+    while (index < data_size)
+    {
+        if (index + 2 > data_size || index + 2 + control_packet[index + 1] > data_size)
+        {
+            return -1; // Field runs past the end of the packet
+        }
+        unsigned char type = control_packet[index++];
+        unsigned char length = control_packet[index++];
+        if (type == FILE_SIZE || type == FILE_SIZE_64)
+        {
+            received_file_size = decode_file_size(&control_packet[index], length); // Get received file size
+            index += length;
+
+            if (received_file_size != file_size)
+            {
+                return -1; // File size mismatch
+            }
+        }
+        else if (type == FILE_NAME)
+        {
+            memcpy(received_filename, &control_packet[index], length); // Get received filename
+            received_filename[length] = '\0';                          // Null-terminate
+            index += length;
+            end_filename_sent = 1; // Mark filename sent
+
+            if (strcmp((const char *)received_filename, (const char *)filename) != 0)
+            {
+                return -1; // Filename mismatch
+            }
+        }
+        else
+        {
+            index += length; // Skip unknown fields
+        }
+    }
+
+    return (strlen((const char *)filename) > 0 && end_filename_sent) ? 1 : -1;
+}
+
+// Check the FILE_CHECKSUM of an END packet against the file received. Files
+// from transmitters that send none, or that could not be read back, are not
+// checked.
+// Returns -1 if the file is damaged, 1 otherwise.
+int check_file_checksum(const unsigned char *control_packet, int data_size, const struct file_checksum *checksum)
+{
+    int index = 1; // Start from first data after control byte
+
+    while (index + 1 < data_size)
+    {
+        unsigned char type = control_packet[index++];
+        unsigned char length = control_packet[index++];
+        if (type == FILE_CHECKSUM && length == 4 && index + length <= data_size)
+        {
+            uint32_t expected = get_le(&control_packet[index], length);
+            if (checksum->offset < 0)
+            {
+                if (AL_CHECKSUM)
+                    printf("File checksum not verified: the file could not be read back.\n");
+                return 1;
+            }
+            if (checksum->value != expected)
+            {
+                printf("File checksum mismatch: %08x instead of %08x.\n", checksum->value, expected);
+                return -1;
+            }
+            printf("File checksum verified (CRC-32C %08x).\n", expected);
+            return 1;
+        }
+        index += length; // Skip other fields
+    }
+    return 1; // No checksum sent
+}
+
+// Size of the header of a data packet of the given type, 0 if the type is
+// not a data packet
+int data_header_size(int type)
+{
+    if (type == DATA || type == DATA_LZ)
+        return DATA_HEADER_SIZE;
+    if (type == DATA_OFFSET || type == DATA_LZ_OFFSET)
+        return OFFSET_HEADER_SIZE;
+    if (type == DATA_OFFSET64 || type == DATA_LZ_OFFSET64)
+        return OFFSET64_HEADER_SIZE;
+    return 0;
+}
+
+// Largest header of the data packets of a file: files past 4 GiB need 64-bit
+// offsets for their last blocks
+int offset_header_size(long long file_size)
+{
+    return file_size - 1 > MAX_OFFSET32 ? OFFSET64_HEADER_SIZE : OFFSET_HEADER_SIZE;
+}
+
+// Fill the header of the data packet of a block at the given offset: DATA_OFFSET
+// or DATA_LZ_OFFSET, or their 64-bit forms past 4 GiB. The header has room for
+// OFFSET64_HEADER_SIZE bytes.
+// Returns the size of the header.
+int build_offset_header(unsigned char *header, int compressed, long long offset, int data_size)
+{
+    int offset_size = offset > MAX_OFFSET32 ? 8 : 4;
+    if (offset_size == 8)
+        header[0] = compressed ? DATA_LZ_OFFSET64 : DATA_OFFSET64; // Packet type
+    else
+        header[0] = compressed ? DATA_LZ_OFFSET : DATA_OFFSET;
+
+    for (int i = 0; i < offset_size; i++)
+        header[1 + i] = (unsigned char)(offset >> (8 * (offset_size - 1 - i))); // Offset, most significant byte first
+
+    header[1 + offset_size] = (unsigned char)(data_size / 256); // K = 256 * L2 + L1: high byte
+    header[2 + offset_size] = (unsigned char)(data_size % 256); // Low byte
+    return 3 + offset_size;
+}
+
+// Write the data of a data packet to the file at its offset: the one carried
+// by DATA_OFFSET packets (of either width), or *offset for DATA and DATA_LZ
+// packets. Compressed data is decompressed into block (block_size bytes).
+// Data that would not fit in the file_size bytes announced is refused, as
+// a damaged offset would grow the file or overwrite another block.
+// The data written is added to checksum, if not NULL.
+// Returns the number of file bytes written, with their offset in *offset,
+// or -1 on error.
+int write_data_packet(int fd, const unsigned char *packet, int size, unsigned char *block, int block_size,
+                      long long file_size, long long *offset, struct file_checksum *checksum)
+{
+    int header_size = size > 0 ? data_header_size(packet[0]) : 0;
+    if (header_size == 0 || size < header_size)
+    {
+        // If link_layer is correct, this will never happen
+        printf("Malformed data packet of %d bytes.\n", size);
+        return -1;
+    }
+
+    if (header_size > DATA_HEADER_SIZE)
+    {
+        unsigned long long value = 0;
+        for (int i = 1; i < header_size - 2; i++)
+            value = value << 8 | packet[i]; // Most significant byte first
+        *offset = value > LLONG_MAX ? -1 : (long long)value;
+    }
+
+    // K = 256 * L2 + L1, the last two bytes of the header
+    int data_size = 256 * (int)packet[header_size - 2] + (int)packet[header_size - 1];
+    if (data_size + header_size != size || *offset < 0)
+    {
+        // If link_layer is correct, this will never happen
+        printf("Malformed data packet of %d bytes.\n", size);
+        return -1;
+    }
+
+    const unsigned char *data = &packet[header_size];
+    if (packet[0] == DATA_LZ || packet[0] == DATA_LZ_OFFSET || packet[0] == DATA_LZ_OFFSET64)
+    {
+        // Blocks are never larger than the data of a packet
+        data_size = lz_decompress(data, data_size, block, block_size);
+        if (data_size < 0)
+        {
+            printf("Failed to decompress the block at offset %lld.\n", *offset);
+            return -1;
+        }
+        data = block;
+    }
+
+    if (*offset > file_size - data_size)
+    {
+        printf("Data packet of %d bytes at offset %lld is past the end of the file.\n", data_size, *offset);
+        return -1;
+    }
+    if (pwrite(fd, data, data_size, *offset) != data_size)
+    {
+        printf("Failed to write %d bytes at offset %lld.\n", data_size, *offset);
+        return -1;
+    }
+    if (checksum != NULL)
+        file_checksum_update(checksum, data, data_size, *offset);
+    return data_size;
+}
+
+// Write value into length bytes, least significant byte first
+void put_le(unsigned char *bytes, unsigned long long value, int length)
+{
+    for (int i = 0; i < length; i++)
+        bytes[i] = (unsigned char)(value >> (8 * i));
+}
+
+// Read a value of length bytes, least significant byte first
+unsigned long long get_le(const unsigned char *bytes, int length)
+{
+    unsigned long long value = 0;
+    for (int i = length - 1; i >= 0; i--)
+        value = value << 8 | bytes[i];
+    return value;
+}
+
+// Write value into length bytes, most significant byte first (packet headers)
+void put_be(unsigned char *bytes, unsigned long long value, int length)
+{
+    for (int i = 0; i < length; i++)
+        bytes[i] = (unsigned char)(value >> (8 * (length - 1 - i)));
+}
+
+// Read a value of length bytes, most significant byte first
+unsigned long long get_be(const unsigned char *bytes, int length)
+{
+    unsigned long long value = 0;
+    for (int i = 0; i < length; i++)
+        value = value << 8 | bytes[i];
+    return value;
+}
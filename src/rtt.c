@@ -0,0 +1,67 @@
+#include "rtt.h"
+
+#define RTT_ALPHA 0.125 // Gain of the smoothed round trip time
+#define RTT_BETA 0.25   // Gain of the round trip time variation
+#define RTT_K 4         // Weight of the variation in the timeout
+
+// Helper Functions prototypes
+int rtt_clamp(const struct rtt_estimator *rtt, double rto);
+
+// Clamp the timeout to the configured bounds
+int rtt_clamp(const struct rtt_estimator *rtt, double rto)
+{
+    if (rto < rtt->min_rto)
+        return rtt->min_rto;
+    if (rto > rtt->max_rto)
+        return rtt->max_rto;
+    return (int)rto;
+}
+
+// Initialize the estimator; the timeout starts at its upper bound
+void rtt_init(struct rtt_estimator *rtt, int min_rto, int max_rto)
+{
+    rtt->srtt = 0;
+    rtt->rttvar = 0;
+    rtt->min_rto = min_rto < max_rto ? min_rto : max_rto;
+    rtt->max_rto = max_rto;
+    rtt->rto = max_rto;
+    rtt->samples = 0;
+}
+
+// Add a round trip time measured on a frame that was sent only once (Karn's rule)
+void rtt_sample(struct rtt_estimator *rtt, int sample)
+{
+    if (rtt->samples == 0)
+    {
+        rtt->srtt = sample;
+        rtt->rttvar = sample / 2.0;
+    }
+    else
+    {
+        double error = rtt->srtt - sample;
+        if (error < 0)
+            error = -error;
+        rtt->rttvar = (1 - RTT_BETA) * rtt->rttvar + RTT_BETA * error;
+        rtt->srtt = (1 - RTT_ALPHA) * rtt->srtt + RTT_ALPHA * sample;
+    }
+    rtt->samples++;
+
+    rtt->rto = rtt_clamp(rtt, rtt->srtt + RTT_K * rtt->rttvar);
+}
+
+// Timeout for a frame that takes transmission_ms to go out at the baud rate
+int rtt_timeout(const struct rtt_estimator *rtt, int transmission_ms)
+{
+    if (rtt->samples == 0 || rtt->rto >= transmission_ms + rtt->srtt)
+        return rtt->rto; // No estimate yet (upper bound), or already long enough
+    return rtt_clamp(rtt, transmission_ms + rtt->srtt);
+}
+
+// Double the timeout after a retransmission timeout (exponential backoff)
+// Returns 1 if the timeout that expired had already reached its upper bound
+int rtt_backoff(struct rtt_estimator *rtt)
+{
+    int full_timeout = rtt->rto >= rtt->max_rto;
+    rtt->rto = rtt_clamp(rtt, rtt->rto * 2.0);
+    return full_timeout;
+}
@@ -0,0 +1,79 @@
+// Buffered receive path.
+// Reading the serial port one byte per read() costs a system call per byte;
+// here each read() drains everything the driver has queued.
+
+#include "rx_buffer.h"
+#include "serial_wait.h"
+#include "link_handle.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+// Read every byte available on the serial port (as many as fit) with a single
+// read(), sleeping first until data arrives or the timer expires.
+// A NULL or stopped timer waits with no time limit.
+// Returns -1 on error, 0 on timeout, otherwise the number of bytes read.
+int rx_buffer_fill(const struct timer *timer)
+{
+    struct rx_buffer *buffer = &current_link->rx_buffer;
+
+    if (buffer->size == LL_RX_BUFFER_SIZE)
+        return 0; // Full: process the buffered bytes first
+
+    if (buffer->size == 0)
+        buffer->start = 0; // Empty: read into the whole buffer at once
+
+    // Free space runs from the end of the data up to the end of the array or the start of the data
+    size_t end = (buffer->start + buffer->size) % LL_RX_BUFFER_SIZE;
+    size_t free_space = (end >= buffer->start) ? LL_RX_BUFFER_SIZE - end : buffer->start - end;
+
+    int ready = waitSerialPort(timer); // Sleep until bytes arrive
+    if (ready <= 0)
+        return ready;
+
+    int bytes_read = read(current_link->fd, buffer->data + end, free_space);
+    if (bytes_read < 0)
+    {
+        perror("read");
+        return -1;
+    }
+
+    buffer->size += bytes_read;
+    return bytes_read;
+}
+
+// Run the state machine over the received bytes until it completes a frame,
+// reading more from the serial port whenever the buffer runs dry.
+// Returns -1 on error, 0 if the timer expired first, 1 when the machine reaches STP.
+int rx_buffer_receive_frame(struct state_machine *machine, const struct timer *timer)
+{
+    struct rx_buffer *buffer = &current_link->rx_buffer;
+    int filled = 0; // Already read from the serial port in this call
+
+    while (machine->state != STP)
+    {
+        if (buffer->size == 0)
+        {
+            // Give up at the deadline even if bytes that never form a frame keep arriving
+            if (filled && timer != NULL && timer_expired(timer))
+                return 0;
+
+            filled = 1;
+            int bytes_read = rx_buffer_fill(timer);
+            if (bytes_read <= 0)
+                return bytes_read; // Error or timeout
+            continue;
+        }
+
+        // Feed the contiguous part of the buffered bytes
+        size_t span = buffer->size;
+        if (buffer->start + span > LL_RX_BUFFER_SIZE)
+            span = LL_RX_BUFFER_SIZE - buffer->start;
+
+        size_t consumed = state_machine_feed(machine, buffer->data + buffer->start, span);
+        buffer->start = (buffer->start + consumed) % LL_RX_BUFFER_SIZE;
+        buffer->size -= consumed;
+    }
+
+    return 1;
+}
@@ -0,0 +1,32 @@
+// Blocking waits on the serial port.
+// The port is opened with VMIN = 0 and VTIME = 0, so read() returns at once
+// when no byte is available; poll() puts the process to sleep instead.
+
+#include "serial_wait.h"
+#include "link_handle.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+
+// Block until the serial port of the current link has data to read or the timer expires.
+// A NULL or stopped timer waits with no time limit.
+// Returns -1 on error, 0 on timeout, 1 if data is available.
+int waitSerialPort(const struct timer *timer)
+{
+    struct pollfd pfd;
+    pfd.fd = current_link->fd;
+    pfd.events = POLLIN;
+
+    int timeout = (timer == NULL) ? -1 : timer_remaining_ms(timer);
+
+    int ready = poll(&pfd, 1, timeout);
+    if (ready < 0)
+    {
+        if (errno == EINTR)
+            return 0; // Interrupted by a signal: let the caller check its timer
+        perror("poll");
+        return -1;
+    }
+    return ready > 0;
+}
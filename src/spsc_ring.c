@@ -0,0 +1,126 @@
+#include "spsc_ring.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SPSC_RING_SPINS 64 // Checks before going to sleep
+
+// Helper Functions prototypes
+int spsc_ring_full(struct spsc_ring *ring);
+int spsc_ring_empty(struct spsc_ring *ring);
+void spsc_ring_wait(struct spsc_ring *ring, int (*must_wait)(struct spsc_ring *ring));
+void spsc_ring_wake(struct spsc_ring *ring);
+
+// Allocate a ring for at least capacity items.
+// Returns 1 on success, -1 on failure.
+int spsc_ring_init(struct spsc_ring *ring, unsigned capacity)
+{
+    ring->capacity = 1;
+    while (ring->capacity < capacity)
+        ring->capacity *= 2; // Counters wrap around at a multiple of the capacity
+
+    ring->items = malloc(ring->capacity * sizeof(void *));
+    if (ring->items == NULL)
+    {
+        printf("Failed to allocate ring.\n");
+        return -1;
+    }
+
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->closed, 0);
+    atomic_init(&ring->waiters, 0);
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->changed, NULL);
+    return 1;
+}
+
+// Release the ring
+void spsc_ring_destroy(struct spsc_ring *ring)
+{
+    free(ring->items);
+    ring->items = NULL;
+    pthread_mutex_destroy(&ring->lock);
+    pthread_cond_destroy(&ring->changed);
+}
+
+// Add an item, waiting while the ring is full.
+// Returns 1 on success, -1 if the ring was closed.
+int spsc_ring_push(struct spsc_ring *ring, void *item)
+{
+    spsc_ring_wait(ring, spsc_ring_full);
+    if (atomic_load(&ring->closed))
+        return -1;
+
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed); // Only written by this thread
+    ring->items[tail & (ring->capacity - 1)] = item;
+    atomic_store(&ring->tail, tail + 1); // Publishes the item
+    spsc_ring_wake(ring);
+    return 1;
+}
+
+// Take the oldest item, waiting while the ring is empty.
+// Returns NULL once the ring is closed and empty.
+void *spsc_ring_pop(struct spsc_ring *ring)
+{
+    spsc_ring_wait(ring, spsc_ring_empty);
+
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed); // Only written by this thread
+    if (head == atomic_load(&ring->tail))
+        return NULL; // Closed and empty
+
+    void *item = ring->items[head & (ring->capacity - 1)];
+    atomic_store(&ring->head, head + 1); // Gives the slot back
+    spsc_ring_wake(ring);
+    return item;
+}
+
+// Close the ring: the producer ends the stream (the consumer still gets the
+// items already pushed), or the consumer stops taking items (pushes fail)
+void spsc_ring_close(struct spsc_ring *ring)
+{
+    atomic_store(&ring->closed, 1);
+    pthread_mutex_lock(&ring->lock);
+    pthread_cond_broadcast(&ring->changed);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+// Producer must wait: the ring is full and open
+int spsc_ring_full(struct spsc_ring *ring)
+{
+    return !atomic_load(&ring->closed) && atomic_load(&ring->tail) - atomic_load(&ring->head) == ring->capacity;
+}
+
+// Consumer must wait: the ring is empty and open
+int spsc_ring_empty(struct spsc_ring *ring)
+{
+    return !atomic_load(&ring->closed) && atomic_load(&ring->tail) == atomic_load(&ring->head);
+}
+
+// Wait while must_wait(ring) holds: spin for a while, then sleep
+void spsc_ring_wait(struct spsc_ring *ring, int (*must_wait)(struct spsc_ring *ring))
+{
+    for (int i = 0; i < SPSC_RING_SPINS; i++)
+    {
+        if (!must_wait(ring))
+            return;
+    }
+
+    pthread_mutex_lock(&ring->lock);
+    atomic_fetch_add(&ring->waiters, 1); // Seen by the other side after its next push or pop
+    while (must_wait(ring))
+        pthread_cond_wait(&ring->changed, &ring->lock);
+    atomic_fetch_sub(&ring->waiters, 1);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+// Wake the other side if it sleeps. Its waiters count is set before it checks
+// the counters for the last time, so either it sees this change or this sees it.
+void spsc_ring_wake(struct spsc_ring *ring)
+{
+    if (atomic_load(&ring->waiters) == 0)
+        return;
+
+    pthread_mutex_lock(&ring->lock);
+    pthread_cond_broadcast(&ring->changed);
+    pthread_mutex_unlock(&ring->lock);
+}
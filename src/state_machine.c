@@ -1,26 +1,18 @@
 #include "state_machine.h"
+#include "link_handle.h"
+#include "byte_scan.h"
+#include "frame_check.h"
+#include "fec.h"
+#include "whitening.h"
+#include "cobs.h"
 #include <stdio.h>
 #include <string.h>
 
-// Structure to hold statistics for various control frames and events
-struct ll_statistics statistics = {
-    .num_SET_sent = 0,
-    .num_SET_received = 0,
-    .num_UA_sent = 0,
-    .num_UA_received = 0,
-    .num_RR_sent = 0,
-    .num_RR_received = 0,
-    .num_REJ_sent = 0,
-    .num_REJ_received = 0,
-    .num_I_frames_sent = 0,
-    .num_I_frames_received = 0,
-    .num_DISC_sent = 0,
-    .num_DISC_received = 0,
-    .num_duplicated_frames = 0,
-    .num_retransmissions = 0,
-    .num_timeouts = 0,
-    .num_invalid_BCC1_received = 0,
-    .num_invalid_BCC2_received = 0};
+// Copy of the statistics of the current link, for the application layer
+struct ll_statistics ll_get_statistics()
+{
+    return current_link->statistics;
+}
 
 // Function to initialize a state machine with given parameters
 void create_state_machine(struct state_machine *machine, enum state_machine_type type, unsigned char control_byte, unsigned char address_byte, enum state_machine_state state)
@@ -29,12 +21,23 @@ void create_state_machine(struct state_machine *machine, enum state_machine_type
     machine->control_byte = control_byte;          // Set the control byte
     machine->address_byte = address_byte;          // Set the address byte
     machine->state = state;                        // Initialize state
-    memset(machine->buf, 0, sizeof(machine->buf)); // Clear the buffer
+    machine->buf = NULL;                           // No buffer until one is given
+    machine->buf_capacity = 0;                     // Size of the buffer
     machine->REJ = 0;                              // Initialize REJ flag
+    machine->SREJ = 0;                             // Initialize SREJ flag
     machine->ACK = 0;                              // Initialize ACK flag
     machine->buf_size = 0;                         // Initialize buffer size
     machine->escape_sequence = 0;                  // Initialize escape sequence flag
     machine->duplicate = 0;                        // Initialize duplicate flag
+    machine->sequence_number = 0;                  // Initialize sequence number
+}
+
+// Give the state machine a buffer for the data (or link parameters) of the frames it parses
+void state_machine_use_buffer(struct state_machine *machine, unsigned char *buf, int capacity)
+{
+    machine->buf = buf;
+    machine->buf_capacity = capacity;
+    machine->buf_size = 0;
 }
 
 // Main function for the state machine processing a byte
@@ -48,6 +51,7 @@ void state_machine(struct state_machine *machine, unsigned char byte)
 
     case FLAG_RCV:
         machine->REJ = 0;                      // Reset REJ flag
+        machine->SREJ = 0;                     // Reset SREJ flag
         machine->ACK = 0;                      // Reset ACK flag
         machine->BCC2 = 0;                     // Reset BCC2 for new frame
         machine->duplicate = 0;                // Reset duplicate flag
@@ -58,6 +62,10 @@ void state_machine(struct state_machine *machine, unsigned char byte)
         state_machine_A_RCV(machine, byte); // Handle A_RCV state
         break;
 
+    case C_EXT_RCV:
+        state_machine_C_EXT_RCV(machine, byte); // Handle C_EXT_RCV state
+        break;
+
     case C_RCV:
         state_machine_C_RCV(machine, byte); // Handle C_RCV state
         break;
@@ -71,6 +79,31 @@ void state_machine(struct state_machine *machine, unsigned char byte)
     }
 }
 
+// Process a span of bytes, stopping right after the byte that completes a frame
+// (state STP) so the remaining bytes can be fed for the next frame.
+// Returns the number of bytes consumed.
+size_t state_machine_feed(struct state_machine *machine, const unsigned char *buf, size_t len)
+{
+    size_t consumed = 0;
+
+    while (consumed < len && machine->state != STP)
+    {
+        // Payload outside an escape sequence: take the whole clean run at once
+        if (machine->state == BCC1_OK && machine->type == READ && !machine->ACK && !machine->escape_sequence)
+        {
+            size_t run = process_read_BCC1_OK_span(machine, buf + consumed, len - consumed);
+            consumed += run;
+            if (run > 0)
+                continue;
+        }
+
+        state_machine(machine, buf[consumed]); // Process the next byte (FLAG, ESC or any other state)
+        consumed++;
+    }
+
+    return consumed;
+}
+
 // Handle the START state, checking for the FLAG byte
 void state_machine_START(struct state_machine *machine, unsigned char byte)
 {
@@ -99,8 +132,20 @@ void state_machine_A_RCV(struct state_machine *machine, unsigned char byte)
 {
     if (byte == machine->control_byte)
     {
-        machine->state = C_RCV; // Move to C_RCV state
-        machine->BCC1 ^= byte;  // Update BCC1 with control byte
+        machine->state = IS_EXTENDED_CONTROL(byte) ? C_EXT_RCV : C_RCV; // Move to C_EXT_RCV or C_RCV state
+        machine->BCC1 ^= byte;                                         // Update BCC1 with control byte
+    }
+    else if (machine->type == WRITE && machine->control_byte == RR_N && byte == REJ_N)
+    {
+        machine->state = C_EXT_RCV; // Move to C_EXT_RCV for REJ
+        machine->REJ = 1;           // REJ received
+        machine->BCC1 ^= byte;      // Update BCC1
+    }
+    else if (machine->type == WRITE && machine->control_byte == RR_N && byte == SREJ_N)
+    {
+        machine->state = C_EXT_RCV; // Move to C_EXT_RCV for SREJ
+        machine->SREJ = 1;          // SREJ received
+        machine->BCC1 ^= byte;      // Update BCC1
     }
     else if (machine->type == WRITE &&
              ((machine->control_byte == RR0 && byte == REJ1) ||
@@ -134,13 +179,33 @@ void state_machine_A_RCV(struct state_machine *machine, unsigned char byte)
     }
 }
 
+// Handle the C_EXT_RCV state, reading the sequence number of an extended frame
+void state_machine_C_EXT_RCV(struct state_machine *machine, unsigned char byte)
+{
+    if (byte < LL_SEQUENCE_MODULUS)
+    {
+        machine->state = C_RCV;          // Move to C_RCV state
+        machine->sequence_number = byte; // Store sequence number
+        machine->BCC1 ^= byte;           // Update BCC1 with sequence number
+    }
+    else if (byte == FLAG)
+    {
+        machine->state = FLAG_RCV; // Return to FLAG_RCV state
+    }
+    else
+    {
+        machine->state = START; // Invalid byte; reset to START
+    }
+}
+
 // Handle the C_RCV state, checking for the BCC1 byte
 void state_machine_C_RCV(struct state_machine *machine, unsigned char byte)
 {
     if (byte == machine->BCC1)
     {
-        machine->buf_size = 0;    // Reset buffer size
-        machine->state = BCC1_OK; // Move to BCC1_OK state
+        machine->buf_size = 0;        // Reset buffer size
+        machine->escape_sequence = 0; // No escape sequence in progress
+        machine->state = BCC1_OK;     // Move to BCC1_OK state
     }
     else if (byte == FLAG)
     {
@@ -148,8 +213,8 @@ void state_machine_C_RCV(struct state_machine *machine, unsigned char byte)
     }
     else
     {
-        statistics.num_invalid_BCC1_received++; // Increment invalid BCC1 count
-        machine->state = START;                 // Invalid byte; reset to START
+        current_link->statistics.num_invalid_BCC1_received++; // Increment invalid BCC1 count
+        machine->state = START;                               // Invalid byte; reset to START
     }
 }
 
@@ -164,41 +229,136 @@ void state_machine_BCC1_OK(struct state_machine *machine, unsigned char byte)
     {
         machine->state = STP; // Move to STP on FLAG
     }
+    else if (machine->type == CONNECTION || machine->ACK)
+    {
+        process_information_BCC1_OK(machine, byte); // Link parameters sent with SET/UA
+    }
     else
     {
         machine->state = START; // Invalid byte; reset to START
     }
 }
 
+// Store a byte of the information field of a SET or UA frame (link parameters,
+// which carry their own CRC)
+void process_information_BCC1_OK(struct state_machine *machine, unsigned char byte)
+{
+    if (machine->escape_sequence) // If escape sequence was initiated
+    {
+        machine->escape_sequence = 0; // Reset escape sequence
+        if (byte != ESC_FLAG && byte != ESC_ESC)
+        {
+            machine->state = START; // Invalid escape; reset to START
+            return;
+        }
+        byte = (byte == ESC_FLAG) ? FLAG : ESC; // Map escaped byte
+    }
+    else if (byte == ESC)
+    {
+        machine->escape_sequence = 1; // Set escape sequence flag
+        return;                       // Wait for the next byte
+    }
+
+    if (machine->buf_size < machine->buf_capacity)
+    {
+        machine->buf[machine->buf_size++] = byte; // Add byte to buffer
+    }
+    else
+    {
+        machine->state = START; // Buffer overflow; reset to START
+    }
+}
+
 // Process data in the BCC1_OK state for READ state machine type
 void process_read_BCC1_OK(struct state_machine *machine, unsigned char byte)
 {
     if (byte == FLAG)
     {
-        machine->buf_size--;                              // Remove BCC2 byte from buffer
-        machine->BCC2 ^= machine->buf[machine->buf_size]; // Update BCC2
+        int check_type = ll_frame_check();
+        int check_size = frame_check_size(check_type);
+        int repaired = 0;
+
+        // Undo COBS, then repair the data and check sequence; BCC2 computed
+        // on the fly only applies to plain HDLC frames, otherwise the check
+        // is recomputed below
+        int bcc2_on_the_fly = ll_framing() == LL_FRAMING_HDLC && ll_fec_parity() == 0;
+
+        if (ll_framing() == LL_FRAMING_COBS && machine->buf_size >= 0)
+        {
+            int size = cobs_decode(machine->buf, machine->buf_size);
+            machine->buf_size = size < 0 ? -1 : size; // Malformed frames fail the check
+        }
+
+        if (ll_fec_parity() > 0 && machine->buf_size >= 0)
+        {
+            int size = fec_decode(machine->buf, machine->buf_size, ll_fec_parity(), &repaired);
+            machine->buf_size = size < 0 ? -1 : size; // Unrepairable blocks fail the check
+        }
+
+        int valid = machine->buf_size >= check_size; // Too short to hold the check sequence otherwise
+
+        if (valid)
+        {
+            machine->buf_size -= check_size; // Remove the check bytes from the buffer
+
+            if (check_type == LL_CHECK_BCC2 && bcc2_on_the_fly)
+            {
+                machine->BCC2 ^= machine->buf[machine->buf_size];         // Update BCC2
+                valid = machine->buf[machine->buf_size] == machine->BCC2; // Check if the received BCC2 matches the expected BCC2
+            }
+            else
+            {
+                valid = frame_check_verify(check_type, machine->buf, machine->buf_size, machine->buf + machine->buf_size);
+            }
+        }
 
-        // Check if the received BCC2 matches the expected BCC2
-        if (machine->buf[machine->buf_size] == machine->BCC2)
+        if (valid && ll_whitening())
+        {
+            // Undo the whitening: the first byte is the mask
+            valid = machine->buf_size >= 1;
+            if (valid)
+            {
+                whitening_apply(machine->buf, machine->buf + 1, machine->buf_size - 1, machine->buf[0]);
+                machine->buf_size--;
+            }
+        }
+
+        if (valid)
         {
             machine->state = STP; // Valid frame; move to STP state
+            if (repaired > 0)
+            {
+                current_link->statistics.num_FEC_repaired_frames++;
+                current_link->statistics.num_FEC_repaired_bytes += repaired;
+            }
         }
         else
         {
-            statistics.num_invalid_BCC2_received++; // Increment invalid BCC2 count
-            machine->state = STP;                   // Invalid BCC2; move to STP
-            machine->REJ = 1;                       // Set REJ to indicate error
+            // The header passed BCC1, so the rejection applies to this frame's sequence number only
+            current_link->statistics.num_invalid_BCC2_received++; // Increment invalid BCC2 (or CRC) count
+            machine->state = STP;                                 // Invalid BCC2; move to STP
+            machine->REJ = 1;                                     // Set REJ to indicate error
         }
     }
-    else if (machine->buf_size >= 0 && machine->buf_size < sizeof(machine->buf))
+    else if (machine->buf_size >= 0 && machine->buf_size < machine->buf_capacity)
     {
+        if (ll_framing() == LL_FRAMING_COBS)
+        {
+            machine->buf[machine->buf_size++] = byte; // Decoded at the closing FLAG
+            return;
+        }
+
         // Handle byte destuffing
         if (machine->escape_sequence) // If escape sequence was initiated
         {
             machine->escape_sequence = 0; // Reset escape sequence
             byte = (byte == ESC_FLAG) ? FLAG : (byte == ESC_ESC) ? ESC
                                                                  : 0; // Map escaped byte
-            if (!byte)
+            if (!byte && ll_fec_parity() > 0)
+            {
+                byte = FLAG; // Damaged escape: keep the byte count so FEC can repair the value
+            }
+            else if (!byte)
             {
                 machine->REJ = 1; // Invalid escape; set REJ
                 return;           // Exit processing
@@ -218,4 +378,28 @@ void process_read_BCC1_OK(struct state_machine *machine, unsigned char byte)
     {
         machine->state = START; // Buffer overflow; reset to START
     }
-}
\ No newline at end of file
+}
+
+// Fast path of process_read_BCC1_OK: copy the bytes before the next FLAG or ESC
+// straight into the buffer, updating BCC2 in the same pass.
+// Returns the number of bytes consumed (0 if the span starts with FLAG or ESC).
+size_t process_read_BCC1_OK_span(struct state_machine *machine, const unsigned char *buf, size_t len)
+{
+    size_t space = machine->buf_capacity - machine->buf_size;
+    if (len > space)
+        len = space; // The byte that overflows goes through the byte by byte path
+
+    if (ll_framing() == LL_FRAMING_COBS)
+    {
+        // Only FLAG is special: copy everything before it
+        const unsigned char *flag = memchr(buf, FLAG, len);
+        size_t run = flag ? (size_t)(flag - buf) : len;
+        memcpy(machine->buf + machine->buf_size, buf, run);
+        machine->buf_size += run;
+        return run;
+    }
+
+    size_t run = copy_clean_run(buf, len, machine->buf + machine->buf_size, &machine->BCC2);
+    machine->buf_size += run;
+    return run;
+}
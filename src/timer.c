@@ -0,0 +1,66 @@
+#include "timer.h"
+
+#define NSEC_PER_SEC 1000000000L
+#define NSEC_PER_MSEC 1000000L
+
+// Start (or restart) the timer to expire the given number of milliseconds from now
+void timer_start(struct timer *timer, int milliseconds)
+{
+    timer_now(&timer->deadline);
+    timer->deadline.tv_sec += milliseconds / 1000;
+    timer->deadline.tv_nsec += (milliseconds % 1000) * NSEC_PER_MSEC;
+    if (timer->deadline.tv_nsec >= NSEC_PER_SEC)
+    {
+        timer->deadline.tv_sec++;
+        timer->deadline.tv_nsec -= NSEC_PER_SEC;
+    }
+    timer->running = 1;
+}
+
+// Stop the timer; a stopped timer never expires
+void timer_stop(struct timer *timer)
+{
+    timer->running = 0;
+}
+
+// Returns 1 if the timer is running and its deadline has passed, 0 otherwise
+int timer_expired(const struct timer *timer)
+{
+    if (!timer->running)
+        return 0;
+
+    struct timespec now;
+    timer_now(&now);
+    return now.tv_sec > timer->deadline.tv_sec ||
+           (now.tv_sec == timer->deadline.tv_sec && now.tv_nsec >= timer->deadline.tv_nsec);
+}
+
+// Milliseconds left until the timer expires, rounded up (0 if already expired).
+// Returns -1 if the timer is not running.
+int timer_remaining_ms(const struct timer *timer)
+{
+    if (!timer->running)
+        return -1;
+
+    struct timespec now;
+    timer_now(&now);
+    long long remaining = (long long)(timer->deadline.tv_sec - now.tv_sec) * NSEC_PER_SEC +
+                          (timer->deadline.tv_nsec - now.tv_nsec);
+    if (remaining <= 0)
+        return 0;
+    return (remaining + NSEC_PER_MSEC - 1) / NSEC_PER_MSEC; // Never wake up before the deadline
+}
+
+// Read the monotonic clock
+void timer_now(struct timespec *now)
+{
+    clock_gettime(CLOCK_MONOTONIC, now);
+}
+
+// Milliseconds elapsed since "since" (read with timer_now)
+int elapsed_ms(const struct timespec *since)
+{
+    struct timespec now;
+    timer_now(&now);
+    return (now.tv_sec - since->tv_sec) * 1000 + (now.tv_nsec - since->tv_nsec) / NSEC_PER_MSEC;
+}
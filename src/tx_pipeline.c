@@ -0,0 +1,202 @@
+#include "tx_pipeline.h"
+#include "packet.h"
+#include "file_io.h"
+#include "file_checksum.h"
+#include "frame_check.h"
+#include "link_config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Helper Functions prototypes
+int compression_threads();
+void *tx_pipeline_reader(void *arg);
+void *tx_pipeline_framer(void *arg);
+
+// Number of compression threads
+int compression_threads()
+{
+    if (AL_COMPRESSION_THREADS > 0)
+        return AL_COMPRESSION_THREADS;
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1)
+        return 1;
+    return cpus < COMPRESS_MAX_THREADS ? cpus : COMPRESS_MAX_THREADS;
+}
+
+// Allocate the buffers of the pipeline and start the reader and the framer,
+// reading blocks of block_size bytes from the file (or from map, if mapped)
+// from start_offset on.
+// Returns 1 on success, -1 on failure.
+int tx_pipeline_start(struct tx_pipeline *pipeline, int fd, const unsigned char *map, long long file_size,
+                      long long start_offset, int block_size)
+{
+    memset(pipeline, 0, sizeof(struct tx_pipeline));
+    pipeline->fd = fd;
+    pipeline->map = map;
+    pipeline->file_size = file_size;
+    pipeline->start_offset = start_offset;
+    atomic_init(&pipeline->block_size, block_size);
+
+    // Frames are encoded for the parameters agreed by llopen
+    struct ll_parameters parameters = ll_agreed_parameters();
+    if (compress_pool_init(&pipeline->pool, AL_COMPRESSION ? compression_threads() : 0, ll_max_payload_size() - offset_header_size(file_size)) < 0)
+        return -1;
+    if (spsc_ring_init(&pipeline->ready, AL_PIPELINE_DEPTH) < 0)
+    {
+        compress_pool_destroy(&pipeline->pool);
+        return -1;
+    }
+    if (spsc_ring_init(&pipeline->sent, AL_PIPELINE_DEPTH) < 0)
+    {
+        spsc_ring_destroy(&pipeline->ready);
+        compress_pool_destroy(&pipeline->pool);
+        return -1;
+    }
+
+    int result = frame_encoder_init(&pipeline->encoder, parameters);
+    for (int i = 0; i < AL_PIPELINE_DEPTH; i++)
+    {
+        pipeline->frames[i].frame = malloc(frame_max_size(parameters));
+        if (pipeline->frames[i].frame == NULL)
+            result = -1;
+        else
+            spsc_ring_push(&pipeline->sent, &pipeline->frames[i]); // Every buffer starts free
+    }
+
+    if (result > 0 && pthread_create(&pipeline->reader, NULL, tx_pipeline_reader, pipeline) != 0)
+        result = -1;
+    else if (result > 0 && pthread_create(&pipeline->framer, NULL, tx_pipeline_framer, pipeline) != 0)
+    {
+        compress_pool_cancel(&pipeline->pool);
+        pthread_join(pipeline->reader, NULL);
+        result = -1;
+    }
+
+    if (result < 0)
+    {
+        printf("Failed to start the transmit pipeline.\n");
+        frame_encoder_free(&pipeline->encoder);
+        for (int i = 0; i < AL_PIPELINE_DEPTH; i++)
+            free(pipeline->frames[i].frame);
+        spsc_ring_destroy(&pipeline->ready);
+        spsc_ring_destroy(&pipeline->sent);
+        compress_pool_destroy(&pipeline->pool);
+    }
+    return result;
+}
+
+// Stop the reader and the framer (early if the writer gave up) and release
+// the pipeline.
+// Returns -1 if the file could not be read or encoded, 1 otherwise.
+int tx_pipeline_stop(struct tx_pipeline *pipeline)
+{
+    // Wake up the stages wherever they wait
+    spsc_ring_close(&pipeline->sent);
+    spsc_ring_close(&pipeline->ready);
+    compress_pool_cancel(&pipeline->pool);
+    pthread_join(pipeline->reader, NULL);
+    pthread_join(pipeline->framer, NULL);
+
+    frame_encoder_free(&pipeline->encoder);
+    for (int i = 0; i < AL_PIPELINE_DEPTH; i++)
+        free(pipeline->frames[i].frame);
+    spsc_ring_destroy(&pipeline->ready);
+    spsc_ring_destroy(&pipeline->sent);
+    compress_pool_destroy(&pipeline->pool);
+    return pipeline->failed ? -1 : 1;
+}
+
+// Reader thread: hand the file to the framer in blocks, in order. Blocks of a
+// mapped file point into the mapping; otherwise they are read. An empty block
+// marks the end of the file, a negative size a read error.
+void *tx_pipeline_reader(void *arg)
+{
+    struct tx_pipeline *pipeline = arg;
+    struct compress_block *block;
+    long long offset = pipeline->start_offset;
+    if (pipeline->map == NULL && lseek(pipeline->fd, offset, SEEK_SET) < 0)
+        offset = -1; // Reported as a read error below
+    else if (AL_CHECKSUM && checksum_file_start(pipeline->fd, pipeline->map, offset, &pipeline->checksum) < 0)
+        offset = -1; // The skipped bytes of a resumed transfer could not be read
+
+    while ((block = compress_pool_next(&pipeline->pool)) != NULL)
+    {
+        int size = atomic_load(&pipeline->block_size);
+        if (offset < 0)
+            size = -1; // Read error
+        else if (pipeline->map != NULL)
+        {
+            if (size > pipeline->file_size - offset)
+                size = pipeline->file_size - offset;
+            block->data = pipeline->map + offset;
+        }
+        else
+        {
+            size = read(pipeline->fd, block->raw, size);
+            block->data = block->raw;
+        }
+        offset += size > 0 ? size : 0;
+        if (AL_CHECKSUM && size > 0)
+            pipeline->checksum = crc32c_update(pipeline->checksum, block->data, size);
+
+        block->raw_size = size;
+        compress_pool_submit(&pipeline->pool);
+        if (size <= 0)
+            break; // End of the file
+    }
+    return NULL;
+}
+
+// Framer thread: turn the blocks into DATA_OFFSET packets and encode their
+// frames, stuffing the data straight from the block
+void *tx_pipeline_framer(void *arg)
+{
+    struct tx_pipeline *pipeline = arg;
+    long long offset = pipeline->start_offset;   // File offset of the block
+    long long released = pipeline->start_offset; // Mapped file pages before this offset were dropped
+    struct compress_block *block;
+
+    while ((block = compress_pool_collect(&pipeline->pool)) != NULL) // Oldest block, in file order
+    {
+        if (block->raw_size < 0)
+        {
+            printf("Failed to read the file.\n");
+            pipeline->failed = TRUE;
+        }
+
+        struct encoded_frame *frame = block->raw_size > 0 ? spsc_ring_pop(&pipeline->sent) : NULL;
+        if (frame == NULL)
+        {
+            compress_pool_release(&pipeline->pool);
+            break; // End of the file, or the writer gave up
+        }
+
+        const unsigned char *data = block->compressed ? block->packed : block->data;
+        int data_size = block->compressed ? block->packed_size : block->raw_size;
+
+        // Construct data packet header (raw if incompressible)
+        unsigned char header[OFFSET64_HEADER_SIZE];
+        int header_size = build_offset_header(header, block->compressed, offset, data_size);
+
+        // Stuffing and check sequence, ahead of the link
+        int encoded = frame_encode_parts(&pipeline->encoder, header, header_size, data, data_size, frame);
+        if (pipeline->map != NULL)
+            released = release_mapped_pages(pipeline->map, released, offset + block->raw_size);
+        offset += block->raw_size;
+        compress_pool_release(&pipeline->pool);
+
+        if (encoded < 0)
+        {
+            pipeline->failed = TRUE;
+            break;
+        }
+        if (spsc_ring_push(&pipeline->ready, frame) < 0)
+            break; // The writer gave up
+    }
+
+    spsc_ring_close(&pipeline->ready); // The writer sends the frames already encoded, then stops
+    return NULL;
+}
@@ -0,0 +1,53 @@
+#include "whitening.h"
+#include "state_machine.h"
+#include <stdint.h>
+#include <string.h>
+
+// Pick the mask that leaves the fewest FLAG and ESC bytes in data.
+// escapes receives that number, escapes_before the number without a mask.
+unsigned char whitening_choose_mask(const unsigned char *data, size_t len, int *escapes, int *escapes_before)
+{
+    // Byte b becomes FLAG under mask b ^ FLAG, and ESC under mask b ^ ESC:
+    // the byte histogram gives the cost of all 256 masks at once
+    int histogram[256] = {0};
+    for (size_t i = 0; i < len; i++)
+        histogram[data[i]]++;
+
+    int best_mask = 0;
+    int best = histogram[FLAG] + histogram[ESC];
+    *escapes_before = best;
+
+    for (int mask = 1; mask < 256 && best > 0; mask++)
+    {
+        int cost = histogram[FLAG ^ mask] + histogram[ESC ^ mask];
+        if (mask == FLAG || mask == ESC)
+            cost++; // The mask byte itself is stuffed
+        if (cost < best)
+        {
+            best = cost;
+            best_mask = mask;
+        }
+    }
+
+    *escapes = best;
+    return best_mask;
+}
+
+// XOR len bytes of src with mask into dst; dst may be src or start before it
+void whitening_apply(unsigned char *dst, const unsigned char *src, size_t len, unsigned char mask)
+{
+    uint64_t wide_mask = 0x0101010101010101ULL * mask;
+    size_t i = 0;
+
+    // Eight bytes per step; each word is loaded before the store that may overlap it
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, src + i, sizeof(word));
+        word ^= wide_mask;
+        memcpy(dst + i, &word, sizeof(word));
+    }
+
+    for (; i < len; i++)
+        dst[i] = src[i] ^ mask;
+}
@@ -0,0 +1,20 @@
+// Unit tests of the batches of files: the names received for the files of a
+// batch must stay inside the output directory (batch_name_is_safe).
+
+#include "test.h"
+#include "batch.h"
+
+// Helpers of src/batch.c without a prototype in batch.h
+int batch_name_is_safe(const char *name);
+
+int main()
+{
+    const char *unsafe[] = {"", "/abs", "/", "..", "../x", "a/..", "a/../../x", "a/../b", "a//b", "a/", "//a"};
+    const char *safe[] = {"a", "a/b/c", ".", "./a", "...", "..a", "a..", ".hidden/b", "a/b..c"};
+
+    for (int i = 0; i < COUNT_OF(unsafe); i++)
+        EXPECT(!batch_name_is_safe(unsafe[i]), "\"%s\" accepted", unsafe[i]);
+    for (int i = 0; i < COUNT_OF(safe); i++)
+        EXPECT(batch_name_is_safe(safe[i]), "\"%s\" refused", safe[i]);
+    return test_result("batch_test");
+}
@@ -0,0 +1,97 @@
+// Unit tests of the bonded transfer receiver: the ranges of the file written
+// so far (bond_add_range), which the links fill in any order and may repeat.
+
+#include "test.h"
+#include "bond.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Helpers of src/bond.c without a prototype in bond.h
+int bond_add_range(struct bond *bond, long long offset, int size);
+
+// Helper Functions prototypes
+void expect_ranges(const char *name, struct bond *bond, const struct bond_chunk *ranges, int count);
+void test_add_range();
+void test_many_ranges();
+
+// The ranges of bond must be exactly ranges, and received_bytes their total
+void expect_ranges(const char *name, struct bond *bond, const struct bond_chunk *ranges, int count)
+{
+    long long bytes = 0;
+    int same = bond->num_received == count;
+    for (int i = 0; i < count; i++)
+    {
+        bytes += ranges[i].size;
+        if (same && (bond->received[i].offset != ranges[i].offset || bond->received[i].size != ranges[i].size))
+            same = 0;
+    }
+    EXPECT(same, "%s: %d ranges, expected %d", name, bond->num_received, count);
+    EXPECT(bond->received_bytes == bytes, "%s: %lld bytes received, expected %lld", name, bond->received_bytes, bytes);
+}
+
+void test_add_range()
+{
+    struct bond *bond = calloc(1, sizeof(struct bond));
+
+    // Disjoint ranges, added out of order, are kept sorted
+    bond_add_range(bond, 100, 10);
+    bond_add_range(bond, 300, 10);
+    bond_add_range(bond, 200, 10);
+    bond_add_range(bond, 0, 10);
+    expect_ranges("disjoint", bond, (struct bond_chunk[]){{0, 10}, {100, 10}, {200, 10}, {300, 10}}, 4);
+
+    // An exact duplicate changes nothing
+    bond_add_range(bond, 200, 10);
+    expect_ranges("duplicate", bond, (struct bond_chunk[]){{0, 10}, {100, 10}, {200, 10}, {300, 10}}, 4);
+
+    // Ranges touching a neighbour merge with it, on either side
+    bond_add_range(bond, 10, 5);
+    bond_add_range(bond, 95, 5);
+    expect_ranges("touching", bond, (struct bond_chunk[]){{0, 15}, {95, 15}, {200, 10}, {300, 10}}, 4);
+
+    // A range touching both neighbours joins them
+    bond_add_range(bond, 210, 90);
+    expect_ranges("joining", bond, (struct bond_chunk[]){{0, 15}, {95, 15}, {200, 110}}, 3);
+
+    // A range inside another one changes nothing
+    bond_add_range(bond, 250, 10);
+    expect_ranges("inside", bond, (struct bond_chunk[]){{0, 15}, {95, 15}, {200, 110}}, 3);
+
+    // A range overlapping several ranges, and running past them
+    bond_add_range(bond, 5, 400);
+    expect_ranges("overlapping", bond, (struct bond_chunk[]){{0, 405}}, 1);
+
+    // An empty range next to another one is absorbed
+    bond_add_range(bond, 405, 0);
+    expect_ranges("empty", bond, (struct bond_chunk[]){{0, 405}}, 1);
+
+    free(bond->received);
+    free(bond);
+}
+
+// Every other block, then the gaps: the array grows, then all merge into one
+void test_many_ranges()
+{
+    const int blocks = 1000;
+    const int size = 100;
+    struct bond *bond = calloc(1, sizeof(struct bond));
+
+    for (int i = blocks - 2; i >= 0; i -= 2)
+        bond_add_range(bond, (long long)i * size, size);
+    EXPECT(bond->num_received == blocks / 2 && bond->received_bytes == (long long)blocks / 2 * size,
+           "%d ranges of %lld bytes after every other block", bond->num_received, bond->received_bytes);
+    for (int i = 1; i < blocks; i += 2)
+        bond_add_range(bond, (long long)i * size, size);
+    expect_ranges("every block", bond, (struct bond_chunk[]){{0, (long long)blocks * size}}, 1);
+
+    free(bond->received);
+    free(bond);
+}
+
+int main()
+{
+    test_add_range();
+    test_many_ranges();
+    return test_result("bond_test");
+}
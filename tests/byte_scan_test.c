@@ -0,0 +1,299 @@
+// Unit tests of the bulk byte stuffing paths: copy_clean_run and stuff_bytes
+// on runs that cross the SIMD block sizes, destuffing of whole I frames by
+// state_machine_feed (given the frame at once, in pieces or byte by byte), and
+// frames built by the frame encoder going through the receiver.
+
+#include "test.h"
+#include "state_machine.h"
+#include "byte_scan.h"
+#include "link_config.h"
+#include "frame_encoder.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_RUN 100 // Covers several 16 and 32 byte blocks and their tails
+
+// Helper Functions prototypes
+void fill_clean(unsigned char *data, int size);
+int stuff_frame(const unsigned char *data, int size, unsigned char *frame);
+int stuff_reference(const unsigned char *src, int len, unsigned char *dst);
+int receive_frame(const unsigned char *frame, int frame_size, int piece, unsigned char *payload);
+void test_copy_clean_run();
+void test_destuff_case(const char *name, const unsigned char *data, int size);
+void test_destuff();
+void test_stuff_bytes_case(const char *name, const unsigned char *data, int size);
+void test_stuff_bytes();
+void test_encoded_frames();
+
+// Random bytes other than FLAG and ESC
+void fill_clean(unsigned char *data, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        data[i] = rand() & 0xFF;
+        if (data[i] == FLAG || data[i] == ESC)
+            data[i] = 0;
+    }
+}
+
+// Build an I frame (I_FRAME_0) with byte stuffing, one byte at a time
+int stuff_frame(const unsigned char *data, int size, unsigned char *frame)
+{
+    int n = 0;
+    frame[n++] = FLAG;
+    frame[n++] = TRANSMITTER_ADDRESS;
+    frame[n++] = I_FRAME_0;
+    frame[n++] = TRANSMITTER_ADDRESS ^ I_FRAME_0;
+
+    unsigned char BCC2 = 0;
+    for (int i = 0; i <= size; i++)
+    {
+        unsigned char byte = (i < size) ? data[i] : BCC2; // BCC2 is stuffed too
+        if (byte == FLAG || byte == ESC)
+        {
+            frame[n++] = ESC;
+            frame[n++] = (byte == FLAG) ? ESC_FLAG : ESC_ESC;
+        }
+        else
+        {
+            frame[n++] = byte;
+        }
+        if (i < size)
+            BCC2 ^= byte;
+    }
+
+    frame[n++] = FLAG;
+    return n;
+}
+
+// Byte stuff src into dst one byte at a time.
+// Returns the number of bytes written to dst.
+int stuff_reference(const unsigned char *src, int len, unsigned char *dst)
+{
+    int n = 0;
+    for (int i = 0; i < len; i++)
+    {
+        if (src[i] == FLAG || src[i] == ESC)
+        {
+            dst[n++] = ESC;
+            dst[n++] = src[i] ^ 0x20; // ESC_FLAG or ESC_ESC
+        }
+        else
+        {
+            dst[n++] = src[i];
+        }
+    }
+    return n;
+}
+
+// Run the receiver state machine over a frame given in pieces of "piece"
+// bytes (0 for one state_machine() call per byte).
+// Returns the payload size, or -1 if the frame was not accepted.
+int receive_frame(const unsigned char *frame, int frame_size, int piece, unsigned char *payload)
+{
+    struct state_machine machine;
+    create_state_machine(&machine, READ, I_FRAME_0, TRANSMITTER_ADDRESS, START);
+    state_machine_use_buffer(&machine, payload, MAX_PAYLOAD_SIZE + MAX_CHECK_SIZE);
+
+    for (int i = 0; i < frame_size && machine.state != STP;)
+    {
+        if (piece == 0)
+        {
+            state_machine(&machine, frame[i++]);
+            continue;
+        }
+        int len = frame_size - i < piece ? frame_size - i : piece;
+        size_t consumed = state_machine_feed(&machine, frame + i, len);
+        if (consumed == 0)
+            return -1;
+        i += consumed;
+    }
+
+    if (machine.state != STP || machine.REJ)
+        return -1;
+    return machine.buf_size;
+}
+
+// Every run length up to MAX_RUN, ended by FLAG, ESC or the end of the data
+void test_copy_clean_run()
+{
+    const unsigned char ends[] = {FLAG, ESC};
+    unsigned char src[MAX_RUN + 1];
+    unsigned char dst[MAX_RUN + 1];
+
+    for (int len = 0; len <= MAX_RUN; len++)
+    {
+        for (int e = 0; e <= COUNT_OF(ends); e++)
+        {
+            fill_clean(src, MAX_RUN + 1);
+            size_t size = len;
+            if (e < COUNT_OF(ends))
+            {
+                src[len] = ends[e]; // Run of len bytes, then more data
+                size = MAX_RUN + 1;
+            }
+
+            unsigned char bcc = 0x5A;
+            unsigned char expected_bcc = 0x5A;
+            for (int i = 0; i < len; i++)
+                expected_bcc ^= src[i];
+
+            size_t run = copy_clean_run(src, size, dst, &bcc);
+            EXPECT(run == (size_t)len, "run of %d bytes (end %d): %zu found", len, e, run);
+            EXPECT(memcmp(dst, src, len) == 0, "run of %d bytes (end %d): bytes not copied", len, e);
+            EXPECT(bcc == expected_bcc, "run of %d bytes (end %d): BCC 0x%02X, expected 0x%02X",
+                   len, e, bcc, expected_bcc);
+        }
+    }
+}
+
+void test_destuff_case(const char *name, const unsigned char *data, int size)
+{
+    const int pieces[] = {0, 1, 2, 3, 17, 64, FRAME_SIZE_BOUND(MAX_PAYLOAD_SIZE)};
+    static unsigned char frame[FRAME_SIZE_BOUND(MAX_PAYLOAD_SIZE)];
+    static unsigned char payload[MAX_PAYLOAD_SIZE + MAX_CHECK_SIZE];
+
+    int frame_size = stuff_frame(data, size, frame);
+    for (int p = 0; p < COUNT_OF(pieces); p++)
+    {
+        int received = receive_frame(frame, frame_size, pieces[p], payload);
+        EXPECT(received == size && memcmp(payload, data, size) == 0,
+               "%s in pieces of %d: %d of %d bytes received", name, pieces[p], received, size);
+    }
+
+    // A damaged payload byte fails BCC2, whatever the path
+    if (size > 0)
+    {
+        frame[4 + (frame_size - 6) / 2] ^= 0x01;
+        if (frame[4 + (frame_size - 6) / 2] != FLAG)
+            for (int p = 0; p < COUNT_OF(pieces); p++)
+                EXPECT(receive_frame(frame, frame_size, pieces[p], payload) < 0,
+                       "%s in pieces of %d: damaged frame accepted", name, pieces[p]);
+    }
+}
+
+void test_destuff()
+{
+    static unsigned char data[MAX_PAYLOAD_SIZE];
+    const int sizes[] = {0, 1, 15, 16, 17, 31, 32, 33, 100, MAX_PAYLOAD_SIZE};
+
+    ll_set_parameters(ll_legacy_parameters()); // HDLC framing with BCC2
+
+    for (int s = 0; s < COUNT_OF(sizes); s++)
+    {
+        fill_clean(data, sizes[s]);
+        test_destuff_case("clean", data, sizes[s]);
+
+        for (int i = 0; i < sizes[s]; i++)
+            data[i] = rand() & 0xFF;
+        test_destuff_case("random", data, sizes[s]);
+    }
+
+    memset(data, FLAG, MAX_PAYLOAD_SIZE);
+    test_destuff_case("all FLAG", data, MAX_PAYLOAD_SIZE);
+    memset(data, ESC, MAX_PAYLOAD_SIZE);
+    test_destuff_case("all ESC", data, MAX_PAYLOAD_SIZE);
+
+    // Escapes right at the 16 and 32 byte block boundaries
+    fill_clean(data, MAX_PAYLOAD_SIZE);
+    for (int i = 15; i < MAX_PAYLOAD_SIZE; i += 16)
+        data[i] = (i / 16) % 2 ? FLAG : ESC;
+    test_destuff_case("escapes at block ends", data, MAX_PAYLOAD_SIZE);
+}
+
+// stuff_bytes must match the byte by byte stuffing and fold BCC2 of the input
+void test_stuff_bytes_case(const char *name, const unsigned char *data, int size)
+{
+    static unsigned char stuffed[MAX_STUFFED_SIZE(MAX_PAYLOAD_SIZE)];
+    static unsigned char expected[MAX_STUFFED_SIZE(MAX_PAYLOAD_SIZE)];
+
+    unsigned char bcc = 0;
+    unsigned char expected_bcc = 0;
+    for (int i = 0; i < size; i++)
+        expected_bcc ^= data[i];
+
+    int stuffed_size = stuff_bytes(data, size, stuffed, &bcc);
+    int expected_size = stuff_reference(data, size, expected);
+    EXPECT(stuffed_size == expected_size && memcmp(stuffed, expected, expected_size) == 0,
+           "stuffing %s (%d bytes): %d bytes, expected %d", name, size, stuffed_size, expected_size);
+    EXPECT(stuffed_size <= MAX_STUFFED_SIZE(size), "stuffing %s (%d bytes): %d bytes, over the bound",
+           name, size, stuffed_size);
+    EXPECT(bcc == expected_bcc, "stuffing %s (%d bytes): BCC 0x%02X, expected 0x%02X", name, size, bcc, expected_bcc);
+}
+
+void test_stuff_bytes()
+{
+    static unsigned char data[MAX_PAYLOAD_SIZE];
+    char name[64];
+
+    // A FLAG or ESC at every position of runs up to MAX_RUN bytes
+    for (int len = 0; len <= MAX_RUN; len++)
+    {
+        fill_clean(data, len);
+        test_stuff_bytes_case("clean", data, len);
+        for (int position = 0; position < len; position++)
+        {
+            data[position] = position % 2 ? FLAG : ESC;
+            snprintf(name, sizeof(name), "escape at %d", position);
+            test_stuff_bytes_case(name, data, len);
+            data[position] = 0;
+        }
+    }
+
+    for (int i = 0; i < MAX_PAYLOAD_SIZE; i++)
+        data[i] = rand() & 0xFF;
+    test_stuff_bytes_case("random", data, MAX_PAYLOAD_SIZE);
+    memset(data, FLAG, MAX_PAYLOAD_SIZE);
+    test_stuff_bytes_case("all FLAG", data, MAX_PAYLOAD_SIZE);
+    memset(data, ESC, MAX_PAYLOAD_SIZE);
+    test_stuff_bytes_case("all ESC", data, MAX_PAYLOAD_SIZE);
+}
+
+// Frames built by the transmitter (frame_encode) decode to the same data
+void test_encoded_frames()
+{
+    static unsigned char data[MAX_PAYLOAD_SIZE];
+    static unsigned char payload[MAX_PAYLOAD_SIZE + MAX_CHECK_SIZE];
+    struct ll_parameters parameters = ll_legacy_parameters();
+    struct frame_encoder encoder;
+    if (frame_encoder_init(&encoder, parameters) < 0)
+    {
+        EXPECT(0, "frame encoder not initialized");
+        return;
+    }
+    unsigned char *frame = malloc(frame_max_size(parameters));
+
+    const int sizes[] = {0, 1, 31, 32, 33, MAX_PAYLOAD_SIZE};
+    for (int s = 0; s < COUNT_OF(sizes); s++)
+    {
+        for (int special = 0; special < 3; special++)
+        {
+            for (int i = 0; i < sizes[s]; i++)
+                data[i] = special == 0 ? rand() & 0xFF : special == 1 ? FLAG : ESC;
+
+            struct encoded_frame encoded = {.frame = frame};
+            int frame_size = frame_encode(&encoder, data, sizes[s], &encoded);
+            frame_write_header(parameters, 0, frame);
+
+            int received = frame_size < 0 ? -1 : receive_frame(frame, frame_size, 7, payload);
+            EXPECT(received == sizes[s] && memcmp(payload, data, sizes[s]) == 0,
+                   "encoded frame of %d bytes (case %d): %d bytes received", sizes[s], special, received);
+        }
+    }
+
+    free(frame);
+    frame_encoder_free(&encoder);
+}
+
+int main()
+{
+    srand(1);
+    printf("Scan implementation: %s\n", byte_scan_implementation());
+
+    test_copy_clean_run();
+    test_destuff();
+    test_stuff_bytes();
+    test_encoded_frames();
+    return test_result("byte_scan_test");
+}
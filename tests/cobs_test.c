@@ -0,0 +1,82 @@
+// Unit tests of COBS framing: round trips around the 254 byte run limit,
+// FLAG-free output within COBS_MAX_SIZE, and the decoder on invalid input.
+
+#include "test.h"
+#include "state_machine.h"
+#include "cobs.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_DATA_SIZE 2048
+
+// Helper Functions prototypes
+void test_cobs(const char *name, const unsigned char *data, int size);
+void test_invalid();
+
+void test_cobs(const char *name, const unsigned char *data, int size)
+{
+    static unsigned char encoded[COBS_MAX_SIZE(MAX_DATA_SIZE)];
+
+    size_t encoded_size = cobs_encode(data, size, encoded);
+    EXPECT(encoded_size <= COBS_MAX_SIZE(size), "%s: %zu bytes encoded, at most %d expected",
+           name, encoded_size, COBS_MAX_SIZE(size));
+    EXPECT(memchr(encoded, FLAG, encoded_size) == NULL, "%s: FLAG in the output", name);
+
+    int decoded_size = cobs_decode(encoded, encoded_size);
+    EXPECT(decoded_size == size && memcmp(encoded, data, size) == 0,
+           "%s: round trip gave %d of %d bytes", name, decoded_size, size);
+}
+
+void test_invalid()
+{
+    // A code byte of 0 is a FLAG on the wire, and a run may not pass the end
+    unsigned char flag_code[] = {FLAG, 'a'};
+    EXPECT(cobs_decode(flag_code, sizeof(flag_code)) < 0, "FLAG code byte accepted");
+    unsigned char long_run[] = {5 ^ FLAG, 'a', 'b'};
+    EXPECT(cobs_decode(long_run, sizeof(long_run)) < 0, "run past the end accepted");
+    unsigned char empty_run[] = {1 ^ FLAG};
+    EXPECT(cobs_decode(empty_run, sizeof(empty_run)) == 0, "empty data not decoded");
+}
+
+int main()
+{
+    static unsigned char data[MAX_DATA_SIZE];
+    const int sizes[] = {0, 1, 253, 254, 255, 508, 509, MAX_DATA_SIZE};
+    char name[64];
+
+    srand(1);
+
+    // Runs of every length around the 254 byte limit
+    memset(data, 'a', MAX_DATA_SIZE);
+    for (int i = 0; i < COUNT_OF(sizes); i++)
+    {
+        snprintf(name, sizeof(name), "%d byte run", sizes[i]);
+        test_cobs(name, data, sizes[i]);
+    }
+
+    // FLAG right after a full run, and FLAG as the first or last byte
+    data[254] = FLAG;
+    test_cobs("254 byte run and FLAG", data, 255);
+    test_cobs("254 byte run, FLAG and more", data, 300);
+    data[9] = FLAG;
+    test_cobs("FLAG at the end", data, 10);
+    data[0] = FLAG;
+    test_cobs("FLAG at both ends", data, 10);
+
+    memset(data, FLAG, MAX_DATA_SIZE);
+    test_cobs("single FLAG", data, 1);
+    test_cobs("two FLAGs", data, 2);
+    test_cobs("all FLAG", data, MAX_DATA_SIZE);
+
+    // Escape-heavy data costs no more than any other
+    memset(data, ESC, MAX_DATA_SIZE);
+    test_cobs("all ESC", data, MAX_DATA_SIZE);
+
+    for (int i = 0; i < MAX_DATA_SIZE; i++)
+        data[i] = rand() & 0xFF;
+    test_cobs("random", data, MAX_DATA_SIZE);
+
+    test_invalid();
+    return test_result("cobs_test");
+}
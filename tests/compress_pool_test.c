@@ -0,0 +1,129 @@
+// Unit tests of the compression worker pool: a producer thread fills blocks
+// while the consumer collects them, which must come back in file order and
+// decompress to the data that went in.
+
+#include "test.h"
+#include "compress_pool.h"
+#include "lz.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCK_SIZE 1024
+#define NUM_BLOCKS 200
+
+// Helper Functions prototypes
+void fill_block(unsigned char *data, int index);
+void *produce(void *arg);
+void test_pool(int num_threads);
+void *cancel_later(void *arg);
+void test_cancel();
+
+// Content of block "index": compressible or random, and never the same twice
+void fill_block(unsigned char *data, int index)
+{
+    unsigned int seed = index + 1;
+    for (int i = 0; i < BLOCK_SIZE; i++)
+        data[i] = index % 3 == 0 ? rand_r(&seed) & 0xFF : "block %d of the file "[i % 21] ^ (index & 0x0F);
+    memcpy(data, &index, sizeof(index));
+}
+
+void *produce(void *arg)
+{
+    struct compress_pool *pool = arg;
+    for (int index = 0; index < NUM_BLOCKS; index++)
+    {
+        struct compress_block *block = compress_pool_next(pool);
+        if (block == NULL)
+            break;
+        fill_block(block->raw, index);
+        block->data = block->raw;
+        block->raw_size = index == NUM_BLOCKS - 1 ? BLOCK_SIZE / 3 : BLOCK_SIZE; // Short last block
+        compress_pool_submit(pool);
+    }
+    return NULL;
+}
+
+void test_pool(int num_threads)
+{
+    struct compress_pool pool;
+    unsigned char expected[BLOCK_SIZE];
+    unsigned char decompressed[BLOCK_SIZE];
+    pthread_t producer;
+
+    if (compress_pool_init(&pool, num_threads, BLOCK_SIZE) < 0)
+    {
+        EXPECT(0, "%d threads: pool not started", num_threads);
+        return;
+    }
+    pthread_create(&producer, NULL, produce, &pool);
+
+    int compressed = 0;
+    for (int index = 0; index < NUM_BLOCKS; index++)
+    {
+        struct compress_block *block = compress_pool_collect(&pool);
+        if (block == NULL)
+        {
+            EXPECT(0, "%d threads: block %d not collected", num_threads, index);
+            break;
+        }
+
+        int size = index == NUM_BLOCKS - 1 ? BLOCK_SIZE / 3 : BLOCK_SIZE;
+        fill_block(expected, index);
+        const unsigned char *data = block->data;
+        int data_size = block->raw_size;
+        if (block->compressed)
+        {
+            compressed++;
+            data_size = lz_decompress(block->packed, block->packed_size, decompressed, sizeof(decompressed));
+            data = decompressed;
+            EXPECT(block->packed_size < block->raw_size, "%d threads: block %d grew when compressed",
+                   num_threads, index);
+        }
+        EXPECT(data_size == size && memcmp(data, expected, size) == 0,
+               "%d threads: block %d out of order or damaged", num_threads, index);
+        compress_pool_release(&pool);
+    }
+
+    pthread_join(producer, NULL);
+    compress_pool_destroy(&pool);
+
+    if (num_threads == 0)
+        EXPECT(compressed == 0, "no threads: %d blocks compressed", compressed);
+    else
+        EXPECT(compressed >= NUM_BLOCKS / 2, "%d threads: only %d blocks compressed", num_threads, compressed);
+}
+
+void *cancel_later(void *arg)
+{
+    compress_pool_cancel(arg);
+    return NULL;
+}
+
+// A consumer waiting for a block that never comes is woken by a cancel
+void test_cancel()
+{
+    struct compress_pool pool;
+    pthread_t canceller;
+
+    if (compress_pool_init(&pool, 2, BLOCK_SIZE) < 0)
+    {
+        EXPECT(0, "pool not started");
+        return;
+    }
+    pthread_create(&canceller, NULL, cancel_later, &pool);
+    EXPECT(compress_pool_collect(&pool) == NULL, "collect returned a block that was never submitted");
+    pthread_join(canceller, NULL);
+    EXPECT(compress_pool_next(&pool) == NULL, "next returned a block after a cancel");
+    compress_pool_destroy(&pool);
+}
+
+int main()
+{
+    test_pool(0);
+    test_pool(1);
+    test_pool(COMPRESS_MAX_THREADS);
+    test_cancel();
+    return test_result("compress_pool_test");
+}
@@ -0,0 +1,143 @@
+// Unit tests of delta sync: the rolling weak checksum the transmitter slides
+// over its file, and the DATA_COPY packets the receiver turns into copies of
+// the blocks of its current file (copy_basis_blocks).
+
+#include "test.h"
+#include "delta.h"
+#include "packet.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define COPY_PACKET_SIZE 17 // DATA_COPY packet: type, offset (8 bytes), first block (4) and count (4)
+#define BLOCK_SIZE_TEST 512
+#define BASIS_BLOCKS 8
+#define NEW_FILE_SIZE (4 * BLOCK_SIZE_TEST + 100)
+
+// Helpers of src/delta.c without a prototype in delta.h
+void weak_checksum(const unsigned char *data, int size, uint32_t *a, uint32_t *b);
+void weak_checksum_roll(uint32_t *a, uint32_t *b, int size, unsigned char out, unsigned char in);
+
+// Helper Functions prototypes
+void test_rolling_checksum(const unsigned char *data, int data_size, int size);
+int build_copy_packet(unsigned char *packet, unsigned long long offset, unsigned long long first,
+                      unsigned long long count);
+void test_copy_basis_blocks(const unsigned char *data);
+
+// Sliding the checksum must give, at every shift, the checksum of the block
+// computed afresh
+void test_rolling_checksum(const unsigned char *data, int data_size, int size)
+{
+    uint32_t a, b;
+    weak_checksum(data, size, &a, &b);
+
+    int mismatches = 0;
+    for (int position = 1; position + size <= data_size; position++)
+    {
+        weak_checksum_roll(&a, &b, size, data[position - 1], data[position + size - 1]);
+        uint32_t fresh_a, fresh_b;
+        weak_checksum(data + position, size, &fresh_a, &fresh_b);
+        if (((a & 0xFFFF) | (b << 16)) != ((fresh_a & 0xFFFF) | (fresh_b << 16)))
+            mismatches++;
+    }
+    EXPECT(mismatches == 0, "blocks of %d bytes: %d shifts differ from a fresh checksum", size, mismatches);
+}
+
+int build_copy_packet(unsigned char *packet, unsigned long long offset, unsigned long long first,
+                      unsigned long long count)
+{
+    packet[0] = DATA_COPY;
+    put_be(&packet[1], offset, 8);
+    put_be(&packet[9], first, 4);
+    put_be(&packet[13], count, 4);
+    return COPY_PACKET_SIZE;
+}
+
+// Copies land at their offset; packets of the wrong size, or asking for bytes
+// outside either file, are refused
+void test_copy_basis_blocks(const unsigned char *data)
+{
+    char basis_path[] = "/tmp/delta_test_basisXXXXXX";
+    char new_path[] = "/tmp/delta_test_newXXXXXX";
+    struct delta_basis basis = {.fd = mkstemp(basis_path), .file_size = BASIS_BLOCKS * BLOCK_SIZE_TEST,
+                                .block_size = BLOCK_SIZE_TEST, .block = malloc(BLOCK_SIZE_TEST)};
+    int fd = mkstemp(new_path);
+    if (basis.fd < 0 || fd < 0 || write(basis.fd, data, basis.file_size) != basis.file_size)
+    {
+        EXPECT(0, "cannot write the test files");
+        return;
+    }
+
+    unsigned char packet[COPY_PACKET_SIZE + 1];
+    struct file_checksum checksum = {.value = 0, .offset = 0};
+    int size = build_copy_packet(packet, 0, 2, 3); // Blocks 2 to 4 at the start of the new file
+    EXPECT(copy_basis_blocks(fd, &basis, packet, size, NEW_FILE_SIZE, &checksum) == 3 * BLOCK_SIZE_TEST,
+           "copy of 3 blocks refused");
+    unsigned char copied[3 * BLOCK_SIZE_TEST];
+    EXPECT(pread(fd, copied, sizeof(copied), 0) == sizeof(copied) &&
+               memcmp(copied, data + 2 * BLOCK_SIZE_TEST, sizeof(copied)) == 0,
+           "copied blocks differ");
+    EXPECT(checksum.offset == 3 * BLOCK_SIZE_TEST, "checksum covers %lld bytes", checksum.offset);
+
+    // The last block of the basis, ending at the end of the new file
+    size = build_copy_packet(packet, NEW_FILE_SIZE - BLOCK_SIZE_TEST, BASIS_BLOCKS - 1, 1);
+    EXPECT(copy_basis_blocks(fd, &basis, packet, size, NEW_FILE_SIZE, &checksum) == BLOCK_SIZE_TEST,
+           "copy of the last block refused");
+
+    // Packets shorter or longer than a DATA_COPY packet, read from exact buffers
+    for (int bad_size = 1; bad_size <= COPY_PACKET_SIZE + 1; bad_size++)
+    {
+        if (bad_size == COPY_PACKET_SIZE)
+            continue;
+        unsigned char *exact = malloc(bad_size);
+        memcpy(exact, packet, bad_size < COPY_PACKET_SIZE ? bad_size : COPY_PACKET_SIZE);
+        EXPECT(copy_basis_blocks(fd, &basis, exact, bad_size, NEW_FILE_SIZE, &checksum) < 0,
+               "copy packet of %d bytes accepted", bad_size);
+        free(exact);
+    }
+
+    // Bytes outside the new file or the basis
+    const unsigned long long bad[][3] = {
+        {NEW_FILE_SIZE - BLOCK_SIZE_TEST + 1, 0, 1}, // Runs past the end of the new file
+        {NEW_FILE_SIZE + 1, 0, 0},                   // Starts past it
+        {0x7FFFFFFFFFFFFFFFULL, 0, 1},               // Offset plus length overflows
+        {0xFFFFFFFFFFFFFFFFULL, 0, 1},               // Negative offset
+        {0, BASIS_BLOCKS - 1, 2},                    // Runs past the end of the basis
+        {0, BASIS_BLOCKS, 1},                        // Starts past it
+        {0, 0xFFFFFFFF, 0xFFFFFFFF},                 // Huge block numbers
+    };
+    for (int i = 0; i < COUNT_OF(bad); i++)
+    {
+        size = build_copy_packet(packet, bad[i][0], bad[i][1], bad[i][2]);
+        EXPECT(copy_basis_blocks(fd, &basis, packet, size, NEW_FILE_SIZE, &checksum) < 0,
+               "copy of %llu blocks from block %llu to offset %llu accepted", bad[i][2], bad[i][1], bad[i][0]);
+    }
+
+    close(fd);
+    close(basis.fd);
+    free(basis.block);
+    unlink(basis_path);
+    unlink(new_path);
+}
+
+int main()
+{
+    static unsigned char data[BASIS_BLOCKS * BLOCK_SIZE_TEST];
+    srand(1);
+    for (int i = 0; i < COUNT_OF(data); i++)
+        data[i] = rand() & 0xFF;
+
+    const int sizes[] = {1, 2, 16, 512, 700};
+    for (int i = 0; i < COUNT_OF(sizes); i++)
+        test_rolling_checksum(data, sizeof(data), sizes[i]);
+
+    // Bytes of 0xFF make the sums of large blocks wrap around 16 bits
+    memset(data, 0xFF, sizeof(data));
+    test_rolling_checksum(data, sizeof(data), 3000);
+    for (int i = 0; i < COUNT_OF(data); i++)
+        data[i] = rand() & 0xFF;
+
+    test_copy_basis_blocks(data);
+    return test_result("delta_test");
+}
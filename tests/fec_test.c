@@ -0,0 +1,115 @@
+// Unit tests of the Reed-Solomon forward error correction: every block with
+// up to parity / 2 damaged bytes is repaired, and blocks with more are refused.
+
+#include "test.h"
+#include "fec.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_DATA_SIZE 2048
+
+// A damaged block may be closer to another codeword than to its own, and then
+// it is "repaired" into the wrong data (the frame check catches it). With
+// parity / 2 + 1 errors that happens to about 1 in (parity / 2)! full blocks,
+// so refusal is only required from this many parity bytes up.
+#define FEC_REFUSE_PARITY 16
+
+// Helper Functions prototypes
+void fill_random(unsigned char *data, int size);
+void test_fec_case(int size, int parity, int errors, int parity_only);
+void test_encoded_size();
+
+void fill_random(unsigned char *data, int size)
+{
+    for (int i = 0; i < size; i++)
+        data[i] = rand() & 0xFF;
+}
+
+// Damage errors bytes of each block, at distinct positions (in the parity
+// bytes only if parity_only), and decode
+void test_fec_case(int size, int parity, int errors, int parity_only)
+{
+    static unsigned char data[MAX_DATA_SIZE];
+    static unsigned char encoded[MAX_DATA_SIZE * 2];
+    int block_data = FEC_BLOCK_SIZE - parity;
+
+    fill_random(data, size);
+    int encoded_size = fec_encode(data, size, parity, encoded);
+    EXPECT(encoded_size == fec_encoded_size(size, parity), "%d+%d: %d bytes encoded, %d expected",
+           size, parity, encoded_size, fec_encoded_size(size, parity));
+    EXPECT(memcmp(encoded, data, size < block_data ? size : block_data) == 0, "%d+%d: data not kept in front",
+           size, parity);
+
+    int damaged = 0;
+    int blocks = 0;
+    for (int block = 0; block * block_data < size; block++, blocks++)
+    {
+        int start = block * FEC_BLOCK_SIZE;
+        int length = size - block * block_data;
+        length = (length < block_data ? length : block_data) + parity;
+        int first = parity_only ? length - parity : 0;
+
+        unsigned char hit[FEC_BLOCK_SIZE] = {0};
+        for (int e = 0; e < errors && e < length - first; e++)
+        {
+            int position;
+            do
+                position = first + rand() % (length - first);
+            while (hit[position]);
+            hit[position] = 1;
+            encoded[start + position] ^= 1 + rand() % 255;
+            damaged++;
+        }
+    }
+
+    int corrected = 0;
+    int decoded_size = fec_decode(encoded, encoded_size, parity, &corrected);
+    if (errors <= parity / 2)
+    {
+        EXPECT(decoded_size == size && memcmp(encoded, data, size) == 0,
+               "%d+%d: %d errors per block not repaired", size, parity, errors);
+        EXPECT(corrected == damaged, "%d+%d: %d bytes repaired, %d damaged", size, parity, corrected, damaged);
+    }
+    else if (parity >= FEC_REFUSE_PARITY)
+        EXPECT(decoded_size < 0, "%d+%d: %d errors per block not refused", size, parity, errors);
+    else
+        EXPECT(decoded_size < 0 || corrected <= blocks * parity / 2,
+               "%d+%d: %d bytes repaired, more than parity / 2 per block", size, parity, corrected);
+}
+
+void test_encoded_size()
+{
+    EXPECT(fec_encoded_size(0, 8) == 0, "no data: %d bytes", fec_encoded_size(0, 8));
+    EXPECT(fec_encoded_size(1, 8) == 9, "1 byte: %d bytes", fec_encoded_size(1, 8));
+    EXPECT(fec_encoded_size(FEC_BLOCK_SIZE - 8, 8) == FEC_BLOCK_SIZE, "full block: %d bytes",
+           fec_encoded_size(FEC_BLOCK_SIZE - 8, 8));
+    EXPECT(fec_encoded_size(FEC_BLOCK_SIZE - 7, 8) == FEC_BLOCK_SIZE + 9, "full block and 1 byte: %d bytes",
+           fec_encoded_size(FEC_BLOCK_SIZE - 7, 8));
+
+    // Truncated data is refused rather than read past the end
+    unsigned char encoded[FEC_BLOCK_SIZE];
+    unsigned char data[16] = {0};
+    int corrected;
+    fec_encode(data, sizeof(data), 8, encoded);
+    EXPECT(fec_decode(encoded, 8, 8, &corrected) < 0, "block holding only parity bytes accepted");
+}
+
+int main()
+{
+    const int parities[] = {2, 4, 8, 16, 32, FEC_MAX_PARITY};
+    const int sizes[] = {1, 100, FEC_BLOCK_SIZE - 2, 1000, MAX_DATA_SIZE};
+
+    srand(1);
+    test_encoded_size();
+    for (int p = 0; p < COUNT_OF(parities); p++)
+    {
+        for (int s = 0; s < COUNT_OF(sizes); s++)
+        {
+            for (int errors = 0; errors <= parities[p] / 2 + 1; errors++)
+                test_fec_case(sizes[s], parities[p], errors, 0);
+            test_fec_case(sizes[s], parities[p], parities[p] / 2, 1);
+        }
+    }
+    return test_result("fec_test");
+}
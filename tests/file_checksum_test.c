@@ -0,0 +1,104 @@
+// Unit tests of the file checksum: the CRC-32C check value with the hardware
+// and table implementations, block by block updates, the checksum of the start
+// of a file (read or mapped) and the tracking of data arriving in order.
+
+#include "test.h"
+#include "file_checksum.h"
+#include "frame_check.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CHECK_INPUT "123456789"
+#define CRC32C_CHECK 0xE3069283
+#define FILE_SIZE (200 * 1024 + 7) // More than one 64 KiB read, and not a multiple of it
+
+// Helper Functions prototypes
+void test_crc32c();
+void test_file_start(const unsigned char *data);
+void test_in_order(const unsigned char *data);
+
+void test_crc32c()
+{
+    const unsigned char *input = (const unsigned char *)CHECK_INPUT;
+    uint32_t crc = crc32c_update(0, input, strlen(CHECK_INPUT));
+    EXPECT(crc == CRC32C_CHECK, "CRC-32C (%s) 0x%08X, expected 0x%08X", crc32c_implementation(), crc, CRC32C_CHECK);
+
+    // Every split, so pieces shorter than the 8 byte steps and unaligned starts are covered
+    for (size_t split = 0; split <= strlen(CHECK_INPUT); split++)
+    {
+        crc = crc32c_update(crc32c_update(0, input, split), input + split, strlen(CHECK_INPUT) - split);
+        EXPECT(crc == CRC32C_CHECK, "CRC-32C split at %zu: 0x%08X", split, crc);
+    }
+    EXPECT(crc32c_update(0, input, 0) == 0, "CRC-32C of no data 0x%08X", crc32c_update(0, input, 0));
+}
+
+// Read through a file or from its mapping, the checksum is the same
+void test_file_start(const unsigned char *data)
+{
+    char path[] = "/tmp/file_checksum_testXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || write(fd, data, FILE_SIZE) != FILE_SIZE)
+    {
+        EXPECT(0, "cannot write %s", path);
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+
+    const long long sizes[] = {0, 1, 64 * 1024, 64 * 1024 + 1, FILE_SIZE};
+    for (int i = 0; i < COUNT_OF(sizes); i++)
+    {
+        uint32_t expected = crc32c_update(0, data, sizes[i]);
+        uint32_t read_checksum = 0;
+        uint32_t mapped_checksum = 0;
+        EXPECT(checksum_file_start(fd, NULL, sizes[i], &read_checksum) == 1 && read_checksum == expected,
+               "first %lld bytes read: 0x%08X, expected 0x%08X", sizes[i], read_checksum, expected);
+        EXPECT(checksum_file_start(fd, data, sizes[i], &mapped_checksum) == 1 && mapped_checksum == expected,
+               "first %lld bytes mapped: 0x%08X, expected 0x%08X", sizes[i], mapped_checksum, expected);
+    }
+
+    uint32_t checksum;
+    EXPECT(checksum_file_start(fd, NULL, FILE_SIZE + 1, &checksum) < 0, "checksum past the end of the file");
+
+    close(fd);
+    unlink(path);
+}
+
+// The checksum follows data written in order, and gives up on a gap or a rewrite
+void test_in_order(const unsigned char *data)
+{
+    struct file_checksum checksum = {.value = 0, .offset = 0};
+    for (int offset = 0; offset < FILE_SIZE; offset += 1000)
+        file_checksum_update(&checksum, data + offset, FILE_SIZE - offset < 1000 ? FILE_SIZE - offset : 1000, offset);
+    EXPECT(checksum.offset == FILE_SIZE && checksum.value == crc32c_update(0, data, FILE_SIZE),
+           "in order: %lld bytes covered", checksum.offset);
+
+    struct file_checksum gap = {.value = 0, .offset = 0};
+    file_checksum_update(&gap, data, 1000, 0);
+    file_checksum_update(&gap, data + 2000, 1000, 2000);
+    file_checksum_update(&gap, data + 1000, 1000, 1000);
+    EXPECT(gap.offset < 0, "gap not noticed");
+
+    struct file_checksum rewrite = {.value = 0, .offset = 0};
+    file_checksum_update(&rewrite, data, 1000, 0);
+    file_checksum_update(&rewrite, data, 1000, 0);
+    EXPECT(rewrite.offset < 0, "rewrite not noticed");
+}
+
+int main()
+{
+    unsigned char *data = malloc(FILE_SIZE);
+    for (int i = 0; i < FILE_SIZE; i++)
+        data[i] = rand() & 0xFF;
+
+    printf("CRC-32C implementation: %s\n", crc32c_implementation());
+    test_crc32c();
+    test_file_start(data);
+    test_in_order(data);
+
+    free(data);
+    return test_result("file_checksum_test");
+}
@@ -0,0 +1,116 @@
+// Unit tests of the frame check sequences: the catalogue check values of
+// CRC-16/X-25 and CRC-32, the byte order of the check bytes, the incremental
+// interface, and the errors each check must catch.
+
+#include "test.h"
+#include "frame_check.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK_INPUT "123456789"
+#define DATA_SIZE 256
+
+// Helper Functions prototypes
+void test_check_values();
+void test_incremental();
+void test_error_detection(int type, int burst_bits);
+
+// Check values of the catalogue of parametrised CRC algorithms
+void test_check_values()
+{
+    const unsigned char *input = (const unsigned char *)CHECK_INPUT;
+    size_t len = strlen(CHECK_INPUT);
+    unsigned char check[MAX_CHECK_SIZE];
+
+    EXPECT(crc16_ccitt(input, len) == 0x906E, "CRC-16/X-25 0x%04X, expected 0x906E", crc16_ccitt(input, len));
+    EXPECT(crc32(input, len) == 0xCBF43926, "CRC-32 0x%08X, expected 0xCBF43926", crc32(input, len));
+    EXPECT(crc16_ccitt(input, 0) == 0x0000, "CRC-16/X-25 of no data 0x%04X", crc16_ccitt(input, 0));
+    EXPECT(crc32(input, 0) == 0x00000000, "CRC-32 of no data 0x%08X", crc32(input, 0));
+
+    // Check bytes go least significant first
+    EXPECT(frame_check_compute(LL_CHECK_CRC16, input, len, check) == 2 && check[0] == 0x6E && check[1] == 0x90,
+           "CRC-16 frame check %02X %02X", check[0], check[1]);
+    EXPECT(frame_check_compute(LL_CHECK_CRC32, input, len, check) == 4 &&
+               check[0] == 0x26 && check[1] == 0x39 && check[2] == 0xF4 && check[3] == 0xCB,
+           "CRC-32 frame check %02X %02X %02X %02X", check[0], check[1], check[2], check[3]);
+    EXPECT(frame_check_compute(LL_CHECK_BCC2, input, len, check) == 1 && check[0] == 0x31,
+           "BCC2 0x%02X, expected 0x31", check[0]);
+
+    EXPECT(frame_check_size(LL_CHECK_BCC2) == 1 && frame_check_size(LL_CHECK_CRC16) == 2 &&
+               frame_check_size(LL_CHECK_CRC32) == 4,
+           "check sizes %d %d %d", frame_check_size(LL_CHECK_BCC2), frame_check_size(LL_CHECK_CRC16),
+           frame_check_size(LL_CHECK_CRC32));
+}
+
+// Data given in pieces gives the same check as all at once
+void test_incremental()
+{
+    const int types[] = {LL_CHECK_BCC2, LL_CHECK_CRC16, LL_CHECK_CRC32};
+    unsigned char data[DATA_SIZE];
+    for (int i = 0; i < DATA_SIZE; i++)
+        data[i] = rand() & 0xFF;
+
+    for (int t = 0; t < COUNT_OF(types); t++)
+    {
+        unsigned char expected[MAX_CHECK_SIZE];
+        int size = frame_check_compute(types[t], data, DATA_SIZE, expected);
+
+        for (int split = 0; split <= DATA_SIZE; split += 37)
+        {
+            unsigned char check[MAX_CHECK_SIZE];
+            struct frame_check state;
+            frame_check_begin(&state, types[t]);
+            frame_check_update(&state, data, split);
+            frame_check_update(&state, data + split, DATA_SIZE - split);
+            EXPECT(frame_check_end(&state, check) == size && memcmp(check, expected, size) == 0,
+                   "check type %d split at %d differs", types[t], split);
+        }
+        EXPECT(frame_check_verify(types[t], data, DATA_SIZE, expected), "check type %d not verified", types[t]);
+    }
+}
+
+// Every error burst of up to burst_bits bits must fail the check (a CRC of n
+// bits catches all bursts of n bits or less); 1 covers every single bit error
+void test_error_detection(int type, int burst_bits)
+{
+    unsigned char data[DATA_SIZE];
+    unsigned char check[MAX_CHECK_SIZE];
+    for (int i = 0; i < DATA_SIZE; i++)
+        data[i] = rand() & 0xFF;
+    frame_check_compute(type, data, DATA_SIZE, check);
+
+    int missed = 0;
+    for (int bit = 0; bit + burst_bits <= DATA_SIZE * 8; bit++)
+    {
+        // A burst starts and ends with a flipped bit; the ones between vary
+        unsigned pattern = 1u | (1u << (burst_bits - 1)) | (((unsigned)rand() << 1) & ((1u << (burst_bits - 1)) - 1));
+        for (int b = 0; b < burst_bits; b++)
+            if (pattern & (1u << b))
+                data[(bit + b) / 8] ^= 1 << ((bit + b) % 8);
+
+        if (frame_check_verify(type, data, DATA_SIZE, check))
+            missed++;
+
+        for (int b = 0; b < burst_bits; b++)
+            if (pattern & (1u << b))
+                data[(bit + b) / 8] ^= 1 << ((bit + b) % 8);
+    }
+    EXPECT(missed == 0, "check type %d missed %d bursts of %d bits", type, missed, burst_bits);
+}
+
+int main()
+{
+    srand(1);
+    test_check_values();
+    test_incremental();
+
+    test_error_detection(LL_CHECK_BCC2, 1);
+    test_error_detection(LL_CHECK_CRC16, 1);
+    test_error_detection(LL_CHECK_CRC16, 2);
+    test_error_detection(LL_CHECK_CRC16, 16);
+    test_error_detection(LL_CHECK_CRC32, 1);
+    test_error_detection(LL_CHECK_CRC32, 2);
+    test_error_detection(LL_CHECK_CRC32, 30);
+    return test_result("frame_check_test");
+}
@@ -0,0 +1,115 @@
+// Unit tests of the adaptive payload size: the frame sizer fed with the link
+// layer counters the way the transmitter feeds it (failed_frames).
+
+#include "test.h"
+#include "frame_sizer.h"
+#include "file_transfer.h"
+
+#include <string.h>
+
+#define MIN_SIZE 64
+#define MAX_SIZE 1000
+#define OVERHEAD 10
+#define INTERVAL 16    // I frames sent between two updates
+#define MAX_UPDATES 64 // Updates allowed to reach a bound
+
+// Helper Functions prototypes
+void send_frames(struct frame_sizer *sizer, struct ll_statistics *statistics, int frames);
+void test_failed_frames();
+void test_early_timeouts();
+void test_errors_shrink_and_recover();
+void test_bounds();
+
+// Count frames sent and update the sizer as the transmitter does
+void send_frames(struct frame_sizer *sizer, struct ll_statistics *statistics, int frames)
+{
+    statistics->num_I_frames_sent += frames;
+    frame_sizer_update(sizer, statistics->num_I_frames_sent, failed_frames(*statistics));
+}
+
+void test_failed_frames()
+{
+    struct ll_statistics statistics;
+    memset(&statistics, 0, sizeof(statistics));
+
+    statistics.num_REJ_received = 1;
+    statistics.num_SREJ_received = 2;
+    statistics.num_full_timeouts = 4;
+    statistics.num_timeouts = 4 + 8; // 8 early timeouts
+    EXPECT(failed_frames(statistics) == 7, "%d failed frames, expected 7", failed_frames(statistics));
+}
+
+// Timeouts below the configured one on a clean link must not shrink the payload
+void test_early_timeouts()
+{
+    struct frame_sizer sizer;
+    struct ll_statistics statistics;
+    memset(&statistics, 0, sizeof(statistics));
+    frame_sizer_init(&sizer, MIN_SIZE, MAX_SIZE, OVERHEAD);
+
+    for (int update = 0; update < MAX_UPDATES; update++)
+    {
+        if (update < 3)
+            statistics.num_timeouts += 2; // The estimate is still too low at the start
+        send_frames(&sizer, &statistics, INTERVAL);
+        EXPECT(sizer.size == MAX_SIZE, "update %d: size %d after early timeouts only", update, sizer.size);
+    }
+    EXPECT(sizer.byte_error_rate == 0, "byte error rate %g on a clean link", sizer.byte_error_rate);
+}
+
+// Rejected frames shrink the payload, which grows back once the link is clean
+void test_errors_shrink_and_recover()
+{
+    struct frame_sizer sizer;
+    struct ll_statistics statistics;
+    memset(&statistics, 0, sizeof(statistics));
+    frame_sizer_init(&sizer, MIN_SIZE, MAX_SIZE, OVERHEAD);
+
+    statistics.num_REJ_received += INTERVAL / 4;
+    send_frames(&sizer, &statistics, INTERVAL);
+    EXPECT(sizer.size < MAX_SIZE, "size %d after 1 in 4 frames rejected", sizer.size);
+    EXPECT(sizer.size >= MAX_SIZE / 2, "size %d: more than halved in one update", sizer.size);
+
+    int shrunk = sizer.size;
+    statistics.num_full_timeouts += INTERVAL / 4;
+    send_frames(&sizer, &statistics, INTERVAL);
+    EXPECT(sizer.size < shrunk, "size %d after 1 in 4 frames timed out at the configured timeout", sizer.size);
+
+    int updates = 0;
+    while (sizer.size < MAX_SIZE && updates++ < MAX_UPDATES)
+        send_frames(&sizer, &statistics, INTERVAL);
+    EXPECT(sizer.size == MAX_SIZE, "size %d after %d clean updates", sizer.size, MAX_UPDATES);
+}
+
+// The size stays within its bounds, and short intervals are ignored
+void test_bounds()
+{
+    struct frame_sizer sizer;
+    struct ll_statistics statistics;
+    memset(&statistics, 0, sizeof(statistics));
+    frame_sizer_init(&sizer, MIN_SIZE, MAX_SIZE, OVERHEAD);
+
+    statistics.num_REJ_received += INTERVAL;
+    send_frames(&sizer, &statistics, INTERVAL - 1);
+    EXPECT(sizer.size == MAX_SIZE, "size %d changed after fewer than %d frames", sizer.size, INTERVAL);
+
+    for (int update = 0; update < MAX_UPDATES; update++)
+    {
+        statistics.num_REJ_received += INTERVAL;
+        send_frames(&sizer, &statistics, INTERVAL);
+        EXPECT(sizer.size >= MIN_SIZE, "size %d below the minimum", sizer.size);
+    }
+    EXPECT(sizer.size == MIN_SIZE, "size %d with every frame rejected", sizer.size);
+
+    frame_sizer_init(&sizer, MAX_SIZE, MIN_SIZE, OVERHEAD);
+    EXPECT(sizer.size == MIN_SIZE && sizer.min_size == MIN_SIZE, "minimum above the maximum not clamped");
+}
+
+int main()
+{
+    test_failed_frames();
+    test_early_timeouts();
+    test_errors_shrink_and_recover();
+    test_bounds();
+    return test_result("frame_sizer_test");
+}
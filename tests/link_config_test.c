@@ -0,0 +1,307 @@
+// Unit tests of the link parameter block sent with SET/UA: encode/decode round
+// trips, blocks damaged or crafted by the peer (truncated, bad CRC, unknown
+// types, lengths past the end, values out of range) and the merge rules.
+
+#include "test.h"
+#include "link_config.h"
+#include "frame_check.h"
+#include "fec.h"
+
+#include <string.h>
+
+// TLV types of the block (see src/link_config.c)
+#define PARAMETER_PAYLOAD_SIZE 0
+#define PARAMETER_WINDOW_SIZE 1
+#define PARAMETER_ARQ_MODE 2
+#define PARAMETER_FRAME_CHECK 3
+#define PARAMETER_FEC_PARITY 4
+#define PARAMETER_WHITENING 5
+#define PARAMETER_FRAMING 6
+#define PARAMETER_REPLY_REQUEST 7
+#define PARAMETER_REPLY_DATA 8
+
+#define BLOCK_SIZE 256
+
+// Block under construction
+struct block
+{
+    unsigned char data[BLOCK_SIZE];
+    int size;
+};
+
+// Helper Functions prototypes
+int same_parameters(struct ll_parameters a, struct ll_parameters b);
+void block_add(struct block *block, int type, int length, const unsigned char *value);
+void block_add_byte(struct block *block, int type, unsigned char value);
+int block_finish(struct block *block);
+int decode_one(int type, int length, const unsigned char *value, struct ll_parameters *parameters);
+void test_round_trip();
+void test_damaged_blocks();
+void test_crafted_blocks();
+void test_value_bounds();
+void test_merge();
+
+int same_parameters(struct ll_parameters a, struct ll_parameters b)
+{
+    return a.max_payload_size == b.max_payload_size && a.window_size == b.window_size &&
+           a.arq_mode == b.arq_mode && a.frame_check == b.frame_check && a.fec_parity == b.fec_parity &&
+           a.whitening == b.whitening && a.framing == b.framing;
+}
+
+void block_add(struct block *block, int type, int length, const unsigned char *value)
+{
+    block->data[block->size++] = type;
+    block->data[block->size++] = length;
+    memcpy(&block->data[block->size], value, length);
+    block->size += length;
+}
+
+void block_add_byte(struct block *block, int type, unsigned char value)
+{
+    block_add(block, type, 1, &value);
+}
+
+// Append the CRC-16 of the TLVs, as the peer does.
+// Returns the size of the block.
+int block_finish(struct block *block)
+{
+    uint16_t crc = crc16_ccitt(block->data, block->size);
+    block->data[block->size++] = crc & 0xFF;
+    block->data[block->size++] = crc >> 8;
+    return block->size;
+}
+
+// Decode a block holding a single TLV
+// Returns the result of ll_decode_parameters
+int decode_one(int type, int length, const unsigned char *value, struct ll_parameters *parameters)
+{
+    struct block block = {.size = 0};
+    block_add(&block, type, length, value);
+    block_finish(&block);
+    return ll_decode_parameters(block.data, block.size, parameters, NULL);
+}
+
+void test_round_trip()
+{
+    unsigned char block[LL_PARAMETERS_MAX_SIZE];
+    struct ll_parameters decoded;
+    struct ll_reply reply;
+
+    struct ll_parameters cases[3] = {ll_legacy_parameters(), ll_proposed_parameters(), ll_legacy_parameters()};
+    cases[2].max_payload_size = LL_PAYLOAD_SIZE_LIMIT;
+    cases[2].window_size = LL_MAX_WINDOW_SIZE;
+    cases[2].arq_mode = LL_SELECTIVE_REPEAT;
+    cases[2].frame_check = LL_CHECK_CRC32;
+    cases[2].fec_parity = FEC_MAX_PARITY;
+    cases[2].whitening = 1;
+    cases[2].framing = LL_FRAMING_COBS;
+
+    for (int i = 0; i < COUNT_OF(cases); i++)
+    {
+        int size = ll_encode_parameters(cases[i], NULL, block);
+        EXPECT(size <= LL_PARAMETERS_MAX_SIZE, "case %d: block of %d bytes", i, size);
+        EXPECT(ll_decode_parameters(block, size, &decoded, &reply) == 1 && same_parameters(decoded, cases[i]),
+               "case %d: parameters changed in the round trip", i);
+        EXPECT(!reply.requested && reply.size == 0, "case %d: reply data out of nowhere", i);
+    }
+
+    // Reply request (SET) and the largest reply data (UA)
+    struct ll_reply sent = {.requested = 1, .size = LL_REPLY_DATA_MAX_SIZE};
+    for (int i = 0; i < LL_REPLY_DATA_MAX_SIZE; i++)
+        sent.data[i] = i * 7;
+    int size = ll_encode_parameters(cases[2], &sent, block);
+    EXPECT(size <= LL_PARAMETERS_MAX_SIZE, "block with reply data of %d bytes", size);
+    EXPECT(ll_decode_parameters(block, size, &decoded, &reply) == 1 && reply.requested &&
+               reply.size == LL_REPLY_DATA_MAX_SIZE && memcmp(reply.data, sent.data, reply.size) == 0,
+           "reply data changed in the round trip");
+
+    // A block with no TLVs leaves the values of the original protocol
+    struct block empty = {.size = 0};
+    block_finish(&empty);
+    EXPECT(ll_decode_parameters(empty.data, empty.size, &decoded, NULL) == 1 &&
+               ll_parameters_are_legacy(decoded),
+           "empty block not decoded to the original protocol");
+}
+
+// Truncated or corrupted blocks
+void test_damaged_blocks()
+{
+    unsigned char block[LL_PARAMETERS_MAX_SIZE];
+    struct ll_parameters parameters = ll_legacy_parameters();
+    struct ll_parameters decoded;
+    parameters.window_size = 4;
+    parameters.fec_parity = 8;
+    int size = ll_encode_parameters(parameters, NULL, block);
+
+    for (int cut = 0; cut < size; cut++)
+        EXPECT(ll_decode_parameters(block, cut, &decoded, NULL) < 0, "block cut to %d of %d bytes accepted", cut, size);
+
+    for (int i = 0; i < size; i++)
+    {
+        for (int bit = 0; bit < 8; bit++)
+        {
+            block[i] ^= 1 << bit;
+            EXPECT(ll_decode_parameters(block, size, &decoded, NULL) < 0, "bit %d of byte %d flipped accepted", bit, i);
+            block[i] ^= 1 << bit;
+        }
+    }
+}
+
+// Blocks with a valid CRC but odd contents
+void test_crafted_blocks()
+{
+    struct ll_parameters decoded;
+    unsigned char value[4] = {0x12, 0x34, 0x56, 0x78};
+
+    // Unknown types, and known types with an unexpected length, are skipped
+    struct block block = {.size = 0};
+    block_add_byte(&block, PARAMETER_WINDOW_SIZE, 3);
+    block_add(&block, 0x7F, 4, value);
+    block_add(&block, 0xFF, 0, value);
+    block_add(&block, PARAMETER_WINDOW_SIZE, 2, value);
+    block_add(&block, PARAMETER_WHITENING, 1, value);
+    block_finish(&block);
+    EXPECT(ll_decode_parameters(block.data, block.size, &decoded, NULL) == 1 &&
+               decoded.window_size == 3 && !decoded.whitening,
+           "unknown TLVs not skipped");
+
+    // A length running past the end of the block
+    block.size = 0;
+    block_add_byte(&block, PARAMETER_WINDOW_SIZE, 3);
+    block.data[block.size++] = 0x7F;
+    block.data[block.size++] = 10;
+    block.data[block.size++] = 0;
+    block_finish(&block);
+    EXPECT(ll_decode_parameters(block.data, block.size, &decoded, NULL) < 0, "TLV past the end accepted");
+
+    block.size = 0;
+    block_add_byte(&block, PARAMETER_WINDOW_SIZE, 3);
+    block.data[block.size++] = PARAMETER_PAYLOAD_SIZE;
+    block.data[block.size++] = 2;
+    block.data[block.size++] = 0x04;
+    block_finish(&block);
+    EXPECT(ll_decode_parameters(block.data, block.size, &decoded, NULL) < 0, "payload size past the end accepted");
+
+    // A type with no room for its length
+    block.size = 0;
+    block_add_byte(&block, PARAMETER_WINDOW_SIZE, 3);
+    block.data[block.size++] = PARAMETER_FRAMING;
+    block_finish(&block);
+    EXPECT(ll_decode_parameters(block.data, block.size, &decoded, NULL) < 0, "TLV without a length accepted");
+
+    // Reply data longer than LL_REPLY_DATA_MAX_SIZE is not copied
+    unsigned char long_reply[LL_REPLY_DATA_MAX_SIZE + 1] = {0};
+    struct ll_reply reply;
+    block.size = 0;
+    block_add(&block, PARAMETER_REPLY_DATA, sizeof(long_reply), long_reply);
+    block_finish(&block);
+    EXPECT(ll_decode_parameters(block.data, block.size, &decoded, &reply) == 1 && reply.size == 0,
+           "reply data of %d bytes taken", reply.size);
+}
+
+// Each value at its bounds, and just outside them
+void test_value_bounds()
+{
+    struct ll_parameters decoded;
+    unsigned char payload_size[2];
+
+    payload_size[0] = LL_MIN_PAYLOAD_SIZE >> 8;
+    payload_size[1] = LL_MIN_PAYLOAD_SIZE & 0xFF;
+    EXPECT(decode_one(PARAMETER_PAYLOAD_SIZE, 2, payload_size, &decoded) == 1 &&
+               decoded.max_payload_size == LL_MIN_PAYLOAD_SIZE,
+           "smallest payload size refused");
+    payload_size[0] = (LL_MIN_PAYLOAD_SIZE - 1) >> 8;
+    payload_size[1] = (LL_MIN_PAYLOAD_SIZE - 1) & 0xFF;
+    EXPECT(decode_one(PARAMETER_PAYLOAD_SIZE, 2, payload_size, &decoded) < 0, "payload size below the minimum accepted");
+    payload_size[0] = payload_size[1] = 0;
+    EXPECT(decode_one(PARAMETER_PAYLOAD_SIZE, 2, payload_size, &decoded) < 0, "payload size 0 accepted");
+
+    const struct
+    {
+        int type;
+        int value;
+        int valid;
+    } cases[] = {
+        {PARAMETER_WINDOW_SIZE, 0, 0},
+        {PARAMETER_WINDOW_SIZE, 1, 1},
+        {PARAMETER_WINDOW_SIZE, LL_MAX_WINDOW_SIZE, 1},
+        {PARAMETER_WINDOW_SIZE, LL_MAX_WINDOW_SIZE + 1, 0},
+        {PARAMETER_WINDOW_SIZE, 255, 0},
+        {PARAMETER_ARQ_MODE, LL_GO_BACK_N, 1},
+        {PARAMETER_ARQ_MODE, LL_SELECTIVE_REPEAT, 1},
+        {PARAMETER_ARQ_MODE, 2, 0},
+        {PARAMETER_ARQ_MODE, 255, 0},
+        {PARAMETER_FRAME_CHECK, LL_CHECK_BCC2, 1},
+        {PARAMETER_FRAME_CHECK, LL_CHECK_CRC32, 1},
+        {PARAMETER_FRAME_CHECK, LL_CHECK_CRC32 + 1, 0},
+        {PARAMETER_FRAME_CHECK, 255, 0},
+        {PARAMETER_FEC_PARITY, 0, 1},
+        {PARAMETER_FEC_PARITY, 2, 1},
+        {PARAMETER_FEC_PARITY, 3, 0},
+        {PARAMETER_FEC_PARITY, FEC_MAX_PARITY, 1},
+        {PARAMETER_FEC_PARITY, FEC_MAX_PARITY + 2, 0},
+        {PARAMETER_FEC_PARITY, 254, 0},
+        {PARAMETER_FRAMING, LL_FRAMING_HDLC, 1},
+        {PARAMETER_FRAMING, LL_FRAMING_COBS, 1},
+        {PARAMETER_FRAMING, LL_FRAMING_COBS + 1, 0},
+        {PARAMETER_FRAMING, 255, 0},
+    };
+
+    for (int i = 0; i < COUNT_OF(cases); i++)
+    {
+        unsigned char value = cases[i].value;
+        int result = decode_one(cases[i].type, 1, &value, &decoded);
+        EXPECT((result == 1) == cases[i].valid, "type %d value %d: %s", cases[i].type, cases[i].value,
+               cases[i].valid ? "refused" : "accepted");
+    }
+}
+
+void test_merge()
+{
+    struct ll_parameters a = ll_legacy_parameters();
+    struct ll_parameters b = ll_legacy_parameters();
+    a.max_payload_size = 2000;
+    a.window_size = 8;
+    a.arq_mode = LL_SELECTIVE_REPEAT;
+    a.frame_check = LL_CHECK_CRC16;
+    a.fec_parity = 4;
+    b.max_payload_size = 500;
+    b.window_size = 16;
+    b.arq_mode = LL_GO_BACK_N;
+    b.frame_check = LL_CHECK_CRC32;
+    b.whitening = 1;
+    b.framing = LL_FRAMING_COBS;
+
+    for (int order = 0; order < 2; order++)
+    {
+        struct ll_parameters agreed = order == 0 ? ll_merge_parameters(a, b) : ll_merge_parameters(b, a);
+        EXPECT(agreed.max_payload_size == 500 && agreed.window_size == 8, "merge %d: not the smaller payload and window", order);
+        EXPECT(agreed.arq_mode == LL_GO_BACK_N, "merge %d: Selective Repeat asked for by one side only", order);
+        EXPECT(agreed.frame_check == LL_CHECK_CRC32 && agreed.fec_parity == 4,
+               "merge %d: not the stronger check and FEC", order);
+        EXPECT(agreed.whitening && agreed.framing == LL_FRAMING_COBS, "merge %d: whitening or COBS dropped", order);
+    }
+
+    b.arq_mode = LL_SELECTIVE_REPEAT;
+    EXPECT(ll_merge_parameters(a, b).arq_mode == LL_SELECTIVE_REPEAT, "Selective Repeat asked for by both sides refused");
+
+    // A peer may announce a payload above our limit: the merge keeps ours
+    unsigned char payload_size[2] = {0xFF, 0xFF};
+    struct ll_parameters decoded;
+    EXPECT(decode_one(PARAMETER_PAYLOAD_SIZE, 2, payload_size, &decoded) == 1 &&
+               ll_merge_parameters(ll_proposed_parameters(), decoded).max_payload_size == LL_MAX_PAYLOAD_SIZE,
+           "payload of 65535 bytes not capped by the merge");
+
+    EXPECT(ll_parameters_are_legacy(ll_merge_parameters(ll_legacy_parameters(), ll_legacy_parameters())),
+           "merge of the original protocol with itself");
+}
+
+int main()
+{
+    test_round_trip();
+    test_damaged_blocks();
+    test_crafted_blocks();
+    test_value_bounds();
+    test_merge();
+    return test_result("link_config_test");
+}
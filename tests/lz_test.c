@@ -0,0 +1,114 @@
+// Unit tests of the LZ block codec used by the compression stage: round trips
+// and the decoder on damaged input (truncated streams, bad offsets and
+// lengths, output larger than its buffer).
+
+#include "test.h"
+#include "lz.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_DATA_SIZE 2048
+
+// Helper Functions prototypes
+void test_round_trip(const char *name, const unsigned char *data, int size);
+void test_rejects(const char *name, const unsigned char *src, int len);
+void test_truncated();
+void test_damaged_sequences();
+
+void test_round_trip(const char *name, const unsigned char *data, int size)
+{
+    static unsigned char compressed[MAX_DATA_SIZE * 2];
+    static unsigned char decompressed[MAX_DATA_SIZE];
+
+    int compressed_size = lz_compress(data, size, compressed, sizeof(compressed));
+    EXPECT(compressed_size >= 0, "%s: not compressed", name);
+    int decompressed_size = lz_decompress(compressed, compressed_size, decompressed, sizeof(decompressed));
+    EXPECT(decompressed_size == size && memcmp(decompressed, data, size) == 0,
+           "%s: round trip gave %d of %d bytes", name, decompressed_size, size);
+    if (size > 0)
+        EXPECT(lz_decompress(compressed, compressed_size, decompressed, size - 1) < 0,
+               "%s: wrote past the capacity", name);
+}
+
+void test_rejects(const char *name, const unsigned char *src, int len)
+{
+    unsigned char out[64];
+    EXPECT(lz_decompress(src, len, out, sizeof(out)) < 0, "accepted %s", name);
+}
+
+// A truncated stream is refused or decodes to a shorter prefix. Only the
+// empty last sequence (a 0 token) can be cut without losing data.
+void test_truncated()
+{
+    static unsigned char data[MAX_DATA_SIZE];
+    static unsigned char compressed[MAX_DATA_SIZE * 2];
+    static unsigned char decompressed[MAX_DATA_SIZE];
+
+    for (int i = 0; i < MAX_DATA_SIZE; i++)
+        data[i] = "abcabcabd"[i % 9] + (i / 700);
+    int compressed_size = lz_compress(data, MAX_DATA_SIZE, compressed, sizeof(compressed));
+    EXPECT(compressed_size > 0 && compressed_size < MAX_DATA_SIZE, "repetitive data compressed to %d bytes",
+           compressed_size);
+
+    for (int cut = 0; cut < compressed_size; cut++)
+    {
+        int size = lz_decompress(compressed, cut, decompressed, sizeof(decompressed));
+        int complete = cut == compressed_size - 1 && compressed[cut] == 0x00;
+        EXPECT(size < 0 || ((size < MAX_DATA_SIZE || complete) && memcmp(decompressed, data, size) == 0),
+               "stream cut to %d bytes gave %d bytes", cut, size);
+    }
+}
+
+// Sequence layout: token, literals, offset (2 bytes), extra length bytes
+void test_damaged_sequences()
+{
+    unsigned char decompressed[64];
+
+    const unsigned char valid[] = {0x10, 'a', 0x01, 0x00};
+    int size = lz_decompress(valid, sizeof(valid), decompressed, sizeof(decompressed));
+    EXPECT(size == 5 && memcmp(decompressed, "aaaaa", 5) == 0, "overlapping match gave %d bytes", size);
+
+    const unsigned char short_literals[] = {0x30, 'a', 'b'};
+    test_rejects("literals past the end", short_literals, sizeof(short_literals));
+    const unsigned char short_offset[] = {0x10, 'a', 0x01};
+    test_rejects("a truncated offset", short_offset, sizeof(short_offset));
+    const unsigned char short_literal_count[] = {0xF0};
+    test_rejects("a truncated literal count", short_literal_count, sizeof(short_literal_count));
+    const unsigned char short_match[] = {0x1F, 'a', 0x01, 0x00};
+    test_rejects("a truncated match length", short_match, sizeof(short_match));
+    const unsigned char far_offset[] = {0x10, 'a', 0x02, 0x00};
+    test_rejects("an offset before the start", far_offset, sizeof(far_offset));
+    const unsigned char zero_offset[] = {0x10, 'a', 0x00, 0x00};
+    test_rejects("a zero offset", zero_offset, sizeof(zero_offset));
+    const unsigned char large_offset[] = {0x10, 'a', 0xFF, 0xFF};
+    test_rejects("an offset of 65535", large_offset, sizeof(large_offset));
+    const unsigned char long_match[] = {0x1F, 'a', 0x01, 0x00, 0xFF, 0x10}; // 290 bytes
+    test_rejects("a match past the capacity", long_match, sizeof(long_match));
+}
+
+int main()
+{
+    static unsigned char data[MAX_DATA_SIZE];
+    static unsigned char compressed[MAX_DATA_SIZE];
+
+    srand(1);
+    test_round_trip("no data", data, 0);
+
+    memset(data, 'x', MAX_DATA_SIZE);
+    test_round_trip("one byte repeated", data, MAX_DATA_SIZE);
+
+    for (int i = 0; i < MAX_DATA_SIZE; i++)
+        data[i] = rand() & 0xFF;
+    test_round_trip("random", data, MAX_DATA_SIZE);
+    test_round_trip("3 random bytes", data, 3);
+    EXPECT(lz_compress(data, 100, compressed, 50) < 0, "100 random bytes compressed into 50");
+
+    for (int i = 0; i < MAX_DATA_SIZE; i++)
+        data[i] = i % 300 < 150 ? rand() & 0x03 : "text-like run "[i % 14];
+    test_round_trip("mixed", data, MAX_DATA_SIZE);
+
+    test_truncated();
+    test_damaged_sequences();
+    return test_result("lz_test");
+}
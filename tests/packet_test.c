@@ -0,0 +1,371 @@
+// Unit tests of the packets: the fields of the START and END control packets
+// (parse_control_packet and check_end_packet), and write_data_packet, which
+// places the data of every kind of data packet in the file and refuses
+// packets that are malformed or whose offset would write outside the file
+// announced.
+
+#include "test.h"
+#include "packet.h"
+#include "lz.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SINK_SIZE 3000 // Size of the file announced
+#define BLOCK 100
+
+// Helper Functions prototypes
+int add_field(unsigned char *packet, int size, int type, int length, const unsigned char *value);
+int add_number(unsigned char *packet, int size, int type, int length, unsigned long long value);
+void test_control_fields();
+void test_control_truncated();
+void test_file_sizes();
+void test_resume_offset();
+void test_end_packet();
+int build_packet(unsigned char *packet, int type, long long offset, const unsigned char *data, int data_size);
+long long sink_size(int fd);
+void test_write_data_packet(const unsigned char *data);
+void test_refused_packets(const unsigned char *data);
+
+// Build a data packet of the given type around data (already compressed for
+// the LZ types). Returns the size of the packet.
+int build_packet(unsigned char *packet, int type, long long offset, const unsigned char *data, int data_size)
+{
+    int header_size;
+    if (type == DATA || type == DATA_LZ)
+    {
+        packet[0] = type;
+        packet[1] = 0; // Sequence number
+        packet[2] = (unsigned char)(data_size / 256);
+        packet[3] = (unsigned char)(data_size % 256);
+        header_size = DATA_HEADER_SIZE;
+    }
+    else
+    {
+        header_size = build_offset_header(packet, type == DATA_LZ_OFFSET || type == DATA_LZ_OFFSET64, offset, data_size);
+    }
+    memcpy(packet + header_size, data, data_size);
+    return header_size + data_size;
+}
+
+// Append a TLV field to a control packet of size bytes.
+// Returns the new size of the packet.
+int add_field(unsigned char *packet, int size, int type, int length, const unsigned char *value)
+{
+    packet[size++] = type;
+    packet[size++] = length;
+    memcpy(packet + size, value, length);
+    return size + length;
+}
+
+// Append a field holding a number, least significant byte first
+int add_number(unsigned char *packet, int size, int type, int length, unsigned long long value)
+{
+    unsigned char bytes[8];
+    put_le(bytes, value, length);
+    return add_field(packet, size, type, length, bytes);
+}
+
+// Every field of a START packet, a file name of the longest length a field
+// holds, and unknown fields skipped
+void test_control_fields()
+{
+    unsigned char packet[MAX_PAYLOAD_SIZE];
+    unsigned char name[UCHAR_MAX];
+    struct file_info info;
+    memset(name, 'n', sizeof(name));
+
+    int size = 1;
+    packet[0] = START;
+    size = add_number(packet, size, FILE_SIZE, 4, 123456);
+    size = add_field(packet, size, FILE_NAME, UCHAR_MAX, name);
+    size = add_field(packet, size, 200, 3, (const unsigned char *)"abc"); // Unknown
+    size = add_number(packet, size, CODEC, 1, CODEC_LZ);
+    size = add_number(packet, size, FILE_TAG, 4, 0xDEADBEEF);
+    size = add_number(packet, size, RESUME_OFFSET, 8, 1000);
+    size = add_number(packet, size, NEXT_FILE, 1, 1);
+    size = add_field(packet, size, 201, 0, (const unsigned char *)""); // Unknown and empty
+
+    EXPECT(parse_control_packet(packet, size, &info) == 1, "START packet refused");
+    EXPECT(info.file_size == 123456, "file size %lld", info.file_size);
+    EXPECT(strlen((const char *)info.name) == UCHAR_MAX && memcmp(info.name, name, UCHAR_MAX) == 0,
+           "file name of %zu bytes", strlen((const char *)info.name));
+    EXPECT(info.codec == CODEC_LZ && info.tag == 0xDEADBEEF && info.resume_offset == 1000 && info.next_file,
+           "codec %d, tag %08x, resume offset %lld, next file %d", info.codec, info.tag, info.resume_offset,
+           info.next_file);
+
+    // A codec this side does not know
+    size = add_number(packet, size, CODEC, 1, 7);
+    EXPECT(parse_control_packet(packet, size, &info) < 0, "unknown codec accepted");
+}
+
+// Fields whose length runs past the end of the packet, at every cut
+void test_control_truncated()
+{
+    unsigned char packet[MAX_PAYLOAD_SIZE];
+    unsigned char name[UCHAR_MAX];
+    struct file_info info;
+    memset(name, 'n', sizeof(name));
+
+    int size = 1;
+    packet[0] = START;
+    size = add_number(packet, size, FILE_SIZE, 4, 100);
+    size = add_field(packet, size, FILE_NAME, UCHAR_MAX, name);
+    int name_end = size;
+    size = add_number(packet, size, FILE_TAG, 4, 1);
+
+    for (int cut = 2; cut < size; cut++)
+    {
+        if (cut == 1 + 6 || cut == name_end)
+            continue; // Ends between two fields
+        EXPECT(parse_control_packet(packet, cut, &info) < 0, "START cut at %d of %d bytes accepted", cut, size);
+        packet[0] = END;
+        EXPECT(check_end_packet(packet, cut, name, 100) < 0, "END cut at %d of %d bytes accepted", cut, size);
+        packet[0] = START;
+    }
+
+    // A length pointing past the end, with bytes left after the packet
+    packet[1 + 6 + 1] = UCHAR_MAX;
+    EXPECT(parse_control_packet(packet, 1 + 6 + 2 + 10, &info) < 0, "FILE_NAME past the end accepted");
+}
+
+// FILE_SIZE and FILE_SIZE_64 may come together if they agree
+void test_file_sizes()
+{
+    unsigned char packet[MAX_PAYLOAD_SIZE];
+    struct file_info info;
+    long long large = 0x123456789ALL;
+
+    int size = 1;
+    packet[0] = START;
+    size = add_number(packet, size, FILE_SIZE_64, 8, large);
+    EXPECT(parse_control_packet(packet, size, &info) == 1 && info.file_size == large, "FILE_SIZE_64 %lld",
+           info.file_size);
+
+    size = add_number(packet, size, FILE_SIZE, 4, 100);
+    EXPECT(parse_control_packet(packet, size, &info) < 0, "FILE_SIZE_64 then a different FILE_SIZE accepted");
+
+    size = 1;
+    size = add_number(packet, size, FILE_SIZE, 4, 100);
+    size = add_number(packet, size, FILE_SIZE_64, 8, 100);
+    EXPECT(parse_control_packet(packet, size, &info) == 1 && info.file_size == 100, "agreeing sizes: %lld",
+           info.file_size);
+    size = add_number(packet, size, FILE_SIZE_64, 8, large);
+    EXPECT(parse_control_packet(packet, size, &info) < 0, "FILE_SIZE then a different FILE_SIZE_64 accepted");
+
+    // Sizes that do not fit in a long long
+    size = 1;
+    size = add_number(packet, size, FILE_SIZE_64, 8, 0x8000000000000000ULL);
+    EXPECT(parse_control_packet(packet, size, &info) < 0, "file size of 2^63 accepted");
+    unsigned char nine[9] = {0, 0, 0, 0, 0, 0, 0, 0, 1};
+    size = add_field(packet, 1, FILE_SIZE_64, 9, nine);
+    EXPECT(parse_control_packet(packet, size, &info) < 0, "file size of 9 bytes accepted");
+
+    // The END packet must repeat the size of the START packet, in either field
+    packet[0] = END;
+    size = 1;
+    size = add_number(packet, size, FILE_SIZE, 4, 100);
+    size = add_field(packet, size, FILE_NAME, 1, (const unsigned char *)"f");
+    size = add_number(packet, size, FILE_SIZE_64, 8, 100);
+    EXPECT(check_end_packet(packet, size, (const unsigned char *)"f", 100) == 1, "agreeing END sizes refused");
+    size = add_number(packet, size, FILE_SIZE_64, 8, large);
+    EXPECT(check_end_packet(packet, size, (const unsigned char *)"f", 100) < 0, "conflicting END sizes accepted");
+}
+
+// The data of a resumed file starts inside it
+void test_resume_offset()
+{
+    unsigned char packet[MAX_PAYLOAD_SIZE];
+    struct file_info info;
+    const long long offsets[] = {0, 1, 999, 1000, 1001, 0x7FFFFFFFFFFFFFFFLL};
+
+    for (int i = 0; i < COUNT_OF(offsets); i++)
+    {
+        int size = 1;
+        packet[0] = START;
+        size = add_number(packet, size, FILE_SIZE, 4, 1000);
+        size = add_number(packet, size, RESUME_OFFSET, 8, offsets[i]);
+        int result = parse_control_packet(packet, size, &info);
+        EXPECT(offsets[i] <= 1000 ? result == 1 && info.resume_offset == offsets[i] : result < 0,
+               "resume offset %lld of a file of 1000 bytes: %d", offsets[i], result);
+
+        // The offset may come before the size
+        size = 1;
+        size = add_number(packet, size, RESUME_OFFSET, 8, offsets[i]);
+        size = add_number(packet, size, FILE_SIZE, 4, 1000);
+        EXPECT(parse_control_packet(packet, size, &info) == result, "resume offset %lld before the file size",
+               offsets[i]);
+    }
+}
+
+// The END packet must name the file of the START packet
+void test_end_packet()
+{
+    unsigned char packet[MAX_PAYLOAD_SIZE];
+    unsigned char name[UCHAR_MAX + 1];
+    memset(name, 'n', UCHAR_MAX);
+    name[UCHAR_MAX] = '\0';
+
+    int size = 1;
+    packet[0] = END;
+    size = add_number(packet, size, FILE_SIZE, 4, 100);
+    size = add_field(packet, size, FILE_NAME, UCHAR_MAX, name);
+    size = add_number(packet, size, FILE_CHECKSUM, 4, 0x12345678); // Skipped here
+    EXPECT(check_end_packet(packet, size, name, 100) == 1, "END packet with a 255 byte name refused");
+    EXPECT(check_end_packet(packet, size, name, 101) < 0, "END packet of another size accepted");
+
+    name[UCHAR_MAX - 1] = 'm';
+    EXPECT(check_end_packet(packet, size, name, 100) < 0, "END packet of another name accepted");
+
+    size = add_number(packet, 1, FILE_SIZE, 4, 100);
+    EXPECT(check_end_packet(packet, size, name, 100) < 0, "END packet without a name accepted");
+}
+
+long long sink_size(int fd)
+{
+    struct stat st;
+    return fstat(fd, &st) == 0 ? st.st_size : -1;
+}
+
+// Every kind of data packet lands at its offset
+void test_write_data_packet(const unsigned char *data)
+{
+    char path[] = "/tmp/packet_testXXXXXX";
+    int fd = mkstemp(path);
+    static unsigned char packet[MAX_PAYLOAD_SIZE];
+    static unsigned char block[MAX_PAYLOAD_SIZE];
+    static unsigned char compressed[MAX_PAYLOAD_SIZE];
+    long long offset;
+
+    // DATA at the offset the receiver keeps
+    offset = 0;
+    int size = build_packet(packet, DATA, 0, data, BLOCK);
+    EXPECT(write_data_packet(fd, packet, size, block, sizeof(block), SINK_SIZE, &offset, NULL) == BLOCK && offset == 0,
+           "DATA packet not written at offset 0");
+
+    // DATA_OFFSET anywhere, up to the last byte of the file
+    offset = 0;
+    size = build_packet(packet, DATA_OFFSET, SINK_SIZE - BLOCK, data + SINK_SIZE - BLOCK, BLOCK);
+    EXPECT(write_data_packet(fd, packet, size, block, sizeof(block), SINK_SIZE, &offset, NULL) == BLOCK &&
+               offset == SINK_SIZE - BLOCK,
+           "DATA_OFFSET packet at the end of the file: offset %lld", offset);
+
+    // DATA_LZ_OFFSET, decompressed before writing
+    int compressed_size = lz_compress(data + 1000, BLOCK, compressed, sizeof(compressed));
+    size = build_packet(packet, DATA_LZ_OFFSET, 1000, compressed, compressed_size);
+    EXPECT(compressed_size > 0 &&
+               write_data_packet(fd, packet, size, block, sizeof(block), SINK_SIZE, &offset, NULL) == BLOCK &&
+               offset == 1000,
+           "DATA_LZ_OFFSET packet not written at offset 1000");
+
+    // An empty DATA packet writes nothing
+    offset = 0;
+    size = build_packet(packet, DATA, 0, data, 0);
+    EXPECT(write_data_packet(fd, packet, size, block, sizeof(block), SINK_SIZE, &offset, NULL) == 0,
+           "empty DATA packet refused");
+
+    unsigned char written[BLOCK];
+    EXPECT(pread(fd, written, BLOCK, 0) == BLOCK && memcmp(written, data, BLOCK) == 0, "bytes at 0 differ");
+    EXPECT(pread(fd, written, BLOCK, 1000) == BLOCK && memcmp(written, data + 1000, BLOCK) == 0, "bytes at 1000 differ");
+    EXPECT(sink_size(fd) == SINK_SIZE, "file of %lld bytes, expected %d", sink_size(fd), SINK_SIZE);
+
+    close(fd);
+    unlink(path);
+}
+
+// Malformed packets and packets outside the file are refused without writing
+void test_refused_packets(const unsigned char *data)
+{
+    char path[] = "/tmp/packet_testXXXXXX";
+    int fd = mkstemp(path);
+    static unsigned char packet[MAX_PAYLOAD_SIZE];
+    static unsigned char block[MAX_PAYLOAD_SIZE];
+    long long offset;
+    int size;
+
+    // Offsets past the end of the file, or whose data runs past it
+    const long long outside[] = {SINK_SIZE, SINK_SIZE - BLOCK + 1, MAX_OFFSET32, MAX_OFFSET32 + 1, 0x7FFFFFFFFFFFFFFFLL};
+    for (int i = 0; i < COUNT_OF(outside); i++)
+    {
+        offset = 0;
+        size = build_packet(packet, DATA_OFFSET, outside[i], data, BLOCK);
+        EXPECT(write_data_packet(fd, packet, size, block, sizeof(block), SINK_SIZE, &offset, NULL) < 0,
+               "packet at offset %lld of a file of %d bytes accepted", outside[i], SINK_SIZE);
+    }
+
+    // A DATA packet once the receiver's offset reached the end, or was lost
+    const long long data_offsets[] = {SINK_SIZE, -1};
+    for (int i = 0; i < COUNT_OF(data_offsets); i++)
+    {
+        offset = data_offsets[i];
+        size = build_packet(packet, DATA, 0, data, BLOCK);
+        EXPECT(write_data_packet(fd, packet, size, block, sizeof(block), SINK_SIZE, &offset, NULL) < 0,
+               "DATA packet at offset %lld accepted", data_offsets[i]);
+    }
+
+    // A 64-bit offset that does not fit in a long long
+    size = build_packet(packet, DATA_OFFSET64, MAX_OFFSET32 + 1, data, BLOCK);
+    memset(packet + 1, 0xFF, 8);
+    EXPECT(write_data_packet(fd, packet, size, block, sizeof(block), SINK_SIZE, &offset, NULL) < 0,
+           "offset of 2^64 - 1 accepted");
+
+    // Unknown types, including an empty packet
+    packet[0] = 42;
+    for (size = 0; size <= OFFSET64_HEADER_SIZE; size++)
+    {
+        offset = 0;
+        EXPECT(write_data_packet(fd, packet, size, block, sizeof(block), SINK_SIZE, &offset, NULL) < 0,
+               "packet of unknown type (%d bytes) accepted", size);
+    }
+
+    // Packets shorter than their header, and sizes disagreeing with K
+    const int types[] = {DATA, DATA_OFFSET, DATA_OFFSET64};
+    for (int t = 0; t < COUNT_OF(types); t++)
+    {
+        int full = build_packet(packet, types[t], 0, data, BLOCK);
+        int header_size = data_header_size(types[t]);
+        for (size = 1; size < header_size; size++)
+        {
+            offset = 0;
+            EXPECT(write_data_packet(fd, packet, size, block, sizeof(block), SINK_SIZE, &offset, NULL) < 0,
+                   "type %d: %d bytes of a %d byte header accepted", types[t], size, header_size);
+        }
+        offset = 0;
+        EXPECT(write_data_packet(fd, packet, full - 1, block, sizeof(block), SINK_SIZE, &offset, NULL) < 0,
+               "type %d: packet shorter than K accepted", types[t]);
+        offset = 0;
+        EXPECT(write_data_packet(fd, packet, full + 1, block, sizeof(block), SINK_SIZE, &offset, NULL) < 0,
+               "type %d: packet longer than K accepted", types[t]);
+    }
+
+    // Compressed data that does not decompress
+    memset(block, 0xFF, BLOCK);
+    size = build_packet(packet, DATA_LZ_OFFSET, 0, block, BLOCK);
+    EXPECT(write_data_packet(fd, packet, size, block, sizeof(block), SINK_SIZE, &offset, NULL) < 0,
+           "damaged DATA_LZ_OFFSET packet accepted");
+
+    EXPECT(sink_size(fd) == 0, "refused packets wrote %lld bytes", sink_size(fd));
+
+    close(fd);
+    unlink(path);
+}
+
+int main()
+{
+    static unsigned char data[SINK_SIZE];
+    srand(1);
+    for (int i = 0; i < SINK_SIZE; i++)
+        data[i] = "abcd"[rand() % 4]; // Compressible
+
+    test_control_fields();
+    test_control_truncated();
+    test_file_sizes();
+    test_resume_offset();
+    test_end_packet();
+    test_write_data_packet(data);
+    test_refused_packets(data);
+    return test_result("packet_test");
+}
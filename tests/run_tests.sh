@@ -0,0 +1,19 @@
+#!/bin/sh
+# Build and run every unit test (tests/*_test.c) against the sources in src/.
+# Arguments are passed on to gcc, e.g. -DLL_SIMD=0 to test the portable code.
+# Exits with 1 if a test fails to build or fails a check.
+
+cd "$(dirname "$0")/.." || exit 1
+mkdir -p bin
+
+status=0
+for test in tests/*_test.c; do
+    name=$(basename "$test" .c)
+    if ! gcc -O2 -Wall -Iinclude -Itests "$@" -o "bin/$name" "$test" tests/test.c src/*.c; then
+        echo "$name: build failed"
+        status=1
+        continue
+    fi
+    "./bin/$name" || status=1
+done
+exit $status
@@ -0,0 +1,16 @@
+#include "test.h"
+
+int failures = 0;
+
+// Print the outcome of the test called name.
+// Returns the exit status of the test program.
+int test_result(const char *name)
+{
+    if (failures > 0)
+    {
+        printf("%s: %d checks failed\n", name, failures);
+        return 1;
+    }
+    printf("%s: all checks passed\n", name);
+    return 0;
+}
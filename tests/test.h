@@ -0,0 +1,33 @@
+#ifndef _TEST_H_
+#define _TEST_H_
+
+#include <stdio.h>
+
+// Checks shared by the unit tests. Each test in tests/ is a program built
+// with the sources in src/ (see tests/run_tests.sh); it prints every failed
+// check and exits with 1 if there was any.
+
+// Number of failed checks
+extern int failures;
+
+// Count and print a failed check, with a printf style message
+#define EXPECT(condition, ...)                             \
+    do                                                     \
+    {                                                      \
+        if (!(condition))                                  \
+        {                                                  \
+            printf("FAILED %s:%d: ", __FILE__, __LINE__);  \
+            printf(__VA_ARGS__);                           \
+            printf("\n");                                  \
+            failures++;                                    \
+        }                                                  \
+    } while (0)
+
+// Number of elements of an array
+#define COUNT_OF(array) ((int)(sizeof(array) / sizeof((array)[0])))
+
+// Print the outcome of the test called name.
+// Returns the exit status of the test program.
+int test_result(const char *name);
+
+#endif // _TEST_H_